@@ -68,6 +68,10 @@ int main() {
     // Example 4: Hybrid search
     std::cout << "Example 4: Hybrid search\n";
     std::cout << "------------------------\n";
+    // The keyword leg indexes the stored documents, so both legs share ids
+    auto keyword_retriever = std::make_shared<BM25Retriever>();
+    keyword_retriever->add_documents(vector_store->get_by_ids(ids));
+    advanced_retriever.set_keyword_retriever(keyword_retriever);
     auto hybrid_results = advanced_retriever.hybrid_search("machine learning", 3);
     std::cout << "Found " << hybrid_results.size() << " documents:\n";
     for (const auto& doc : hybrid_results) {
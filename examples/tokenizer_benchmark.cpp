@@ -0,0 +1,129 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <atomic>
+#include <cctype>
+#include <cstdlib>
+#include <map>
+#include <new>
+#include <random>
+#include <vector>
+#include "../include/langchain/langchain.h"
+
+using namespace langchain;
+
+// Count every heap allocation made by the process
+static std::atomic<size_t> allocation_count(0);
+
+void* operator new(size_t size) {
+    allocation_count++;
+    void* pointer = std::malloc(size == 0 ? 1 : size);
+    if (!pointer) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    std::free(pointer);
+}
+
+// Word splitting as the lexical paths did it before the shared Tokenizer:
+// a std::string per word and a std::map of term frequencies per text
+size_t count_terms_with_strings(const String& text) {
+    std::map<String, int> frequencies;
+    String word;
+    for (char c : text) {
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            if (!word.empty()) {
+                frequencies[word]++;
+                word.clear();
+            }
+        } else {
+            word += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+    }
+    if (!word.empty()) {
+        frequencies[word]++;
+    }
+    return frequencies.size();
+}
+
+// Same result with the Tokenizer: views into its buffer, counted by sorting
+size_t count_terms_with_tokenizer(Tokenizer& tokenizer, std::vector<std::string_view>& scratch, const String& text) {
+    scratch = tokenizer.tokenize(text);
+    std::sort(scratch.begin(), scratch.end());
+    return static_cast<size_t>(std::unique(scratch.begin(), scratch.end()) - scratch.begin());
+}
+
+int main() {
+    std::cout << "LangChain C++ Tokenizer Benchmark\n";
+    std::cout << "=================================\n\n";
+
+    std::mt19937 rng(42);
+    const std::vector<String> vocabulary = {
+        "The", "quick", "brown", "fox", "jumps", "over", "lazy", "dog", "Vector", "search",
+        "retrieval", "embedding", "index", "Document", "query", "ranking", "Café", "Ωmega", "Москва"
+    };
+    std::uniform_int_distribution<size_t> pick(0, vocabulary.size() - 1);
+
+    const size_t texts = 2000;
+    const size_t words_per_text = 200;
+    std::vector<String> corpus;
+    size_t total_tokens = 0;
+    for (size_t i = 0; i < texts; ++i) {
+        String text;
+        for (size_t w = 0; w < words_per_text; ++w) {
+            text += vocabulary[pick(rng)];
+            text += (w % 17 == 16) ? "\n" : " ";
+        }
+        corpus.push_back(text);
+        total_tokens += words_per_text;
+    }
+
+    std::cout << "Corpus: " << texts << " texts, " << total_tokens << " tokens\n\n";
+    std::cout << std::fixed << std::setprecision(3);
+
+    // std::string words and std::map counts
+    size_t sink = 0;
+    size_t allocations_before = allocation_count;
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& text : corpus) {
+        sink += count_terms_with_strings(text);
+    }
+    auto end = std::chrono::steady_clock::now();
+    double string_seconds = std::chrono::duration<double>(end - start).count();
+    size_t string_allocations = allocation_count - allocations_before;
+
+    // Reused Tokenizer and scratch vector
+    Tokenizer tokenizer;
+    std::vector<std::string_view> scratch;
+    allocations_before = allocation_count;
+    start = std::chrono::steady_clock::now();
+    for (const auto& text : corpus) {
+        sink += count_terms_with_tokenizer(tokenizer, scratch, text);
+    }
+    end = std::chrono::steady_clock::now();
+    double tokenizer_seconds = std::chrono::duration<double>(end - start).count();
+    size_t tokenizer_allocations = allocation_count - allocations_before;
+
+    std::cout << std::left << std::setw(24) << "Method" << std::right << std::setw(12) << "Time (ms)"
+              << std::setw(16) << "Allocations" << std::setw(16) << "Allocs/token" << "\n";
+    std::cout << std::left << std::setw(24) << "std::string + map" << std::right
+              << std::setw(12) << string_seconds * 1000.0
+              << std::setw(16) << string_allocations
+              << std::setw(16) << static_cast<double>(string_allocations) / total_tokens << "\n";
+    std::cout << std::left << std::setw(24) << "Tokenizer" << std::right
+              << std::setw(12) << tokenizer_seconds * 1000.0
+              << std::setw(16) << tokenizer_allocations
+              << std::setw(16) << static_cast<double>(tokenizer_allocations) / total_tokens << "\n";
+    if (tokenizer_seconds > 0.0) {
+        std::cout << "\nSpeedup: " << std::setprecision(2) << string_seconds / tokenizer_seconds << "x\n";
+    }
+    std::cout << "(checksum " << sink << ")\n";
+    return 0;
+}
@@ -0,0 +1,76 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <vector>
+#include "../include/langchain/langchain.h"
+
+using namespace langchain;
+
+// Time a flat scan of one query against every row of a matrix
+double benchmark_scan(const VectorMatrix& matrix, const float* query, bool euclidean, int repeats) {
+    volatile float sink = 0.0f;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repeats; ++r) {
+        float total = 0.0f;
+        for (size_t i = 0; i < matrix.rows(); ++i) {
+            total += euclidean ? l2_distance_squared(query, matrix.row(i), matrix.dimension())
+                               : dot_product(query, matrix.row(i), matrix.dimension());
+        }
+        sink = sink + total;
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+int main() {
+    std::cout << "LangChain C++ Vector Math Benchmark\n";
+    std::cout << "===================================\n\n";
+
+    SimdLevel detected = detect_simd_level();
+    std::cout << "Detected instruction set: " << simd_level_name(detected) << "\n\n";
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+
+    const size_t rows = 20000;
+    const int repeats = 20;
+
+    for (size_t dimension : {128, 384, 768, 1536}) {
+        VectorMatrix matrix(dimension);
+        std::vector<float> vector(dimension);
+        for (size_t i = 0; i < rows; ++i) {
+            for (auto& value : vector) {
+                value = dist(rng);
+            }
+            matrix.append(vector.data());
+        }
+        for (auto& value : vector) {
+            value = dist(rng);
+        }
+
+        std::cout << "Dimension " << dimension << " (" << rows << " vectors, flat scan)\n";
+
+        // Two floating point operations per element for both kernels
+        double flops = 2.0 * dimension * rows * repeats;
+        for (bool euclidean : {false, true}) {
+            double scalar_seconds = 0.0;
+            for (int level = 0; level <= static_cast<int>(detected); ++level) {
+                SimdLevel selected = set_simd_level(static_cast<SimdLevel>(level));
+                double seconds = benchmark_scan(matrix, vector.data(), euclidean, repeats);
+                if (selected == SimdLevel::SCALAR) {
+                    scalar_seconds = seconds;
+                }
+                std::cout << "  " << std::left << std::setw(10) << (euclidean ? "l2" : "dot")
+                          << std::setw(10) << simd_level_name(selected)
+                          << std::right << std::fixed << std::setprecision(2)
+                          << std::setw(8) << flops / seconds / 1e9 << " GFLOP/s"
+                          << std::setw(8) << scalar_seconds / seconds << "x\n";
+            }
+        }
+        std::cout << std::endl;
+    }
+
+    set_simd_level(detected);
+    return 0;
+}
@@ -3,9 +3,14 @@
 
 #include "core.h"
 #include "vectorstores.h"
+#include "bm25.h"
+#include "text_index.h"
+#include "tokenizer.h"
 #include <memory>
 #include <functional>
 #include <set>
+#include <shared_mutex>
+#include <unordered_map>
 
 namespace langchain {
 
@@ -14,15 +19,43 @@ enum class SimilarityAlgorithm {
     COSINE,
     JACCARD,
     EUCLIDEAN,
-    BM25
+    // Okapi BM25 with the keyword retriever's document frequencies, average length and
+    // parameters. Without a keyword retriever only an approximation: a fixed average
+    // length of 100 distinct terms and an IDF made up from the term frequency
+    BM25,
+    OVERLAP
 };
 
-// Advanced retriever with filtering and multiple similarity algorithms
+// How hybrid search combines its keyword and semantic rankings
+enum class FusionMethod {
+    RECIPROCAL_RANK,   // Sum of weight / (60 + rank) over the rankings
+    WEIGHTED_SCORE     // Sum of weight * score, after scaling each ranking's scores to [0, 1]
+};
+
+// Advanced retriever with filtering and multiple similarity algorithms.
+// Texts are encoded against the retriever's TermDictionary, so every built-in
+// algorithm scores a candidate by merging two sorted integer term arrays.
+// Documents given to add_documents keep their term vector and norm, so scoring
+// them skips tokenization and cosine / Euclidean need one sparse dot product.
+// Searches never add terms to the dictionary: queries and other candidates are
+// encoded through a per-call TermOverlay, and only that encoding step takes the
+// lock (shared), so concurrent searches score in parallel.
 class AdvancedRetriever {
 private:
     std::shared_ptr<VectorStore> vector_store_;
     SimilarityAlgorithm algorithm_;
     std::function<double(const String&, const String&)> custom_similarity_fn_;
+    std::shared_ptr<BM25Retriever> keyword_retriever_;
+    FusionMethod fusion_method_;
+    // Term vector of a document given to add_documents and a hash of its content
+    struct DocumentTerms {
+        SparseTermVector vector;
+        size_t content_hash;
+    };
+
+    TermDictionary dictionary_;  // Vocabulary of the documents given to add_documents
+    std::unordered_map<String, std::shared_ptr<const DocumentTerms>> document_vectors_;  // By document id
+    mutable std::shared_mutex dictionary_mutex_;  // Guards dictionary_ and document_vectors_
 
 public:
     AdvancedRetriever(std::shared_ptr<VectorStore> vector_store, SimilarityAlgorithm algorithm = SimilarityAlgorithm::COSINE);
@@ -40,37 +73,59 @@ public:
                                                                const std::map<String, String>& filters = {},
                                                                double threshold = 0.0);
 
-    // Hybrid search combining multiple approaches
+    // Hybrid search combining keyword (BM25) and semantic (vector store) rankings.
+    // With a keyword retriever both legs run at the same time on the shared thread
+    // pool; without one the vector store's candidates are ranked a second time by
+    // the selected similarity algorithm. Documents found by both legs appear once.
     std::vector<Document> hybrid_search(const String& query, int k = 4,
                                        const std::map<String, String>& filters = {},
                                        double keyword_weight = 0.5,
                                        double semantic_weight = 0.5);
 
-    // Set similarity algorithm
-    void set_similarity_algorithm(SimilarityAlgorithm algorithm);
+    // Hybrid search with fused scores
+    std::vector<std::pair<Document, double>> hybrid_search_with_scores(const String& query, int k = 4,
+                                                                      const std::map<String, String>& filters = {},
+                                                                      double keyword_weight = 0.5,
+                                                                      double semantic_weight = 0.5);
 
-private:
-    // Filter documents based on metadata
-    std::vector<Document> filter_documents(const std::vector<Document>& documents,
-                                          const std::map<String, String>& filters);
+    // Set the BM25 index used as the keyword leg of hybrid search; it should hold
+    // the same documents (with the same ids) as the vector store
+    void set_keyword_retriever(std::shared_ptr<BM25Retriever> keyword_retriever);
 
-    // Calculate similarity based on selected algorithm
-    double calculate_similarity(const String& str1, const String& str2);
+    // Set how hybrid search fuses its rankings
+    void set_fusion_method(FusionMethod fusion_method);
 
-    // Cosine similarity implementation
-    double cosine_similarity(const String& str1, const String& str2);
+    // Set similarity algorithm
+    void set_similarity_algorithm(SimilarityAlgorithm algorithm);
 
-    // Jaccard similarity implementation
-    double jaccard_similarity(const String& str1, const String& str2);
+    // Precompute term vectors of documents (by id) as they are added to the vector store.
+    // Candidates without one are tokenized when scored, as are candidates whose content
+    // no longer matches the content given here (an id reused for new text)
+    void add_documents(const std::vector<Document>& documents);
 
-    // Euclidean distance implementation (converted to similarity)
-    double euclidean_similarity(const String& str1, const String& str2);
+    // Drop precomputed term vectors
+    void remove_documents(const StringList& ids);
 
-    // BM25 implementation (simplified)
-    double bm25_similarity(const String& query, const String& document);
+private:
+    // Term vectors of a query and its candidates, comparable with each other
+    struct ScoringVectors {
+        SparseTermVector query;
+        std::vector<std::shared_ptr<const SparseTermVector>> documents;  // One per candidate
+        std::vector<double> idf;        // BM25 weight per query term, from the keyword retriever
+        double average_length = 0.0;    // Tokens per document of the keyword retriever's corpus
+        BM25Config bm25_config;
+    };
+
+    // Encode a query and its candidates under a shared lock, reusing precomputed vectors;
+    // the result stays valid after the lock is released
+    void encode_for_scoring(const String& query, const std::vector<const Document*>& documents,
+                            ScoringVectors& vectors) const;
+
+    // Calculate similarity based on selected algorithm
+    double calculate_similarity(const ScoringVectors& vectors, const SparseTermVector& document_vector) const;
 
-    // Split string into words (with frequency)
-    std::map<String, int> split_to_words_with_frequency(const String& str);
+    // BM25 with corpus statistics when vectors carry them, otherwise the approximation
+    double bm25_similarity(const ScoringVectors& vectors, const TermVector& document_terms) const;
 
     // Get all unique words from a collection of strings
     std::set<String> get_unique_words(const std::vector<String>& strings);
@@ -0,0 +1,114 @@
+#ifndef LANGCHAIN_BM25_H
+#define LANGCHAIN_BM25_H
+
+#include "core.h"
+#include "text_index.h"
+#include "vector_math.h"
+#include <cstdint>
+#include <shared_mutex>
+
+namespace langchain {
+
+// Tuning parameters for BM25Retriever
+struct BM25Config {
+    double k1 = 1.2;           // Term frequency saturation
+    double b = 0.75;           // Document length normalization
+    size_t block_size = 64;    // Postings per block-max entry
+    bool use_pruning = true;   // Block-max MaxScore; false scores every posting of the query terms
+};
+
+// Work done by one BM25 query
+struct BM25SearchStats {
+    size_t postings_total = 0;     // Postings of the query terms
+    size_t documents_scored = 0;   // Documents whose full score was computed
+};
+
+// Keyword retriever ranking documents by Okapi BM25.
+// Document frequencies, lengths and the average length are kept up to date as
+// documents are added, and queries are scored from postings lists with block-max
+// MaxScore: terms whose score bounds cannot lift a document into the top k on their
+// own are only probed for documents found through the other terms, so top-k
+// queries skip most postings.
+// Bounds come from the largest term frequency and shortest document of each
+// term and block, which stay valid as the corpus statistics change.
+class BM25Retriever {
+private:
+    // Postings [first, first + block_size) of a term
+    struct Block {
+        uint32_t last_slot;
+        uint32_t max_frequency;
+        uint32_t min_length;
+    };
+
+    struct TermPostings {
+        std::vector<Posting> postings;
+        std::vector<Block> blocks;
+        uint32_t max_frequency = 0;
+        uint32_t min_length = UINT32_MAX;
+    };
+
+    BM25Config config_;
+    TermDictionary dictionary_;
+    std::vector<TermPostings> terms_;  // Indexed by term id
+    std::vector<Document> documents_;
+    std::vector<uint32_t> document_lengths_;
+    uint64_t total_length_;
+    TermVector scratch_;
+    mutable std::shared_mutex mutex_;
+
+public:
+    explicit BM25Retriever(const BM25Config& config = BM25Config());
+
+    // Index documents; their ids are kept as given
+    void add_documents(const std::vector<Document>& documents);
+
+    // Retrieve the k best matching documents
+    std::vector<Document> retrieve(const String& query, int k = 4) const;
+
+    // Retrieve the k best matching documents with their BM25 scores; documents
+    // sharing no term with the query are not returned
+    std::vector<std::pair<Document, double>> retrieve_with_scores(const String& query, int k = 4,
+                                                                  BM25SearchStats* stats = nullptr) const;
+
+    // Retrieve the k best matching documents whose metadata matches the filter
+    std::vector<std::pair<Document, double>> retrieve_with_filter(const String& query, int k,
+                                                                  const MetadataFilter& filter) const;
+
+    // Number of indexed documents
+    size_t document_count() const;
+
+    // Mean number of tokens per document
+    double average_document_length() const;
+
+    // Number of documents containing a term (after tokenization)
+    size_t document_frequency(const String& term) const;
+
+    // Inverse document frequency of each already tokenized term, read under one lock,
+    // so other scorers can weight terms by this corpus
+    std::vector<double> inverse_document_frequencies(const std::vector<std::string_view>& terms) const;
+
+    // Scoring parameters
+    const BM25Config& config() const { return config_; }
+
+    // Remove all documents
+    void clear();
+
+private:
+    // Inverse document frequency, never negative
+    double idf(size_t document_frequency) const;
+
+    // Score of one term occurring frequency times in a document of length tokens
+    double term_score(uint32_t frequency, uint32_t length, double average_length) const;
+
+    // Score a query and copy out the k winners
+    std::vector<std::pair<Document, double>> collect(const String& query, int k, const MetadataFilter* filter,
+                                                     BM25SearchStats& stats) const;
+
+    // Collect the best slots for the query terms among documents matching the filter (if any)
+    void search(const TermVector& query_terms, TopKCollector& top_k, const MetadataFilter* filter,
+                BM25SearchStats& stats) const;
+};
+
+} // namespace langchain
+
+#endif // LANGCHAIN_BM25_H
@@ -0,0 +1,125 @@
+#ifndef LANGCHAIN_CONCURRENT_VECTORSTORE_H
+#define LANGCHAIN_CONCURRENT_VECTORSTORE_H
+
+#include "core.h"
+#include "text_index.h"
+#include "vector_math.h"
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <unordered_map>
+
+namespace langchain {
+
+// Vector store for serving queries from many threads while documents are being added.
+// The contents are an immutable snapshot: a list of sealed segments plus their
+// tombstones. A query pins the current snapshot with one atomic load and never takes
+// a lock, so readers do not contend with each other or with writers. A write builds
+// a delta segment (and copy-on-write tombstones) beside the snapshot and publishes a
+// new snapshot atomically; queries already running finish on the old one, which is
+// freed when its last reader lets go. Small segments are merged into larger ones on
+// the writer side so a snapshot holds O(log n) segments.
+// Without an embedding model documents are ranked by word overlap like InMemoryVectorStore.
+class ConcurrentVectorStore : public VectorStore {
+private:
+    // Sealed batch of documents; never modified once published
+    struct Segment {
+        std::vector<std::shared_ptr<const Document>> documents;
+        std::unordered_map<String, uint32_t> id_to_slot;
+        VectorMatrix vectors;
+        InvertedIndex text_index;
+
+        explicit Segment(size_t dimension);
+    };
+
+    // A segment as seen by one snapshot
+    struct SegmentView {
+        std::shared_ptr<const Segment> segment;
+        std::shared_ptr<const std::vector<uint8_t>> deleted;  // Null when nothing is deleted
+        size_t deleted_count = 0;
+
+        size_t live() const { return segment->documents.size() - deleted_count; }
+        bool is_deleted(uint32_t slot) const { return deleted && (*deleted)[slot]; }
+    };
+
+    struct Snapshot {
+        std::vector<SegmentView> segments;  // Oldest first
+        size_t size = 0;                    // Live documents
+    };
+
+    std::shared_ptr<Embeddings> embeddings_;
+    DistanceMetric metric_;
+
+    // Published snapshot, read and replaced with std::atomic_load / std::atomic_store
+    std::shared_ptr<const Snapshot> snapshot_;
+
+    // Serializes writers; queries never take it
+    std::mutex write_mutex_;
+    std::mt19937 rng_;
+
+public:
+    ConcurrentVectorStore();
+
+    // Create a store that ranks documents by embedding similarity
+    explicit ConcurrentVectorStore(std::shared_ptr<Embeddings> embeddings,
+                                   DistanceMetric metric = DistanceMetric::COSINE);
+
+    // Add documents as a new segment; adding an existing ID replaces the document.
+    // Throws std::runtime_error if the embedding model does not return one vector per document
+    StringList add_documents(const std::vector<Document>& documents) override;
+
+    // Search for similar documents
+    std::vector<Document> similarity_search(const String& query, int k = 4) override;
+
+    // Search for similar documents with similarity scores
+    std::vector<std::pair<Document, double>> similarity_search_with_score(
+        const String& query, int k = 4) override;
+
+    // Search for several queries against one snapshot
+    std::vector<std::vector<std::pair<Document, double>>> similarity_search_batch_with_score(
+        const StringList& queries, int k = 4) override;
+
+    // Delete documents by IDs
+    void delete_documents(const StringList& ids) override;
+
+    // Get documents by IDs
+    std::vector<Document> get_by_ids(const StringList& ids) override;
+
+    // Number of live documents in the current snapshot
+    size_t size() const;
+
+    // Number of segments in the current snapshot
+    size_t segment_count() const;
+
+    // Merge every segment into one without tombstones
+    void compact();
+
+private:
+    // Pin the current snapshot
+    std::shared_ptr<const Snapshot> load_snapshot() const;
+
+    // Score one query against a pinned snapshot
+    std::vector<std::pair<Document, double>> search(const Snapshot& snapshot, const String& query,
+                                                    const Embedding& query_vector, int k) const;
+
+    // Embed a query and prepare it for scoring against the stored vectors
+    Embedding embed_query(const String& query) const;
+
+    // Copy the live documents of several segments into one new segment
+    std::shared_ptr<const Segment> merge_segments(const std::vector<SegmentView>& views) const;
+
+    // Drop empty segments and merge neighbours until each is smaller than the one before it
+    void rebalance(std::vector<SegmentView>& segments) const;
+
+    // Tombstone an ID in a snapshot under construction; returns whether it was live
+    bool remove_id(std::vector<SegmentView>& segments, const String& id,
+                   std::vector<std::shared_ptr<std::vector<uint8_t>>>& copied) const;
+
+    // Generate a random ID (caller holds write_mutex_)
+    String generate_id();
+};
+
+} // namespace langchain
+
+#endif // LANGCHAIN_CONCURRENT_VECTORSTORE_H
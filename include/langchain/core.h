@@ -17,11 +17,16 @@ class Chain;
 class Tool;
 class Agent;
 class VectorStore;
+class Embeddings;
 
 // Basic types
 using String = std::string;
 using StringList = std::vector<String>;
 using StringMap = std::map<String, String>;
+using Embedding = std::vector<float>;
+
+// Exact-match conditions on document metadata; a document must match every entry
+using MetadataFilter = std::map<String, String>;
 
 // Document class
 class Document {
@@ -85,6 +90,21 @@ public:
     virtual String execute(const String& input) = 0;
 };
 
+// Base Embeddings interface
+class Embeddings {
+public:
+    virtual ~Embeddings() = default;
+
+    // Embed a batch of documents
+    virtual std::vector<Embedding> embed_documents(const StringList& texts) = 0;
+
+    // Embed a single query
+    virtual Embedding embed_query(const String& text) = 0;
+
+    // Dimension of the produced vectors
+    virtual size_t dimension() const = 0;
+};
+
 // Base VectorStore interface
 class VectorStore {
 public:
@@ -93,6 +113,11 @@ public:
     // Add documents to the vector store
     virtual StringList add_documents(const std::vector<Document>& documents) = 0;
 
+    // Add documents whose embeddings were already computed with the store's model.
+    // The default ignores them and calls add_documents.
+    virtual StringList add_embedded_documents(const std::vector<Document>& documents,
+                                              const std::vector<Embedding>& embeddings);
+
     // Search for similar documents
     virtual std::vector<Document> similarity_search(const String& query, int k = 4) = 0;
 
@@ -105,8 +130,30 @@ public:
 
     // Get documents by IDs
     virtual std::vector<Document> get_by_ids(const StringList& ids) = 0;
+
+    // Search for similar documents for several queries at once; the default drops the
+    // scores of similarity_search_batch_with_score, so overriding that one is enough
+    virtual std::vector<std::vector<Document>> similarity_search_batch(const StringList& queries, int k = 4);
+
+    // Search for several queries at once with scores
+    virtual std::vector<std::vector<std::pair<Document, double>>> similarity_search_batch_with_score(
+        const StringList& queries, int k = 4);
+
+    // Search among documents whose metadata matches the filter, with scores.
+    // The default over-fetches until k matches are found or the store runs out.
+    virtual std::vector<std::pair<Document, double>> similarity_search_with_filter(
+        const String& query, int k, const MetadataFilter& filter);
+
+    // Pick k of the fetch_k most relevant documents, trading relevance against similarity
+    // to the documents already picked (lambda_mult 1 = relevance only, 0 = diversity only).
+    // The default has no stored vectors to compare and returns the k most relevant.
+    virtual std::vector<Document> max_marginal_relevance_search(const String& query, int k = 4,
+                                                                int fetch_k = 20, double lambda_mult = 0.5);
 };
 
+// Whether metadata satisfies every entry of a filter
+bool matches_filter(const StringMap& metadata, const MetadataFilter& filter);
+
 } // namespace langchain
 
 #endif // LANGCHAIN_CORE_H
\ No newline at end of file
@@ -0,0 +1,147 @@
+#ifndef LANGCHAIN_EMBEDDINGS_H
+#define LANGCHAIN_EMBEDDINGS_H
+
+#include "core.h"
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+namespace langchain {
+
+// Deterministic offline embedder based on the hashing trick.
+// Words and character trigrams are hashed into a fixed number of signed buckets
+// and the result is normalized, so texts sharing vocabulary get similar vectors.
+// CJK runs are hashed as whole words (CjkSegmentation::NONE), so CJK segmentation
+// does not affect the vectors. Other tokenizer changes can; callers caching these
+// vectors (e.g. in an EmbeddingCache) must bump the model ID when the tokenizer changes.
+class HashingEmbeddings : public Embeddings {
+private:
+    size_t dimension_;
+    bool use_char_ngrams_;
+
+public:
+    explicit HashingEmbeddings(size_t dimension = 256, bool use_char_ngrams = true);
+
+    // Embed a batch of documents
+    std::vector<Embedding> embed_documents(const StringList& texts) override;
+
+    // Embed a single query
+    Embedding embed_query(const String& text) override;
+
+    // Dimension of the produced vectors
+    size_t dimension() const override;
+
+private:
+    // Embed a single text
+    Embedding embed(const String& text) const;
+
+    // Add a hashed feature to the vector
+    void add_feature(Embedding& vector, uint64_t hash, float weight) const;
+};
+
+// Options for EmbeddingCache
+struct EmbeddingCacheConfig {
+    size_t max_entries = 10000;  // Embeddings kept in the in-memory LRU
+    String disk_path;            // SQLite file for the second tier (empty = memory only)
+};
+
+// Hit and miss counters of an EmbeddingCache
+struct EmbeddingCacheStats {
+    size_t memory_hits = 0;   // Served from the in-memory LRU
+    size_t disk_hits = 0;     // Served from the on-disk tier
+    size_t misses = 0;        // Computed by the wrapped model
+    size_t memory_entries = 0;
+};
+
+// Decorator that caches the embeddings of another model.
+// Entries are keyed by a 128-bit hash of the model ID, whether the text is a
+// document or a query, and the text with its whitespace normalized, so unchanged
+// documents and repeated queries are never embedded twice. The first tier is a
+// bounded LRU in memory; the optional second tier is a SQLite table that survives
+// restarts. Misses of a batch are embedded with one call to the wrapped model.
+// Safe to share between threads.
+class EmbeddingCache : public Embeddings {
+private:
+    struct Key {
+        uint64_t high;
+        uint64_t low;
+
+        bool operator==(const Key& other) const { return high == other.high && low == other.low; }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const { return static_cast<size_t>(key.low); }
+    };
+
+    using LruList = std::list<std::pair<Key, Embedding>>;
+
+    std::shared_ptr<Embeddings> embeddings_;
+    String model_id_;
+    EmbeddingCacheConfig config_;
+
+    // In-memory tier, most recently used first
+    mutable std::mutex mutex_;
+    LruList lru_;
+    std::unordered_map<Key, LruList::iterator, KeyHash> entries_;
+    EmbeddingCacheStats stats_;
+
+    // On-disk tier
+    std::mutex disk_mutex_;
+    sqlite3* db_;
+    sqlite3_stmt* select_stmt_;
+    sqlite3_stmt* insert_stmt_;
+
+public:
+    // Wrap a model; model_id must change whenever the model's output would change,
+    // including HashingEmbeddings output after a tokenizer change
+    EmbeddingCache(std::shared_ptr<Embeddings> embeddings, const String& model_id,
+                   const EmbeddingCacheConfig& config = EmbeddingCacheConfig());
+
+    ~EmbeddingCache() override;
+
+    EmbeddingCache(const EmbeddingCache&) = delete;
+    EmbeddingCache& operator=(const EmbeddingCache&) = delete;
+
+    // Embed a batch of documents, computing only the uncached ones; throws
+    // std::runtime_error if the wrapped model does not return one vector per miss
+    std::vector<Embedding> embed_documents(const StringList& texts) override;
+
+    // Embed a single query through the cache
+    Embedding embed_query(const String& text) override;
+
+    // Dimension of the wrapped model
+    size_t dimension() const override;
+
+    // Hit and miss counters
+    EmbeddingCacheStats get_stats() const;
+
+    // Whether the on-disk tier is open
+    bool has_disk_tier() const;
+
+    // Drop the in-memory tier (the disk tier is kept)
+    void clear_memory();
+
+private:
+    // Cache key of a document or query text
+    Key make_key(const String& text, bool query) const;
+
+    // Look a key up in memory, then on disk; counts hits
+    bool lookup(const Key& key, Embedding& embedding);
+
+    // Store computed embeddings in both tiers
+    void store(const std::vector<Key>& keys, const std::vector<Embedding>& embeddings);
+
+    // Insert into the LRU, evicting the least recently used entries (caller holds mutex_)
+    void insert_memory(const Key& key, const Embedding& embedding);
+
+    // Open the SQLite tier
+    bool open_disk(const String& path);
+};
+
+} // namespace langchain
+
+#endif // LANGCHAIN_EMBEDDINGS_H
@@ -0,0 +1,152 @@
+#ifndef LANGCHAIN_HNSW_H
+#define LANGCHAIN_HNSW_H
+
+#include "core.h"
+#include "vector_math.h"
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace langchain {
+
+// Tuning parameters for HNSWVectorStore
+struct HNSWConfig {
+    size_t M = 16;                  // Links per node on upper layers (2 * M on the base layer)
+    size_t ef_construction = 200;   // Candidate list size while inserting
+    size_t ef_search = 64;          // Candidate list size while searching
+    DistanceMetric metric = DistanceMetric::COSINE;
+    unsigned int seed = 100;
+};
+
+// Recall and latency of approximate search measured against an exact scan
+struct HNSWSearchReport {
+    size_t queries = 0;
+    int k = 0;
+    double recall = 0.0;                 // Fraction of the exact top-k returned by HNSW
+    double mean_latency_ms = 0.0;        // Mean HNSW query latency
+    double p99_latency_ms = 0.0;         // 99th percentile HNSW query latency
+    double exact_mean_latency_ms = 0.0;  // Mean latency of the exact scan
+};
+
+// Approximate nearest neighbour vector store based on Hierarchical Navigable Small World graphs.
+// add_documents may be called from several threads at once; deletes are soft and
+// only hide documents from results.
+class HNSWVectorStore : public VectorStore {
+private:
+    struct Node {
+        int level;
+        std::vector<std::vector<uint32_t>> links;  // Neighbor list per layer
+        std::mutex mutex;                          // Guards links
+        std::atomic<bool> deleted;
+
+        explicit Node(int level);
+    };
+
+    std::shared_ptr<Embeddings> embeddings_;
+    HNSWConfig config_;
+    double level_multiplier_;
+
+    // Storage grows under an exclusive lock; searches and linking take a shared lock
+    mutable std::shared_mutex storage_mutex_;
+    std::vector<Document> documents_;
+    VectorMatrix vectors_;
+    std::vector<std::unique_ptr<Node>> nodes_;
+    std::unordered_map<String, uint32_t> id_to_node_;
+    std::mt19937 rng_;
+
+    // Entry point of the graph
+    mutable std::mutex entry_mutex_;
+    int64_t entry_point_;
+    int max_level_;
+
+    std::atomic<size_t> deleted_count_;
+
+public:
+    explicit HNSWVectorStore(std::shared_ptr<Embeddings> embeddings, const HNSWConfig& config = HNSWConfig());
+
+    // Add documents to the vector store; throws std::runtime_error if the embedding
+    // model does not return one vector per document
+    StringList add_documents(const std::vector<Document>& documents) override;
+
+    // Add documents with embeddings computed by the same model
+    StringList add_embedded_documents(const std::vector<Document>& documents,
+                                      const std::vector<Embedding>& embeddings) override;
+
+    // Search for similar documents
+    std::vector<Document> similarity_search(const String& query, int k = 4) override;
+
+    // Search for similar documents with similarity scores
+    std::vector<std::pair<Document, double>> similarity_search_with_score(
+        const String& query, int k = 4) override;
+
+    // Diversify the fetch_k most similar documents by MMR, reusing their stored vectors
+    std::vector<Document> max_marginal_relevance_search(const String& query, int k = 4,
+                                                        int fetch_k = 20, double lambda_mult = 0.5) override;
+
+    // Soft delete documents by IDs
+    void delete_documents(const StringList& ids) override;
+
+    // Get documents by IDs
+    std::vector<Document> get_by_ids(const StringList& ids) override;
+
+    // Number of live documents
+    size_t size() const;
+
+    // Set the candidate list size used by searches
+    void set_ef_search(size_t ef_search);
+
+    // Get the configuration
+    const HNSWConfig& get_config() const;
+
+    // Measure recall and latency of approximate search against an exact scan
+    HNSWSearchReport evaluate(const StringList& queries, int k = 4);
+
+private:
+    // Insert one embedded document into the graph
+    String insert(const Document& document, Embedding embedding);
+
+    // Embed a query and prepare it for the metric
+    Embedding prepare_query(const String& query);
+
+    // Approximate search returning (distance, node) pairs, closest first
+    std::vector<std::pair<float, uint32_t>> search_nodes(const float* query, size_t k) const;
+
+    // Exact scan returning (distance, node) pairs, closest first
+    std::vector<std::pair<float, uint32_t>> exact_search_nodes(const float* query, size_t k) const;
+
+    // Best-first search on one layer
+    std::vector<std::pair<float, uint32_t>> search_layer(const float* query, uint32_t entry,
+                                                         size_t ef, int layer, bool skip_deleted) const;
+
+    // Pick up to max_links diverse neighbors from candidates sorted by distance
+    std::vector<uint32_t> select_neighbors(const std::vector<std::pair<float, uint32_t>>& candidates,
+                                           size_t max_links) const;
+
+    // Add a link from node to neighbor, pruning the neighbor list if it overflows
+    void add_link(uint32_t node, uint32_t neighbor, int layer);
+
+    // Copy the neighbor list of a node on a layer
+    std::vector<uint32_t> get_links(uint32_t node, int layer) const;
+
+    // Distance used for graph traversal (lower is closer)
+    float distance(const float* a, const float* b) const;
+
+    // Convert a traversal distance into a similarity score (higher is better)
+    double to_score(float distance) const;
+
+    // Maximum neighbors on a layer
+    size_t max_links(int layer) const;
+
+    // Draw a random level for a new node
+    int random_level();
+
+    // Generate a random ID
+    String generate_id();
+};
+
+} // namespace langchain
+
+#endif // LANGCHAIN_HNSW_H
@@ -0,0 +1,138 @@
+#ifndef LANGCHAIN_INGESTION_H
+#define LANGCHAIN_INGESTION_H
+
+#include "core.h"
+#include "vectorstores.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+namespace langchain {
+
+// Blocking FIFO with a fixed capacity, used between pipeline stages.
+// push waits while the queue is full, which is what propagates backpressure
+// from a slow stage back to the ones feeding it.
+template <typename T>
+class BoundedQueue {
+private:
+    std::deque<T> items_;
+    size_t capacity_;
+    bool closed_;
+    std::mutex mutex_;
+    std::condition_variable not_full_;
+    std::condition_variable not_empty_;
+
+public:
+    explicit BoundedQueue(size_t capacity) : capacity_(capacity == 0 ? 1 : capacity), closed_(false) {}
+
+    // Add an item, waiting for space; returns false if the queue was closed
+    bool push(T item) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_full_.wait(lock, [this]() { return closed_ || items_.size() < capacity_; });
+        if (closed_) {
+            return false;
+        }
+        items_.push_back(std::move(item));
+        not_empty_.notify_one();
+        return true;
+    }
+
+    // Take up to max_items, waiting for at least one; returns false once closed and drained
+    bool pop(std::vector<T>& out, size_t max_items = 1) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_empty_.wait(lock, [this]() { return closed_ || !items_.empty(); });
+        if (items_.empty()) {
+            return false;
+        }
+        while (!items_.empty() && out.size() < max_items) {
+            out.push_back(std::move(items_.front()));
+            items_.pop_front();
+        }
+        not_full_.notify_all();
+        return true;
+    }
+
+    // No more items will be pushed; consumers drain what is left
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        not_full_.notify_all();
+        not_empty_.notify_all();
+    }
+};
+
+// Worker counts, queue sizes and batch sizes of an IngestionPipeline
+struct IngestionConfig {
+    size_t loader_workers = 2;
+    size_t splitter_workers = 2;
+    size_t embedder_workers = 2;
+    size_t queue_capacity = 64;       // Items buffered between two stages
+    size_t embed_batch_size = 32;     // Chunks per call to the embedding model
+    size_t insert_batch_size = 256;   // Chunks per call to the vector store
+};
+
+// Progress and throughput of an ingestion run
+struct IngestionStats {
+    size_t documents_loaded = 0;   // Source documents read or handed in
+    size_t chunks_split = 0;       // Chunks produced by the splitter
+    size_t chunks_embedded = 0;    // Chunks embedded by the embedding stage
+    size_t chunks_stored = 0;      // Chunks added to the vector store
+    size_t store_batches = 0;      // Calls to the vector store
+    size_t errors = 0;             // Items dropped because a stage failed
+    double elapsed_seconds = 0.0;
+    double chunks_per_second = 0.0;
+};
+
+// Streaming ingestion: loader -> splitter -> embedder -> store.
+// Each stage runs on its own workers and hands items to the next through a
+// BoundedQueue, so stages overlap and memory holds at most a few queues' worth of
+// chunks instead of the whole split corpus. Without an embedding model (or for
+// stores that ignore precomputed vectors) the store embeds chunks itself.
+class IngestionPipeline {
+private:
+    std::shared_ptr<VectorStore> vector_store_;
+    std::shared_ptr<TextSplitter> text_splitter_;
+    std::shared_ptr<Embeddings> embeddings_;
+    IngestionConfig config_;
+
+    // Counters of the current (or last) run, readable while it is running
+    std::atomic<size_t> documents_loaded_;
+    std::atomic<size_t> chunks_split_;
+    std::atomic<size_t> chunks_embedded_;
+    std::atomic<size_t> chunks_stored_;
+    std::atomic<size_t> store_batches_;
+    std::atomic<size_t> errors_;
+    std::atomic<int64_t> start_time_ns_;
+    std::atomic<int64_t> end_time_ns_;
+    std::mutex run_mutex_;
+
+public:
+    // embeddings should be the store's own model; null lets the store embed
+    IngestionPipeline(std::shared_ptr<VectorStore> vector_store,
+                      std::shared_ptr<TextSplitter> text_splitter,
+                      std::shared_ptr<Embeddings> embeddings = nullptr,
+                      const IngestionConfig& config = IngestionConfig());
+
+    // Load, split, embed and store files
+    IngestionStats ingest_files(const StringList& file_paths);
+
+    // Ingest every .txt and .md file of a directory
+    IngestionStats ingest_directory(const String& directory_path);
+
+    // Split, embed and store documents that are already in memory
+    IngestionStats ingest_documents(const std::vector<Document>& documents);
+
+    // Progress of the current (or last) run
+    IngestionStats get_stats() const;
+
+private:
+    // Run the stages; load(i) produces the i-th of count source documents
+    IngestionStats run(size_t count, const std::function<Document(size_t)>& load);
+};
+
+} // namespace langchain
+
+#endif // LANGCHAIN_INGESTION_H
@@ -0,0 +1,104 @@
+#ifndef LANGCHAIN_IVF_H
+#define LANGCHAIN_IVF_H
+
+#include "core.h"
+#include "vector_math.h"
+#include <cstdint>
+#include <random>
+#include <unordered_map>
+
+namespace langchain {
+
+// Tuning parameters for IVFFlatVectorStore
+struct IVFConfig {
+    size_t nlist = 256;                 // Number of inverted lists (k-means centroids)
+    size_t nprobe = 8;                  // Lists scanned per query
+    size_t training_iterations = 25;    // Mini-batch k-means iterations
+    size_t training_batch_size = 1024;  // Vectors sampled per k-means iteration
+    size_t auto_train_size = 0;         // Train automatically at this many documents (0 = 39 * nlist)
+    DistanceMetric metric = DistanceMetric::COSINE;
+    unsigned int seed = 42;
+};
+
+// Inverted file vector store with flat (uncompressed) lists.
+// Vectors are clustered with mini-batch k-means and a query only scans the nprobe
+// lists whose centroids are closest to it. Until the index is trained every vector
+// sits in a single list and queries are exact.
+class IVFFlatVectorStore : public VectorStore {
+private:
+    struct InvertedList {
+        std::vector<uint32_t> slots;
+        VectorMatrix vectors;
+
+        explicit InvertedList(size_t dimension);
+    };
+
+    // Position of a document inside the lists
+    struct Location {
+        uint32_t list;
+        uint32_t position;
+    };
+
+    std::shared_ptr<Embeddings> embeddings_;
+    IVFConfig config_;
+    VectorMatrix centroids_;
+    std::vector<InvertedList> lists_;
+    std::vector<Document> documents_;
+    std::vector<Location> locations_;
+    std::unordered_map<String, uint32_t> id_to_slot_;
+    size_t size_;
+    bool trained_;
+    std::mt19937 rng_;
+
+public:
+    explicit IVFFlatVectorStore(std::shared_ptr<Embeddings> embeddings, const IVFConfig& config = IVFConfig());
+
+    // Add documents; after training new vectors go straight to their nearest list.
+    // Throws std::runtime_error if the embedding model does not return one vector per document
+    StringList add_documents(const std::vector<Document>& documents) override;
+
+    // Search for similar documents
+    std::vector<Document> similarity_search(const String& query, int k = 4) override;
+
+    // Search for similar documents with similarity scores
+    std::vector<std::pair<Document, double>> similarity_search_with_score(
+        const String& query, int k = 4) override;
+
+    // Delete documents by IDs
+    void delete_documents(const StringList& ids) override;
+
+    // Get documents by IDs
+    std::vector<Document> get_by_ids(const StringList& ids) override;
+
+    // Train (or retrain) the centroids on the stored vectors and rebuild the lists
+    void train();
+
+    // Whether the centroids have been trained
+    bool is_trained() const;
+
+    // Set the number of lists scanned per query
+    void set_nprobe(size_t nprobe);
+
+    // Number of stored documents
+    size_t size() const;
+
+    // Number of vectors in each inverted list
+    std::vector<size_t> get_list_sizes() const;
+
+private:
+    // Append an embedded document to a list
+    void add_to_list(uint32_t slot, const float* vector);
+
+    // Embed a query and prepare it for the metric
+    Embedding prepare_query(const String& query);
+
+    // Whether k-means should use inner products
+    bool spherical() const;
+
+    // Generate a random ID
+    String generate_id();
+};
+
+} // namespace langchain
+
+#endif // LANGCHAIN_IVF_H
@@ -9,7 +9,20 @@
 #include "chains.h"
 #include "tools.h"
 #include "agents.h"
+#include "vector_math.h"
+#include "thread_pool.h"
+#include "tokenizer.h"
+#include "text_index.h"
+#include "bm25.h"
+#include "metadata_index.h"
+#include "embeddings.h"
 #include "vectorstores.h"
+#include "concurrent_vectorstore.h"
+#include "sharded_vectorstore.h"
+#include "ingestion.h"
+#include "hnsw.h"
+#include "ivf.h"
+#include "quantization.h"
 #include "models.h"
 #include "memory.h"
 #include "data_connectors.h"
@@ -0,0 +1,34 @@
+#ifndef LANGCHAIN_METADATA_INDEX_H
+#define LANGCHAIN_METADATA_INDEX_H
+
+#include "core.h"
+#include <cstdint>
+#include <unordered_map>
+
+namespace langchain {
+
+// Attribute index from each metadata (key, value) pair to the slots carrying it.
+// Slot sets are sorted arrays, so high-cardinality keys cost four bytes per document
+// rather than a full bitmap per value. A filter is compiled by intersecting the sets
+// of its pairs, smallest first, before any similarity is computed.
+class MetadataIndex {
+private:
+    std::unordered_map<String, std::unordered_map<String, std::vector<uint32_t>>> slots_;
+
+public:
+    // Index the metadata of a document; slots must be added in increasing order
+    void add_document(uint32_t slot, const StringMap& metadata);
+
+    // Sorted slots matching every entry of a non-empty filter
+    std::vector<uint32_t> match(const MetadataFilter& filter) const;
+
+    // Number of distinct (key, value) pairs
+    size_t value_count() const;
+
+    // Remove all documents
+    void clear();
+};
+
+} // namespace langchain
+
+#endif // LANGCHAIN_METADATA_INDEX_H
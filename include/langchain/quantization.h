@@ -0,0 +1,227 @@
+#ifndef LANGCHAIN_QUANTIZATION_H
+#define LANGCHAIN_QUANTIZATION_H
+
+#include "core.h"
+#include "vector_math.h"
+#include <cstdint>
+#include <fstream>
+#include <random>
+#include <unordered_map>
+
+namespace langchain {
+
+// Compression applied to stored embeddings
+enum class QuantizationType {
+    SCALAR_INT8,   // One byte per dimension (4x smaller than float32)
+    PRODUCT,       // One byte per subspace, scored through ADC lookup tables
+    BINARY,        // Sign bit per dimension (32x smaller), needs no training, ranked by Hamming distance
+    FLOAT16,       // IEEE half precision (2x smaller), needs no training
+    BFLOAT16       // bfloat16: float32's exponent range with an 8-bit mantissa (2x smaller)
+};
+
+// Options for QuantizedVectorStore
+struct QuantizationConfig {
+    QuantizationType type = QuantizationType::SCALAR_INT8;
+    size_t pq_subspaces = 16;        // Number of PQ subspaces (bytes per vector)
+    size_t training_size = 1000;     // Documents buffered before the quantizer is trained
+    size_t rescore_candidates = 0;   // Candidates rescored at full precision (0 = no rescoring)
+    String full_precision_path;      // File holding float32 vectors for rescoring and recall reports
+    DistanceMetric metric = DistanceMetric::COSINE;
+    unsigned int seed = 42;
+};
+
+// Quality and size of a quantized store measured against full precision search
+struct QuantizationReport {
+    size_t queries = 0;
+    int k = 0;
+    double recall = 0.0;             // Fraction of the exact top-k returned by quantized search
+    size_t code_bytes = 0;           // Bytes used by the compressed vectors
+    size_t full_precision_bytes = 0; // Bytes the same vectors take as float32
+    double compression_ratio = 0.0;
+};
+
+// Per-dimension int8 scalar quantizer mapping [min, max] onto 0..255
+class ScalarQuantizer {
+private:
+    size_t dimension_;
+    std::vector<float> min_;
+    std::vector<float> scale_;
+
+public:
+    explicit ScalarQuantizer(size_t dimension = 0);
+
+    // Learn per-dimension ranges from the rows of a matrix
+    void train(const VectorMatrix& data);
+
+    // Encode a vector into dimension() bytes
+    void encode(const float* vector, uint8_t* code) const;
+
+    // Decode a code back into floats
+    void decode(const uint8_t* code, float* vector) const;
+
+    // Squared norm of the scaled part of a decoded code, needed for Euclidean scoring
+    float code_norm(const uint8_t* code) const;
+
+    // Rewrite a query so that scoring against a code is a single float x uint8 dot product.
+    // Returns the constant term: dot(query, x) = offset + dot(weights, code) for inner products,
+    // and |query - x|^2 = offset - 2 * dot(weights, code) + code_norm(code) for Euclidean.
+    float prepare_query(const float* query, bool euclidean, float* weights) const;
+
+    size_t dimension() const;
+};
+
+// Product quantizer: each vector is split into subspaces and every sub-vector is
+// replaced by the index of its nearest centroid in a 256 entry codebook
+class ProductQuantizer {
+private:
+    size_t dimension_;
+    size_t subspaces_;
+    size_t sub_dimension_;
+    std::vector<VectorMatrix> codebooks_;
+
+public:
+    ProductQuantizer(size_t dimension = 0, size_t subspaces = 1);
+
+    // Train one codebook per subspace with k-means
+    void train(const VectorMatrix& data, size_t iterations = 25, unsigned int seed = 42);
+
+    // Encode a vector into subspaces() bytes
+    void encode(const float* vector, uint8_t* code) const;
+
+    // Decode a code back into floats
+    void decode(const uint8_t* code, float* vector) const;
+
+    // Fill the ADC table (subspaces() x 256) with partial inner products or squared distances
+    void compute_table(const float* query, bool euclidean, float* table) const;
+
+    // Sum the table entries selected by a code
+    float score(const float* table, const uint8_t* code) const;
+
+    size_t subspaces() const;
+
+private:
+    // Copy one sub-vector into a zero padded buffer
+    void extract(const float* vector, size_t subspace, float* out) const;
+};
+
+// Binary quantizer keeping the sign bit of every dimension. Sign bits need no
+// training, and the Hamming distance between two codes counts the dimensions
+// whose signs differ, which ranks candidates for a cheap first-stage scan whose
+// best candidates are rescored at full precision.
+class BinaryQuantizer {
+private:
+    size_t dimension_;
+    size_t words_;
+
+public:
+    explicit BinaryQuantizer(size_t dimension = 0);
+
+    // Encode a vector into words() 64-bit words (unused trailing bits stay zero)
+    void encode(const float* vector, uint64_t* code) const;
+
+    // Cosine estimate for a Hamming distance between two codes, cos(pi * distance / dimension).
+    // This is the random-hyperplane (SimHash) relation; sign bits of the coordinate axes only
+    // follow it when the vectors are spread evenly over the dimensions, as hashed and rotated
+    // embeddings are. Treat it as a rough score for unrescored results.
+    double similarity(uint32_t distance) const;
+
+    size_t words() const;
+};
+
+// Flat vector store keeping only quantized embeddings in memory.
+// Full precision vectors can be kept on disk to rescore the best candidates.
+class QuantizedVectorStore : public VectorStore {
+private:
+    std::shared_ptr<Embeddings> embeddings_;
+    QuantizationConfig config_;
+    size_t dimension_;
+
+    std::vector<Document> documents_;
+    std::vector<uint8_t> deleted_;
+    std::unordered_map<String, uint32_t> id_to_slot_;
+    size_t size_;
+
+    // Vectors waiting for the quantizer to be trained
+    VectorMatrix pending_;
+    bool trained_;
+
+    ScalarQuantizer scalar_quantizer_;
+    ProductQuantizer product_quantizer_;
+    BinaryQuantizer binary_quantizer_;
+    size_t code_size_;                    // Bytes per code (64-bit words for BINARY, 16-bit values for halves)
+    std::vector<uint8_t> codes_;
+    std::vector<uint64_t> binary_codes_;
+    std::vector<uint16_t> half_codes_;
+    std::vector<float> code_norms_;
+
+    std::fstream full_precision_file_;
+    std::mt19937 rng_;
+
+public:
+    explicit QuantizedVectorStore(std::shared_ptr<Embeddings> embeddings,
+                                  const QuantizationConfig& config = QuantizationConfig());
+
+    // Add documents to the vector store; throws std::runtime_error if the embedding
+    // model does not return one vector per document
+    StringList add_documents(const std::vector<Document>& documents) override;
+
+    // Search for similar documents
+    std::vector<Document> similarity_search(const String& query, int k = 4) override;
+
+    // Search for similar documents with similarity scores
+    std::vector<std::pair<Document, double>> similarity_search_with_score(
+        const String& query, int k = 4) override;
+
+    // Delete documents by IDs
+    void delete_documents(const StringList& ids) override;
+
+    // Get documents by IDs
+    std::vector<Document> get_by_ids(const StringList& ids) override;
+
+    // Train the quantizer on the buffered vectors and encode them
+    void train();
+
+    // Whether the quantizer has been trained
+    bool is_trained() const;
+
+    // Number of stored documents
+    size_t size() const;
+
+    // Bytes used by vectors held in memory (codes plus untrained buffer)
+    size_t memory_usage() const;
+
+    // Measure recall against exact search over the full precision vectors on disk
+    QuantizationReport evaluate(const StringList& queries, int k = 4);
+
+private:
+    // Quantized scan followed by optional rescoring, returning (score, slot) best first
+    std::vector<std::pair<double, uint32_t>> search_slots(const float* query, size_t k);
+
+    // Quantized (or exact, before training) scan returning (score, slot), best first
+    std::vector<std::pair<double, uint32_t>> scan(const float* query, size_t count) const;
+
+    // Exact search over the full precision vectors on disk
+    std::vector<std::pair<double, uint32_t>> exact_scan(const float* query, size_t count);
+
+    // Score candidates again with their full precision vectors
+    void rescore(const float* query, std::vector<std::pair<double, uint32_t>>& candidates);
+
+    // Encode one vector and append its code
+    void append_code(const float* vector);
+
+    // Whether codes are 16-bit floats rather than trained quantizer codes
+    bool is_half_precision() const;
+
+    // Read the full precision vector of a slot from disk
+    bool read_full_precision(uint32_t slot, float* vector);
+
+    // Embed a query and prepare it for the metric
+    Embedding prepare_query(const String& query);
+
+    // Generate a random ID
+    String generate_id();
+};
+
+} // namespace langchain
+
+#endif // LANGCHAIN_QUANTIZATION_H
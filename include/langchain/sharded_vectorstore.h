@@ -0,0 +1,95 @@
+#ifndef LANGCHAIN_SHARDED_VECTORSTORE_H
+#define LANGCHAIN_SHARDED_VECTORSTORE_H
+
+#include "core.h"
+#include "thread_pool.h"
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <random>
+
+namespace langchain {
+
+// Vector store that hash-partitions documents by ID across independent shards.
+// Writes and lookups go to the shard owning each ID; searches fan out to every
+// shard on a thread pool and the per-shard top-k lists are merged. Each shard has
+// its own locks, so writers to different shards do not contend, and a shard can be
+// compacted or rebuilt on its own. Shards must score on the same scale (normally
+// the same store type and embedding model).
+class ShardedVectorStore : public VectorStore {
+private:
+    std::vector<std::shared_ptr<VectorStore>> shards_;
+    std::shared_ptr<ThreadPool> thread_pool_;  // Null uses ThreadPool::shared()
+    std::mutex id_mutex_;
+    std::mt19937 rng_;
+
+public:
+    // Build shard_count shards with a factory
+    ShardedVectorStore(size_t shard_count, const std::function<std::shared_ptr<VectorStore>()>& factory);
+
+    // Use existing stores as shards
+    explicit ShardedVectorStore(std::vector<std::shared_ptr<VectorStore>> shards);
+
+    // Add documents to the shards owning their IDs; returns IDs in input order. If a
+    // shard throws, the other shards still store their parts before the exception propagates
+    StringList add_documents(const std::vector<Document>& documents) override;
+
+    // Search for similar documents
+    std::vector<Document> similarity_search(const String& query, int k = 4) override;
+
+    // Search every shard in parallel and merge their top-k lists
+    std::vector<std::pair<Document, double>> similarity_search_with_score(
+        const String& query, int k = 4) override;
+
+    // Search every shard for a batch of queries and merge per query
+    std::vector<std::vector<std::pair<Document, double>>> similarity_search_batch_with_score(
+        const StringList& queries, int k = 4) override;
+
+    // Filtered search on every shard, merged
+    std::vector<std::pair<Document, double>> similarity_search_with_filter(
+        const String& query, int k, const MetadataFilter& filter) override;
+
+    // Delete documents by IDs
+    void delete_documents(const StringList& ids) override;
+
+    // Get documents by IDs, in input order
+    std::vector<Document> get_by_ids(const StringList& ids) override;
+
+    // Number of shards
+    size_t shard_count() const;
+
+    // Access a shard, e.g. to compact or rebuild it while the others keep serving
+    std::shared_ptr<VectorStore> shard(size_t index) const;
+
+    // Shard that owns an ID
+    size_t shard_for_id(const String& id) const;
+
+    // Run fan-out on a dedicated pool instead of the shared one (null restores it)
+    void set_thread_pool(std::shared_ptr<ThreadPool> pool);
+
+private:
+    // Pool used for fan-out
+    ThreadPool& pool() const;
+
+    // Run task(s) for every shard in parallel; the first shard's exception is rethrown
+    // after all shards have finished
+    void for_each_shard(const std::function<void(size_t)>& task) const;
+
+    // Run a search on every shard and merge the results into the best k
+    std::vector<std::pair<Document, double>> scatter_gather(
+        int k, const std::function<std::vector<std::pair<Document, double>>(VectorStore&)>& search) const;
+
+    // Merge per-shard result lists into the best k, best first
+    static std::vector<std::pair<Document, double>> merge_top_k(
+        std::vector<std::vector<std::pair<Document, double>>>& shard_results, int k);
+
+    // Group ID positions by owning shard
+    std::vector<std::vector<size_t>> route(const StringList& ids) const;
+
+    // Generate a random ID
+    String generate_id();
+};
+
+} // namespace langchain
+
+#endif // LANGCHAIN_SHARDED_VECTORSTORE_H
@@ -0,0 +1,174 @@
+#ifndef LANGCHAIN_TEXT_INDEX_H
+#define LANGCHAIN_TEXT_INDEX_H
+
+#include "core.h"
+#include <cstdint>
+#include <deque>
+#include <string_view>
+#include <unordered_map>
+
+namespace langchain {
+
+// Dense id of a term in a TermDictionary
+using TermId = uint32_t;
+
+// A distinct term of a text with its number of occurrences
+struct TermCount {
+    TermId term;
+    uint32_t frequency;
+};
+
+// Distinct terms of a text with their counts, sorted by term id
+using TermVector = std::vector<TermCount>;
+
+// A TermVector with its Euclidean norm, computed once so that cosine and
+// Euclidean scores against it only need a sparse dot product
+struct SparseTermVector {
+    TermVector terms;
+    double norm = 0.0;
+};
+
+// Corpus-wide dictionary assigning dense ids to terms in first-seen order.
+// Texts encoded against the same dictionary are compared by merging their
+// TermVectors as integer arrays, with no string hashing or comparison.
+class TermDictionary {
+private:
+    std::deque<String> terms_;  // Owns the term text; deque keeps it in place as it grows
+    std::unordered_map<std::string_view, TermId> ids_;
+    std::vector<TermId> scratch_;
+
+public:
+    // Id returned by find for terms that are not in the dictionary
+    static constexpr TermId UNKNOWN_TERM = static_cast<TermId>(-1);
+
+    TermDictionary() = default;
+
+    // Keys point into terms_, so the dictionary can be moved but not copied
+    TermDictionary(const TermDictionary&) = delete;
+    TermDictionary& operator=(const TermDictionary&) = delete;
+    TermDictionary(TermDictionary&&) = default;
+    TermDictionary& operator=(TermDictionary&&) = default;
+
+    // Id of a term, adding it if it is new
+    TermId intern(std::string_view term);
+
+    // Id of a term, or UNKNOWN_TERM
+    TermId find(std::string_view term) const;
+
+    // Text of a term id
+    std::string_view term(TermId id) const;
+
+    // Count tokens into out, adding new terms to the dictionary
+    void encode(const std::vector<std::string_view>& tokens, TermVector& out);
+
+    // Count only tokens already in the dictionary, leaving it unchanged; returns
+    // how many tokens were unknown
+    size_t lookup(const std::vector<std::string_view>& tokens, TermVector& out) const;
+
+    // Number of terms
+    size_t size() const;
+
+    // Remove all terms
+    void clear();
+};
+
+// Per-call extension of a shared dictionary that leaves it unchanged. Known terms
+// keep their ids; terms the dictionary lacks are numbered after its last id in a
+// private overflow dictionary, so every text encoded through one overlay can be
+// compared with the others and with vectors encoded against the base. The base
+// must not change while the overlay is in use.
+class TermOverlay {
+private:
+    const TermDictionary& base_;
+    TermId first_overflow_id_;
+    TermDictionary overflow_;
+    std::vector<TermId> scratch_;
+
+public:
+    explicit TermOverlay(const TermDictionary& base);
+
+    // Count tokens into out, adding unknown terms to the overflow only
+    void encode(const std::vector<std::string_view>& tokens, TermVector& out);
+
+    // Text of a term id of the base or the overflow
+    std::string_view term(TermId id) const;
+
+    // Number of terms added beside the base
+    size_t overflow_size() const;
+};
+
+// Number of occurrences in a TermVector
+uint32_t total_frequency(const TermVector& terms);
+
+// Euclidean norm of the term frequencies
+double term_norm(const TermVector& terms);
+
+// Scores of two TermVectors encoded against the same dictionary, each one merge pass
+
+// Number of distinct terms the two texts share
+size_t shared_term_count(const TermVector& a, const TermVector& b);
+
+// |A and B| / |A or B| over distinct terms
+double term_jaccard_similarity(const TermVector& a, const TermVector& b);
+
+// Cosine of the term frequency vectors
+double term_cosine_similarity(const TermVector& a, const TermVector& b);
+
+// Euclidean distance between the term frequency vectors
+double term_euclidean_distance(const TermVector& a, const TermVector& b);
+
+// Dot product of the term frequency vectors
+double term_dot_product(const TermVector& a, const TermVector& b);
+
+// Cosine and Euclidean distance from the precomputed norms and one sparse dot product
+double sparse_cosine_similarity(const SparseTermVector& a, const SparseTermVector& b);
+double sparse_euclidean_distance(const SparseTermVector& a, const SparseTermVector& b);
+
+// Occurrences in a of terms that b contains, divided by the longer text's length;
+// the word overlap score of the lexical vector stores
+double term_overlap_similarity(const TermVector& a, const TermVector& b);
+
+// Occurrence of a term in one document
+struct Posting {
+    uint32_t slot;            // Position of the document in its store
+    uint32_t term_frequency;  // Number of times the term occurs in the document
+};
+
+// Inverted index mapping each term to the documents that contain it.
+// Documents are identified by the slot they were added at, so a query only
+// has to visit the postings of its own terms instead of every document.
+// Terms are interned in the index's TermDictionary and postings are kept per term id.
+class InvertedIndex {
+private:
+    TermDictionary dictionary_;
+    std::vector<std::vector<Posting>> postings_;  // Indexed by term id
+    std::vector<uint32_t> document_lengths_;
+    TermVector scratch_;
+
+public:
+    // Index the tokens of the next document; returns its slot
+    uint32_t add_document(const std::vector<std::string_view>& tokens);
+
+    // Postings of a term (null when no document contains it)
+    const std::vector<Posting>* get_postings(std::string_view term) const;
+    const std::vector<Posting>* get_postings(TermId term) const;
+
+    // Dictionary of the indexed terms, for encoding queries
+    const TermDictionary& dictionary() const;
+
+    // Number of tokens in a document
+    uint32_t document_length(uint32_t slot) const;
+
+    // Number of indexed documents
+    size_t document_count() const;
+
+    // Number of distinct terms
+    size_t term_count() const;
+
+    // Remove all documents
+    void clear();
+};
+
+} // namespace langchain
+
+#endif // LANGCHAIN_TEXT_INDEX_H
@@ -0,0 +1,52 @@
+#ifndef LANGCHAIN_THREAD_POOL_H
+#define LANGCHAIN_THREAD_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace langchain {
+
+// Fixed set of worker threads for data-parallel work such as partitioned scans.
+// parallel_for lets the calling thread take part and only waits for the tasks
+// themselves, so it is safe to call from a worker or while the pool is busy.
+class ThreadPool {
+private:
+    std::vector<std::thread> workers_;
+    std::deque<std::function<void()>> queue_;
+    std::mutex mutex_;
+    std::condition_variable available_;
+    bool stopping_;
+
+public:
+    // Start a number of worker threads (0 runs everything on the calling thread)
+    explicit ThreadPool(size_t threads);
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Pool shared by the library, with one worker per hardware thread besides the caller
+    static ThreadPool& shared();
+
+    // Number of worker threads
+    size_t size() const { return workers_.size(); }
+
+    // Run task(0) .. task(count - 1) on the workers and the calling thread; returns when all are done.
+    // If a task throws, tasks not yet started are skipped and the first exception is rethrown
+    // on the calling thread once every running task has finished.
+    void parallel_for(size_t count, const std::function<void(size_t)>& task);
+
+private:
+    // Worker loop
+    void run();
+};
+
+} // namespace langchain
+
+#endif // LANGCHAIN_THREAD_POOL_H
@@ -0,0 +1,62 @@
+#ifndef LANGCHAIN_TOKENIZER_H
+#define LANGCHAIN_TOKENIZER_H
+
+#include "core.h"
+#include <cstdint>
+#include <string_view>
+
+namespace langchain {
+
+// How runs of CJK characters (Han, Kana, Hangul), which have no spaces between
+// words, are split into tokens
+enum class CjkSegmentation {
+    NONE,      // A run is one token, as far as the next separator (the tokens of earlier releases)
+    UNIGRAM,   // Every character is a token
+    BIGRAM     // Every pair of adjacent characters is a token; a lone character is a unigram
+};
+
+// Splits UTF-8 text into lowercase word tokens shared by every lexical scoring path.
+// Words are separated by ASCII and Unicode whitespace and by CJK and fullwidth
+// punctuation; CJK runs are cut into overlapping character bigrams by default, so
+// indexes over Chinese or Japanese text stay selective. Text is lowercased into a
+// scratch buffer that is reused between calls (ASCII through a lookup table, plus
+// Latin-1, Greek and Cyrillic capitals), and tokens are views into that buffer, so
+// tokenizing allocates nothing per token once the buffers have grown. Malformed
+// UTF-8 bytes are kept inside words as-is. A Tokenizer is not thread safe; use one
+// per thread or per call.
+class Tokenizer {
+private:
+    bool strip_punctuation_;
+    CjkSegmentation cjk_segmentation_;
+    std::vector<char> buffer_;  // Heap storage, so views survive moving the tokenizer
+    std::vector<std::string_view> tokens_;
+
+public:
+    // strip_punctuation trims ASCII punctuation from both ends of every token
+    explicit Tokenizer(bool strip_punctuation = false,
+                       CjkSegmentation cjk_segmentation = CjkSegmentation::BIGRAM);
+
+    // Split text into tokens; the views stay valid until the next call
+    const std::vector<std::string_view>& tokenize(std::string_view text);
+
+    // Tokens of the last call
+    const std::vector<std::string_view>& tokens() const;
+
+private:
+    // Emit the tokens of the CJK run starting at text[i]; returns the end of the run
+    size_t segment_cjk_run(std::string_view text, size_t i);
+
+    // Close the token [begin, end) of the buffer
+    void emit(size_t begin, size_t end);
+};
+
+// Decode the UTF-8 sequence starting at text[i] into a code point and its length in
+// bytes. Malformed or truncated sequences decode as a single byte with length 1.
+uint32_t decode_utf8(std::string_view text, size_t i, size_t& length);
+
+// Whether a code point is a Han ideograph, Hiragana, Katakana or Hangul character
+bool is_cjk_character(uint32_t code_point);
+
+} // namespace langchain
+
+#endif // LANGCHAIN_TOKENIZER_H
@@ -0,0 +1,272 @@
+#ifndef LANGCHAIN_VECTOR_MATH_H
+#define LANGCHAIN_VECTOR_MATH_H
+
+#include "core.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <new>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace langchain {
+
+// Distance metric used to compare embeddings
+enum class DistanceMetric {
+    DOT_PRODUCT,
+    COSINE,
+    EUCLIDEAN
+};
+
+// Instruction set used by the distance kernels
+enum class SimdLevel {
+    SCALAR,
+    SSE4_2,
+    AVX2,
+    AVX512
+};
+
+// Allocator handing out cache-line aligned memory for SIMD friendly buffers
+template <typename T, size_t Alignment = 64>
+struct AlignedAllocator {
+    using value_type = T;
+
+    template <typename U>
+    struct rebind {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() = default;
+
+    template <typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+    T* allocate(size_t n) {
+        size_t bytes = (n * sizeof(T) + Alignment - 1) / Alignment * Alignment;
+        void* ptr = std::aligned_alloc(Alignment, bytes);
+        if (!ptr) {
+            throw std::bad_alloc();
+        }
+        return static_cast<T*>(ptr);
+    }
+
+    void deallocate(T* ptr, size_t) {
+        std::free(ptr);
+    }
+
+    template <typename U>
+    bool operator==(const AlignedAllocator<U, Alignment>&) const { return true; }
+
+    template <typename U>
+    bool operator!=(const AlignedAllocator<U, Alignment>&) const { return false; }
+};
+
+// Contiguous row-major matrix of float vectors.
+// Rows are padded with zeros to a multiple of 16 floats so that every row starts
+// on a 64-byte boundary; the padding does not change dot products or distances.
+// A matrix can also be a read-only view over external memory (such as a memory
+// mapped file); the first modification copies the rows into owned storage.
+class VectorMatrix {
+private:
+    size_t dimension_;
+    size_t stride_;
+    size_t rows_;
+    std::vector<float, AlignedAllocator<float>> data_;
+    const float* view_;
+    std::shared_ptr<const void> view_owner_;
+
+public:
+    explicit VectorMatrix(size_t dimension = 0);
+
+    // Wrap rows laid out with stride() floats each; owner keeps the memory alive
+    static VectorMatrix view(size_t dimension, size_t rows, const float* data,
+                             std::shared_ptr<const void> owner);
+
+    // Number of meaningful floats per row
+    size_t dimension() const { return dimension_; }
+
+    // Number of floats between the starts of consecutive rows
+    size_t stride() const { return stride_; }
+
+    // Number of stored rows
+    size_t rows() const { return rows_; }
+
+    bool empty() const { return rows_ == 0; }
+
+    // Whether the rows live in external memory
+    bool is_view() const { return view_ != nullptr; }
+
+    // Access a row
+    const float* row(size_t index) const { return (view_ ? view_ : data_.data()) + index * stride_; }
+
+    // Access a row for writing (copies a view into owned storage first)
+    float* mutable_row(size_t index);
+
+    // All rows as one contiguous block of rows() * stride() floats
+    const float* data() const { return view_ ? view_ : data_.data(); }
+
+    // Reserve capacity for a number of rows
+    void reserve(size_t rows);
+
+    // Append a vector of dimension() floats
+    void append(const float* vector);
+
+    // Remove a row, shifting the following rows up
+    void erase(size_t index);
+
+    // Remove all rows
+    void clear();
+
+    // Bytes of owned vector data (views over external memory count as zero)
+    size_t memory_usage() const;
+
+private:
+    // Copy viewed rows into owned storage
+    void materialize();
+};
+
+// Keeps the k best (score, slot) pairs seen so far in a bounded heap.
+// Scans push every candidate's score and slot index; only the k winners are
+// ever materialized by the caller. Equal scores are ordered by lower slot first.
+class TopKCollector {
+private:
+    size_t k_;
+    std::vector<std::pair<double, uint32_t>> heap_;  // Worst candidate at the front
+
+    // Whether a ranks ahead of b
+    static bool better(const std::pair<double, uint32_t>& a, const std::pair<double, uint32_t>& b) {
+        return a.first > b.first || (a.first == b.first && a.second < b.second);
+    }
+
+public:
+    explicit TopKCollector(size_t k) : k_(k) {
+        heap_.reserve(k);
+    }
+
+    // Offer a candidate
+    void push(double score, uint32_t slot) {
+        if (k_ == 0) {
+            return;
+        }
+        std::pair<double, uint32_t> candidate(score, slot);
+        if (heap_.size() < k_) {
+            heap_.push_back(candidate);
+            std::push_heap(heap_.begin(), heap_.end(), better);
+        } else if (better(candidate, heap_.front())) {
+            std::pop_heap(heap_.begin(), heap_.end(), better);
+            heap_.back() = candidate;
+            std::push_heap(heap_.begin(), heap_.end(), better);
+        }
+    }
+
+    // Score a candidate must beat to enter a full collector (-infinity until full)
+    double threshold() const {
+        return heap_.size() < k_ ? -std::numeric_limits<double>::infinity() : heap_.front().first;
+    }
+
+    // Number of collected candidates
+    size_t size() const { return heap_.size(); }
+
+    // Maximum number of candidates kept
+    size_t capacity() const { return k_; }
+
+    // Collected candidates, best first; the collector is left empty
+    std::vector<std::pair<double, uint32_t>> take_sorted() {
+        std::sort_heap(heap_.begin(), heap_.end(), better);
+        std::vector<std::pair<double, uint32_t>> result;
+        result.swap(heap_);
+        return result;
+    }
+};
+
+// Distance kernels.
+// These dispatch at runtime to the widest instruction set the CPU supports
+// (detected through CPUID) and fall back to portable scalar code elsewhere.
+
+// Dot product of two vectors
+float dot_product(const float* a, const float* b, size_t n);
+
+// Squared Euclidean distance between two vectors
+float l2_distance_squared(const float* a, const float* b, size_t n);
+
+// Cosine similarity of two vectors (0 when either vector is zero)
+float cosine_similarity(const float* a, const float* b, size_t n);
+
+// Dot product of float weights with unsigned 8-bit codes (scalar quantized vectors)
+float dot_product_u8(const float* weights, const uint8_t* codes, size_t n);
+
+// Dot product and squared Euclidean distance of a float vector with a vector stored as
+// IEEE half precision (f16) or bfloat16 (bf16). Elements are widened to float inside
+// the kernel (F16C / AVX-512 conversions) and accumulated in float.
+float dot_product_f16(const float* a, const uint16_t* b, size_t n);
+float l2_distance_squared_f16(const float* a, const uint16_t* b, size_t n);
+float dot_product_bf16(const float* a, const uint16_t* b, size_t n);
+float l2_distance_squared_bf16(const float* a, const uint16_t* b, size_t n);
+
+// Number of differing bits between two bit strings of 64-bit words (binary quantized vectors).
+// Uses POPCNT, or VPOPCNTDQ at the AVX-512 level on CPUs that have it.
+uint32_t hamming_distance(const uint64_t* a, const uint64_t* b, size_t words);
+
+// Scalar reference implementations of the kernels
+float dot_product_scalar(const float* a, const float* b, size_t n);
+float l2_distance_squared_scalar(const float* a, const float* b, size_t n);
+float cosine_similarity_scalar(const float* a, const float* b, size_t n);
+float dot_product_u8_scalar(const float* weights, const uint8_t* codes, size_t n);
+uint32_t hamming_distance_scalar(const uint64_t* a, const uint64_t* b, size_t words);
+float dot_product_f16_scalar(const float* a, const uint16_t* b, size_t n);
+float l2_distance_squared_f16_scalar(const float* a, const uint16_t* b, size_t n);
+float dot_product_bf16_scalar(const float* a, const uint16_t* b, size_t n);
+float l2_distance_squared_bf16_scalar(const float* a, const uint16_t* b, size_t n);
+
+// Conversions between float and the 16-bit storage formats (round to nearest even)
+uint16_t float_to_f16(float value);
+float f16_to_float(uint16_t value);
+uint16_t float_to_bf16(float value);
+float bf16_to_float(uint16_t value);
+
+// Widest instruction set supported by the running CPU
+SimdLevel detect_simd_level();
+
+// Instruction set currently used by the kernels
+SimdLevel get_simd_level();
+
+// Switch the kernels to an instruction set, clamped to what the CPU supports.
+// Returns the level actually selected.
+SimdLevel set_simd_level(SimdLevel level);
+
+// Human readable name of an instruction set
+const char* simd_level_name(SimdLevel level);
+
+// Scale a vector to unit length in place (zero vectors are left untouched)
+void normalize(float* vector, size_t n);
+
+// Similarity score (higher is more similar) of two vectors under a metric.
+// COSINE assumes both vectors have already been normalized.
+double similarity_score(DistanceMetric metric, const float* a, const float* b, size_t n);
+
+// Pick up to k candidates by maximal marginal relevance, maximizing
+// lambda * relevance - (1 - lambda) * (highest similarity to an already picked candidate).
+// The first pick is the most relevant candidate. Each candidate's redundancy is updated
+// against the newest pick only, so selection costs O(k * candidates) similarities.
+// Returns indices into vectors in pick order.
+std::vector<size_t> select_mmr(DistanceMetric metric, const std::vector<const float*>& vectors,
+                               const std::vector<double>& relevance, size_t dimension,
+                               size_t k, double lambda);
+
+// Train up to k centroids over the rows of a matrix with mini-batch k-means.
+// Centroids start from a random sample of rows and are updated with per-centroid
+// learning rates. Spherical k-means keeps centroids at unit length and assigns by
+// inner product, which suits normalized (cosine) data.
+VectorMatrix train_kmeans(const VectorMatrix& data, size_t k, size_t iterations = 25,
+                          size_t batch_size = 1024, bool spherical = false, unsigned int seed = 42);
+
+// Index of the centroid closest to a vector (by inner product when spherical)
+size_t nearest_centroid(const VectorMatrix& centroids, const float* vector, bool spherical);
+
+} // namespace langchain
+
+#endif // LANGCHAIN_VECTOR_MATH_H
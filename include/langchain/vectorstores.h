@@ -2,12 +2,21 @@
 #define LANGCHAIN_VECTORSTORES_H
 
 #include "core.h"
+#include "metadata_index.h"
+#include "text_index.h"
+#include "thread_pool.h"
+#include "vector_math.h"
 #include <cmath>
 #include <algorithm>
+#include <atomic>
 #include <random>
 #include <chrono>
 #include <fstream>
+#include <mutex>
+#include <shared_mutex>
 #include <sstream>
+#include <thread>
+#include <unordered_map>
 
 namespace langchain {
 
@@ -55,19 +64,70 @@ private:
     size_t find_best_sentence_boundary(const std::vector<size_t>& boundaries, size_t start, size_t target_end) const;
 };
 
-// Simple in-memory vector store implementation
+// Simple in-memory vector store implementation.
+// Without an embedding model documents are ranked by word overlap, scored from an
+// inverted index so a query only visits documents sharing one of its words; with one,
+// their embeddings are kept in a contiguous VectorMatrix and ranked by vector similarity.
+// Documents are found by ID through a hash index, and metadata filters are resolved
+// through an attribute index before any document is scored. Deletes leave tombstones that are
+// skipped by searches; once enough accumulate, storage is repacked in the background
+// while searches keep running and only the final swap briefly blocks them.
+// Exact searches over large stores are split into cache-sized partitions scored on
+// the shared ThreadPool.
 class InMemoryVectorStore : public VectorStore {
 private:
+    // Searches share the lock; writes and the compaction swap take it exclusively
+    mutable std::shared_mutex mutex_;
     std::vector<Document> documents_;
-    std::vector<String> ids_;
+    std::vector<uint8_t> deleted_;
+    std::unordered_map<String, uint32_t> id_to_slot_;
+    size_t deleted_count_;
+    std::shared_ptr<Embeddings> embeddings_;
+    DistanceMetric metric_;
+    VectorMatrix vectors_;
+    InvertedIndex text_index_;
+    MetadataIndex metadata_index_;
     std::mt19937 rng_;
 
+    // Background compaction
+    double compaction_threshold_;
+    std::mutex compaction_mutex_;
+    std::thread compaction_thread_;
+    std::atomic<bool> compaction_running_;
+
+    // Stores with at least this many slots scan vectors in parallel (0 disables it)
+    size_t parallel_threshold_;
+    std::shared_ptr<ThreadPool> thread_pool_;  // Null uses ThreadPool::shared()
+
+    // Tombstones needed before compaction is considered
+    static constexpr size_t MIN_COMPACTION_TOMBSTONES = 64;
+
+    // Bytes of stored vectors scored against every query of a batch before moving on
+    static constexpr size_t BATCH_BLOCK_BYTES = 128 * 1024;
+
+    // Bytes of stored vectors in one partition of a parallel scan
+    static constexpr size_t SCAN_PARTITION_BYTES = 256 * 1024;
+
+    // Scan tasks per thread, so uneven partitions still balance
+    static constexpr size_t SCAN_TASKS_PER_THREAD = 4;
+
 public:
     InMemoryVectorStore();
 
-    // Add documents to the vector store
+    // Create a store that ranks documents by embedding similarity
+    explicit InMemoryVectorStore(std::shared_ptr<Embeddings> embeddings,
+                                 DistanceMetric metric = DistanceMetric::COSINE);
+
+    ~InMemoryVectorStore() override;
+
+    // Add documents to the vector store; adding an existing ID replaces the document.
+    // Throws std::runtime_error if the embedding model does not return one vector per document
     StringList add_documents(const std::vector<Document>& documents) override;
 
+    // Add documents with embeddings computed by the same model
+    StringList add_embedded_documents(const std::vector<Document>& documents,
+                                      const std::vector<Embedding>& embeddings) override;
+
     // Search for similar documents based on content similarity
     std::vector<Document> similarity_search(const String& query, int k = 4) override;
 
@@ -75,6 +135,18 @@ public:
     std::vector<std::pair<Document, double>> similarity_search_with_score(
         const String& query, int k = 4) override;
 
+    // Search only documents matching a metadata filter; exact however selective it is
+    std::vector<std::pair<Document, double>> similarity_search_with_filter(
+        const String& query, int k, const MetadataFilter& filter) override;
+
+    // Diversify the fetch_k most similar documents by MMR, reusing their stored vectors
+    std::vector<Document> max_marginal_relevance_search(const String& query, int k = 4,
+                                                        int fetch_k = 20, double lambda_mult = 0.5) override;
+
+    // Search for several queries in one cache-blocked pass over the stored vectors, with scores
+    std::vector<std::vector<std::pair<Document, double>>> similarity_search_batch_with_score(
+        const StringList& queries, int k = 4) override;
+
     // Delete documents by IDs
     void delete_documents(const StringList& ids) override;
 
@@ -84,15 +156,67 @@ public:
     // Get all documents
     std::vector<Document> get_all_documents() const;
 
+    // Get the embedding model (null for word overlap stores)
+    std::shared_ptr<Embeddings> get_embeddings() const;
+
+    // Get the distance metric used for embedding similarity
+    DistanceMetric get_metric() const;
+
+    // Number of live documents
+    size_t size() const;
+
+    // Number of deleted documents still occupying storage
+    size_t tombstone_count() const;
+
+    // Fraction of tombstoned slots that starts a background compaction (0 disables it)
+    void set_compaction_threshold(double threshold);
+
+    // Number of slots from which a query scans vectors on the shared thread pool (0 disables it)
+    void set_parallel_threshold(size_t documents);
+
+    // Run parallel scans on a dedicated pool instead of the shared one (null restores it)
+    void set_thread_pool(std::shared_ptr<ThreadPool> pool);
+
+    // Repack storage without tombstones; searches keep running until the final swap
+    void compact();
+
+    // Write live documents, IDs, metadata and vectors to a versioned file with checksums
+    bool save(const String& path) const;
+
+    // Open a saved store. The vector block is memory mapped read-only, so opening is
+    // cheap and pages are shared between processes until the store is first modified.
+    // Vector stores need the embedding model they were built with. Returns null if the
+    // file is missing, corrupt or incompatible.
+    static std::shared_ptr<InMemoryVectorStore> open(const String& path,
+                                                     std::shared_ptr<Embeddings> embeddings = nullptr,
+                                                     bool verify_vectors = false);
+
 private:
     // Generate a random ID
     String generate_id();
 
-    // Calculate similarity between two strings (simple implementation)
-    double calculate_similarity(const String& str1, const String& str2);
+    // Embed a query and prepare it for scoring against the stored vectors
+    Embedding embed_query(const String& query);
+
+    // Store a batch with its raw embeddings (empty for word overlap stores)
+    StringList insert_documents(const std::vector<Document>& documents, std::vector<Embedding> embeddings);
 
-    // Split string into words
-    StringList split_to_words(const String& str);
+    // Tombstone a slot (caller holds mutex_ exclusively)
+    void remove_slot(uint32_t slot);
+
+    // Start a background compaction when tombstones pass the threshold (caller holds mutex_)
+    void maybe_schedule_compaction();
+
+    // Rank documents for one query, optionally restricted to a metadata filter
+    std::vector<std::pair<Document, double>> search(const String& query, int k, const MetadataFilter* filter);
+
+    // Score live vectors (all slots, or only the sorted candidates) in parallel for large stores
+    void scan_vectors(const float* query_vector, TopKCollector& top_k,
+                      const std::vector<uint32_t>* candidates = nullptr) const;
+
+    // Score documents sharing words with the query by word overlap
+    void lexical_search(const String& query, TopKCollector& top_k,
+                        const std::vector<uint32_t>* candidates = nullptr) const;
 };
 
 // RAG (Retrieval-Augmented Generation) chain
@@ -105,14 +229,22 @@ private:
 public:
     RAGChain(std::shared_ptr<VectorStore> vector_store, std::shared_ptr<LLM> llm);
 
-    // Add documents to the RAG chain
+    // Add documents to the RAG chain, split in input order; throws std::runtime_error
+    // if any document or chunk could not be stored
     void add_documents(const std::vector<Document>& documents);
 
     // Query the RAG chain
     String query(const String& question);
 
+    // Answer several questions, retrieving context for all of them in one batched search
+    StringList query_batch(const StringList& questions);
+
     // Set text splitter
     void set_text_splitter(std::shared_ptr<TextSplitter> text_splitter);
+
+private:
+    // Build the answer prompt from retrieved documents
+    String build_prompt(const String& question, const std::vector<Document>& documents) const;
 };
 
 } // namespace langchain
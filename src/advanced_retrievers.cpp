@@ -1,14 +1,38 @@
 #include "../include/langchain/advanced_retrievers.h"
+#include "../include/langchain/thread_pool.h"
+#include "../include/langchain/vector_math.h"
 #include <algorithm>
 #include <cmath>
+#include <exception>
 #include <set>
 #include <sstream>
+#include <string_view>
+#include <unordered_map>
 
 namespace langchain {
 
+namespace {
+
+// Rank offset of reciprocal rank fusion; damps the weight of the very first ranks
+const double RRF_RANK_OFFSET = 60.0;
+
+// A document of one hybrid search leg, referenced instead of copied
+struct RankedDocument {
+    Document* document;
+    double score;
+};
+
+// Per-thread tokenizer, so scoring reuses its buffers
+Tokenizer& scoring_tokenizer() {
+    thread_local Tokenizer tokenizer;
+    return tokenizer;
+}
+
+} // namespace
+
 // AdvancedRetriever implementation
 AdvancedRetriever::AdvancedRetriever(std::shared_ptr<VectorStore> vector_store, SimilarityAlgorithm algorithm)
-    : vector_store_(vector_store), algorithm_(algorithm) {}
+    : vector_store_(vector_store), algorithm_(algorithm), fusion_method_(FusionMethod::RECIPROCAL_RANK) {}
 
 void AdvancedRetriever::set_custom_similarity_function(std::function<double(const String&, const String&)> fn) {
     custom_similarity_fn_ = fn;
@@ -28,259 +52,301 @@ std::vector<Document> AdvancedRetriever::search(const String& query, int k,
 std::vector<std::pair<Document, double>> AdvancedRetriever::search_with_scores(const String& query, int k,
                                                                               const std::map<String, String>& filters,
                                                                               double threshold) {
-    // Retrieve documents from vector store using similarity search
-    // We retrieve more documents than needed to account for filtering
-    auto all_documents = vector_store_->similarity_search(query, k * 10);
-
-    // Calculate similarity scores for all documents
-    std::vector<std::pair<Document, double>> similarities;
+    std::vector<std::pair<Document, double>> results;
+    if (k <= 0) {
+        return results;
+    }
 
-    // Filter documents based on metadata
-    auto filtered_documents = filter_documents(all_documents, filters);
+    // Retrieve candidates to rerank from the vector store; the store applies the
+    // metadata filters before scoring, so every candidate already matches them
+    auto candidates = vector_store_->similarity_search_with_filter(query, k * 10, filters);
+
+    // Encode the query once; built-in algorithms then only merge term id arrays
+    ScoringVectors vectors;
+    if (!custom_similarity_fn_) {
+        std::vector<const Document*> documents;
+        documents.reserve(candidates.size());
+        for (const auto& candidate : candidates) {
+            documents.push_back(&candidate.first);
+        }
+        encode_for_scoring(query, documents, vectors);
+    }
 
-    // Calculate similarity scores for filtered documents
-    for (const auto& doc : filtered_documents) {
-        double score = 0.0;
+    // Score candidates in place, keeping only indices of the best k
+    TopKCollector top_k(static_cast<size_t>(k));
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        const Document& doc = candidates[i].first;
 
         // Use custom similarity function if provided
+        double score;
         if (custom_similarity_fn_) {
             score = custom_similarity_fn_(query, doc.content);
         } else {
-            score = calculate_similarity(query, doc.content);
+            score = calculate_similarity(vectors, *vectors.documents[i]);
         }
 
         // Only include documents above threshold
         if (score >= threshold) {
-            similarities.push_back({doc, score});
+            top_k.push(score, static_cast<uint32_t>(i));
         }
     }
 
-    // Sort by similarity score (descending)
-    std::sort(similarities.begin(), similarities.end(),
-              [](const auto& a, const auto& b) {
-                  return a.second > b.second;
-              });
-
-    // Return top k results
-    if (static_cast<size_t>(k) < similarities.size()) {
-        similarities.resize(k);
+    // Move the winners out instead of copying them
+    for (const auto& candidate : top_k.take_sorted()) {
+        results.push_back({std::move(candidates[candidate.second].first), candidate.first});
     }
-
-    return similarities;
+    return results;
 }
 
 std::vector<Document> AdvancedRetriever::hybrid_search(const String& query, int k,
                                                       const std::map<String, String>& filters,
                                                       double keyword_weight,
                                                       double semantic_weight) {
-    // This is a simplified hybrid search implementation
-    // In a real implementation, this would combine keyword search and semantic search
-
-    // For now, we'll just use the semantic search with adjusted weights
-    return search(query, k, filters);
-}
-
-void AdvancedRetriever::set_similarity_algorithm(SimilarityAlgorithm algorithm) {
-    algorithm_ = algorithm;
+    std::vector<Document> results;
+    for (auto& result : hybrid_search_with_scores(query, k, filters, keyword_weight, semantic_weight)) {
+        results.push_back(std::move(result.first));
+    }
+    return results;
 }
 
-std::vector<Document> AdvancedRetriever::filter_documents(const std::vector<Document>& documents,
-                                                         const std::map<String, String>& filters) {
-    if (filters.empty()) {
-        return documents;
+std::vector<std::pair<Document, double>> AdvancedRetriever::hybrid_search_with_scores(
+    const String& query, int k, const std::map<String, String>& filters,
+    double keyword_weight, double semantic_weight) {
+    std::vector<std::pair<Document, double>> results;
+    if (k <= 0) {
+        return results;
     }
 
-    std::vector<Document> filtered;
-    for (const auto& doc : documents) {
-        bool match = true;
-        for (const auto& filter : filters) {
-            auto it = doc.metadata.find(filter.first);
-            if (it == doc.metadata.end() || it->second != filter.second) {
-                match = false;
-                break;
+    // Each leg ranks a deeper list than k so the fused ranking has overlap to work with
+    int fetch_k = k * 4;
+    std::vector<std::pair<Document, double>> keyword_results;
+    std::vector<std::pair<Document, double>> semantic_results;
+    std::shared_ptr<BM25Retriever> keyword_retriever = keyword_retriever_;
+    if (keyword_retriever) {
+        // Both legs at once; the calling thread runs one of them. Each leg catches its
+        // own exception, so the other leg still finishes before the first is rethrown
+        std::exception_ptr errors[2];
+        ThreadPool::shared().parallel_for(2, [&](size_t leg) {
+            try {
+                if (leg == 0) {
+                    keyword_results = keyword_retriever->retrieve_with_filter(query, fetch_k, filters);
+                } else {
+                    semantic_results = vector_store_->similarity_search_with_filter(query, fetch_k, filters);
+                }
+            } catch (...) {
+                errors[leg] = std::current_exception();
+            }
+        });
+        for (const auto& error : errors) {
+            if (error) {
+                std::rethrow_exception(error);
             }
         }
-        if (match) {
-            filtered.push_back(doc);
-        }
+    } else {
+        semantic_results = vector_store_->similarity_search_with_filter(query, fetch_k, filters);
     }
-    return filtered;
-}
 
-double AdvancedRetriever::calculate_similarity(const String& str1, const String& str2) {
-    switch (algorithm_) {
-        case SimilarityAlgorithm::COSINE:
-            return cosine_similarity(str1, str2);
-        case SimilarityAlgorithm::JACCARD:
-            return jaccard_similarity(str1, str2);
-        case SimilarityAlgorithm::EUCLIDEAN:
-            return euclidean_similarity(str1, str2);
-        case SimilarityAlgorithm::BM25:
-            return bm25_similarity(str1, str2);
-        default:
-            return cosine_similarity(str1, str2);
+    std::vector<RankedDocument> keyword_ranking;
+    std::vector<RankedDocument> semantic_ranking;
+    for (auto& result : keyword_results) {
+        keyword_ranking.push_back({&result.first, result.second});
     }
-}
-
-double AdvancedRetriever::cosine_similarity(const String& str1, const String& str2) {
-    auto words1 = split_to_words_with_frequency(str1);
-    auto words2 = split_to_words_with_frequency(str2);
-
-    // Get all unique words
-    std::set<String> all_words;
-    for (const auto& pair : words1) {
-        all_words.insert(pair.first);
+    for (auto& result : semantic_results) {
+        semantic_ranking.push_back({&result.first, result.second});
     }
-    for (const auto& pair : words2) {
-        all_words.insert(pair.first);
+    if (!keyword_retriever) {
+        // Rank the semantic candidates by term similarity instead
+        std::vector<const Document*> documents;
+        documents.reserve(semantic_results.size());
+        for (const auto& result : semantic_results) {
+            documents.push_back(&result.first);
+        }
+        ScoringVectors vectors;
+        encode_for_scoring(query, documents, vectors);
+        for (size_t i = 0; i < semantic_results.size(); ++i) {
+            keyword_ranking.push_back({&semantic_results[i].first,
+                                       calculate_similarity(vectors, *vectors.documents[i])});
+        }
+        std::stable_sort(keyword_ranking.begin(), keyword_ranking.end(),
+                         [](const RankedDocument& a, const RankedDocument& b) { return a.score > b.score; });
     }
 
-    // Calculate dot product and magnitudes
-    double dot_product = 0.0;
-    double magnitude1 = 0.0;
-    double magnitude2 = 0.0;
-
-    for (const auto& word : all_words) {
-        int freq1 = words1[word];
-        int freq2 = words2[word];
+    // Fuse by id (content for documents without one), keeping the first copy seen
+    std::vector<RankedDocument> fused;
+    std::unordered_map<std::string_view, uint32_t> positions;
+    auto fuse = [&](const std::vector<RankedDocument>& ranking, double weight) {
+        double best = ranking.empty() ? 0.0 : ranking.front().score;
+        double worst = ranking.empty() ? 0.0 : ranking.back().score;
+        for (size_t rank = 0; rank < ranking.size(); ++rank) {
+            double contribution;
+            if (fusion_method_ == FusionMethod::RECIPROCAL_RANK) {
+                contribution = weight / (RRF_RANK_OFFSET + rank + 1);
+            } else {
+                contribution = weight * (best > worst ? (ranking[rank].score - worst) / (best - worst) : 1.0);
+            }
+            const Document& document = *ranking[rank].document;
+            std::string_view key = document.id.empty() ? document.content : document.id;
+            auto inserted = positions.emplace(key, static_cast<uint32_t>(fused.size()));
+            if (inserted.second) {
+                fused.push_back({ranking[rank].document, contribution});
+            } else {
+                fused[inserted.first->second].score += contribution;
+            }
+        }
+    };
+    fuse(keyword_ranking, keyword_weight);
+    fuse(semantic_ranking, semantic_weight);
 
-        dot_product += freq1 * freq2;
-        magnitude1 += freq1 * freq1;
-        magnitude2 += freq2 * freq2;
+    TopKCollector top_k(static_cast<size_t>(k));
+    for (size_t i = 0; i < fused.size(); ++i) {
+        top_k.push(fused[i].score, static_cast<uint32_t>(i));
     }
-
-    if (magnitude1 == 0.0 || magnitude2 == 0.0) {
-        return 0.0;
+    for (const auto& entry : top_k.take_sorted()) {
+        results.push_back({std::move(*fused[entry.second].document), entry.first});
     }
-
-    return dot_product / (std::sqrt(magnitude1) * std::sqrt(magnitude2));
+    return results;
 }
 
-double AdvancedRetriever::jaccard_similarity(const String& str1, const String& str2) {
-    auto words1 = split_to_words_with_frequency(str1);
-    auto words2 = split_to_words_with_frequency(str2);
-
-    std::set<String> set1, set2;
-    for (const auto& pair : words1) {
-        set1.insert(pair.first);
-    }
-    for (const auto& pair : words2) {
-        set2.insert(pair.first);
-    }
+void AdvancedRetriever::set_keyword_retriever(std::shared_ptr<BM25Retriever> keyword_retriever) {
+    keyword_retriever_ = keyword_retriever;
+}
 
-    // Calculate intersection and union
-    std::set<String> intersection;
-    std::set<String> Union;  // Union is a reserved keyword, so we use Union
+void AdvancedRetriever::set_fusion_method(FusionMethod fusion_method) {
+    fusion_method_ = fusion_method;
+}
 
-    std::set_intersection(set1.begin(), set1.end(), set2.begin(), set2.end(),
-                         std::inserter(intersection, intersection.begin()));
-    std::set_union(set1.begin(), set1.end(), set2.begin(), set2.end(),
-                  std::inserter(Union, Union.begin()));
+void AdvancedRetriever::set_similarity_algorithm(SimilarityAlgorithm algorithm) {
+    algorithm_ = algorithm;
+}
 
-    if (Union.empty()) {
-        return 0.0;
+void AdvancedRetriever::add_documents(const std::vector<Document>& documents) {
+    Tokenizer& tokenizer = scoring_tokenizer();
+    std::unique_lock<std::shared_mutex> lock(dictionary_mutex_);
+    for (const auto& document : documents) {
+        if (!document.id.empty()) {
+            // Searches may still hold the vector being replaced
+            auto entry = std::make_shared<DocumentTerms>();
+            dictionary_.encode(tokenizer.tokenize(document.content), entry->vector.terms);
+            entry->vector.norm = term_norm(entry->vector.terms);
+            entry->content_hash = std::hash<String>()(document.content);
+            document_vectors_[document.id] = std::move(entry);
+        }
     }
-
-    return static_cast<double>(intersection.size()) / Union.size();
 }
 
-double AdvancedRetriever::euclidean_similarity(const String& str1, const String& str2) {
-    auto words1 = split_to_words_with_frequency(str1);
-    auto words2 = split_to_words_with_frequency(str2);
-
-    // Get all unique words
-    std::set<String> all_words;
-    for (const auto& pair : words1) {
-        all_words.insert(pair.first);
+void AdvancedRetriever::remove_documents(const StringList& ids) {
+    std::unique_lock<std::shared_mutex> lock(dictionary_mutex_);
+    for (const auto& id : ids) {
+        document_vectors_.erase(id);
     }
-    for (const auto& pair : words2) {
-        all_words.insert(pair.first);
+}
+
+void AdvancedRetriever::encode_for_scoring(const String& query, const std::vector<const Document*>& documents,
+                                           ScoringVectors& vectors) const {
+    // Content hashes tell a precomputed vector from one left behind by a reused id
+    std::vector<size_t> content_hashes(documents.size(), 0);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        if (!documents[i]->id.empty()) {
+            content_hashes[i] = std::hash<String>()(documents[i]->content);
+        }
     }
 
-    // Calculate Euclidean distance
-    double distance_squared = 0.0;
-    for (const auto& word : all_words) {
-        int freq1 = words1[word];
-        int freq2 = words2[word];
-        int diff = freq1 - freq2;
-        distance_squared += diff * diff;
+    Tokenizer& tokenizer = scoring_tokenizer();
+    std::shared_lock<std::shared_mutex> lock(dictionary_mutex_);
+    TermOverlay overlay(dictionary_);
+    overlay.encode(tokenizer.tokenize(query), vectors.query.terms);
+    vectors.query.norm = term_norm(vectors.query.terms);
+    std::shared_ptr<BM25Retriever> keyword_retriever = keyword_retriever_;
+    if (algorithm_ == SimilarityAlgorithm::BM25 && keyword_retriever) {
+        std::vector<std::string_view> terms;
+        for (const auto& entry : vectors.query.terms) {
+            terms.push_back(overlay.term(entry.term));
+        }
+        vectors.idf = keyword_retriever->inverse_document_frequencies(terms);
+        vectors.average_length = keyword_retriever->average_document_length();
+        vectors.bm25_config = keyword_retriever->config();
     }
 
-    double distance = std::sqrt(distance_squared);
+    vectors.documents.clear();
+    vectors.documents.reserve(documents.size());
+    for (size_t i = 0; i < documents.size(); ++i) {
+        const Document* document = documents[i];
+        if (!document->id.empty()) {
+            auto it = document_vectors_.find(document->id);
+            if (it != document_vectors_.end() && it->second->content_hash == content_hashes[i]) {
+                vectors.documents.push_back(std::shared_ptr<const SparseTermVector>(it->second, &it->second->vector));
+                continue;
+            }
+        }
+        auto vector = std::make_shared<SparseTermVector>();
+        overlay.encode(tokenizer.tokenize(document->content), vector->terms);
+        vector->norm = term_norm(vector->terms);
+        vectors.documents.push_back(std::move(vector));
+    }
+}
 
-    // Convert distance to similarity (higher distance = lower similarity)
-    // Add 1 to avoid division by zero
-    return 1.0 / (1.0 + distance);
+double AdvancedRetriever::calculate_similarity(const ScoringVectors& vectors,
+                                               const SparseTermVector& document_vector) const {
+    const SparseTermVector& query_vector = vectors.query;
+    switch (algorithm_) {
+        case SimilarityAlgorithm::COSINE:
+            return sparse_cosine_similarity(query_vector, document_vector);
+        case SimilarityAlgorithm::JACCARD:
+            return term_jaccard_similarity(query_vector.terms, document_vector.terms);
+        case SimilarityAlgorithm::EUCLIDEAN:
+            // Convert distance to similarity (higher distance = lower similarity)
+            // Add 1 to avoid division by zero
+            return 1.0 / (1.0 + sparse_euclidean_distance(query_vector, document_vector));
+        case SimilarityAlgorithm::BM25:
+            return bm25_similarity(vectors, document_vector.terms);
+        case SimilarityAlgorithm::OVERLAP:
+            return term_overlap_similarity(query_vector.terms, document_vector.terms);
+        default:
+            return sparse_cosine_similarity(query_vector, document_vector);
+    }
 }
 
-double AdvancedRetriever::bm25_similarity(const String& query, const String& document) {
-    // Simplified BM25 implementation
-    // In a real implementation, this would be more complex and consider document frequency
+double AdvancedRetriever::bm25_similarity(const ScoringVectors& vectors, const TermVector& document_terms) const {
+    const TermVector& query_terms = vectors.query.terms;
+    bool corpus = !vectors.idf.empty();
 
-    auto query_words = split_to_words_with_frequency(query);
-    auto doc_words = split_to_words_with_frequency(document);
+    // Without corpus statistics: fixed parameters and average length, and the
+    // document's distinct terms as its length
+    double k1 = corpus ? vectors.bm25_config.k1 : 1.5;
+    double b = corpus ? vectors.bm25_config.b : 0.75;
+    double avg_doc_length = corpus ? vectors.average_length : 100.0;
+    double doc_length = corpus ? total_frequency(document_terms) : document_terms.size();
+    double length_ratio = avg_doc_length > 0.0 ? doc_length / avg_doc_length : 0.0;
 
+    // Both term arrays are sorted by id, so one merge pass finds the shared terms
     double score = 0.0;
-    double k1 = 1.5;  // BM25 parameter
-    double b = 0.75;  // BM25 parameter
-
-    // Average document length (simplified)
-    double avg_doc_length = 100.0;  // This would be calculated from all documents
-    double doc_length = doc_words.size();
-
-    for (const auto& query_pair : query_words) {
-        const String& word = query_pair.first;
-        int query_freq = query_pair.second;
-
-        auto doc_it = doc_words.find(word);
-        if (doc_it != doc_words.end()) {
-            int doc_freq = doc_it->second;
-
-            // Simplified BM25 formula
-            double tf = static_cast<double>(doc_freq);
-            double idf = std::log(1.0 + (1.0 / (1.0 + tf)));  // Simplified IDF
+    size_t i = 0;
+    size_t j = 0;
+    while (i < query_terms.size() && j < document_terms.size()) {
+        if (query_terms[i].term < document_terms[j].term) {
+            ++i;
+        } else if (document_terms[j].term < query_terms[i].term) {
+            ++j;
+        } else {
+            double tf = static_cast<double>(document_terms[j].frequency);
+            double idf = corpus ? vectors.idf[i] : std::log(1.0 + (1.0 / (1.0 + tf)));
             double numerator = tf * (k1 + 1);
-            double denominator = tf + k1 * (1 - b + b * (doc_length / avg_doc_length));
-            double tf_idf = idf * (numerator / denominator);
-
-            score += tf_idf * query_freq;
+            double denominator = tf + k1 * (1 - b + b * length_ratio);
+            score += idf * (numerator / denominator) * query_terms[i].frequency;
+            ++i;
+            ++j;
         }
     }
 
     return score;
 }
 
-std::map<String, int> AdvancedRetriever::split_to_words_with_frequency(const String& str) {
-    std::map<String, int> word_freq;
-    String word;
-
-    for (char c : str) {
-        if (std::isspace(c)) {
-            if (!word.empty()) {
-                // Convert to lowercase for comparison
-                std::transform(word.begin(), word.end(), word.begin(), ::tolower);
-                word_freq[word]++;
-                word.clear();
-            }
-        } else {
-            word += std::tolower(c);
-        }
-    }
-
-    if (!word.empty()) {
-        std::transform(word.begin(), word.end(), word.begin(), ::tolower);
-        word_freq[word]++;
-    }
-
-    return word_freq;
-}
-
 std::set<String> AdvancedRetriever::get_unique_words(const std::vector<String>& strings) {
     std::set<String> unique_words;
+    Tokenizer tokenizer;
     for (const auto& str : strings) {
-        auto words = split_to_words_with_frequency(str);
-        for (const auto& pair : words) {
-            unique_words.insert(pair.first);
+        for (std::string_view word : tokenizer.tokenize(str)) {
+            unique_words.emplace(word);
         }
     }
     return unique_words;
@@ -301,9 +367,8 @@ std::vector<Document> MultiQueryRetriever::retrieve(const String& query, int k)
     std::map<String, int> doc_count;
     std::map<String, Document> doc_map;
 
-    // Retrieve documents for each query
-    for (const auto& q : queries) {
-        auto docs = vector_store_->similarity_search(q, k);
+    // Retrieve documents for all queries in one batched search
+    for (const auto& docs : vector_store_->similarity_search_batch(queries, k)) {
         for (const auto& doc : docs) {
             doc_count[doc.id]++;
             doc_map[doc.id] = doc;
@@ -0,0 +1,289 @@
+#include "../include/langchain/bm25.h"
+#include "../include/langchain/tokenizer.h"
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+
+namespace langchain {
+
+namespace {
+
+const uint32_t END_OF_POSTINGS = UINT32_MAX;
+
+} // namespace
+
+// BM25Retriever implementation
+BM25Retriever::BM25Retriever(const BM25Config& config) : config_(config), total_length_(0) {
+    config_.block_size = std::max<size_t>(1, config_.block_size);
+}
+
+void BM25Retriever::add_documents(const std::vector<Document>& documents) {
+    Tokenizer tokenizer;
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    for (const auto& document : documents) {
+        uint32_t slot = static_cast<uint32_t>(documents_.size());
+        const auto& tokens = tokenizer.tokenize(document.content);
+        uint32_t length = static_cast<uint32_t>(tokens.size());
+        documents_.push_back(document);
+        document_lengths_.push_back(length);
+        total_length_ += length;
+
+        dictionary_.encode(tokens, scratch_);
+        for (const auto& entry : scratch_) {
+            if (entry.term >= terms_.size()) {
+                terms_.resize(entry.term + 1);
+            }
+            TermPostings& term = terms_[entry.term];
+            if (term.postings.size() % config_.block_size == 0) {
+                term.blocks.push_back({slot, 0, UINT32_MAX});
+            }
+            term.postings.push_back({slot, entry.frequency});
+
+            Block& block = term.blocks.back();
+            block.last_slot = slot;
+            block.max_frequency = std::max(block.max_frequency, entry.frequency);
+            block.min_length = std::min(block.min_length, length);
+            term.max_frequency = std::max(term.max_frequency, entry.frequency);
+            term.min_length = std::min(term.min_length, length);
+        }
+    }
+}
+
+std::vector<Document> BM25Retriever::retrieve(const String& query, int k) const {
+    std::vector<Document> results;
+    for (auto& result : retrieve_with_scores(query, k)) {
+        results.push_back(std::move(result.first));
+    }
+    return results;
+}
+
+std::vector<std::pair<Document, double>> BM25Retriever::retrieve_with_scores(const String& query, int k,
+                                                                             BM25SearchStats* stats) const {
+    BM25SearchStats search_stats;
+    auto results = collect(query, k, nullptr, search_stats);
+    if (stats) {
+        *stats = search_stats;
+    }
+    return results;
+}
+
+std::vector<std::pair<Document, double>> BM25Retriever::retrieve_with_filter(const String& query, int k,
+                                                                             const MetadataFilter& filter) const {
+    BM25SearchStats stats;
+    return collect(query, k, filter.empty() ? nullptr : &filter, stats);
+}
+
+size_t BM25Retriever::document_count() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return documents_.size();
+}
+
+double BM25Retriever::average_document_length() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return documents_.empty() ? 0.0 : static_cast<double>(total_length_) / documents_.size();
+}
+
+size_t BM25Retriever::document_frequency(const String& term) const {
+    Tokenizer tokenizer;
+    const auto& tokens = tokenizer.tokenize(term);
+    if (tokens.size() != 1) {
+        return 0;
+    }
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    TermId id = dictionary_.find(tokens[0]);
+    return id < terms_.size() ? terms_[id].postings.size() : 0;
+}
+
+std::vector<double> BM25Retriever::inverse_document_frequencies(const std::vector<std::string_view>& terms) const {
+    std::vector<double> weights;
+    weights.reserve(terms.size());
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    for (std::string_view term : terms) {
+        TermId id = dictionary_.find(term);
+        weights.push_back(idf(id < terms_.size() ? terms_[id].postings.size() : 0));
+    }
+    return weights;
+}
+
+void BM25Retriever::clear() {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    dictionary_.clear();
+    terms_.clear();
+    documents_.clear();
+    document_lengths_.clear();
+    total_length_ = 0;
+}
+
+double BM25Retriever::idf(size_t document_frequency) const {
+    double n = static_cast<double>(documents_.size());
+    double df = static_cast<double>(document_frequency);
+    return std::log(1.0 + (n - df + 0.5) / (df + 0.5));
+}
+
+double BM25Retriever::term_score(uint32_t frequency, uint32_t length, double average_length) const {
+    double tf = static_cast<double>(frequency);
+    double norm = 1.0 - config_.b + config_.b * (average_length > 0.0 ? length / average_length : 0.0);
+    return tf * (config_.k1 + 1.0) / (tf + config_.k1 * norm);
+}
+
+std::vector<std::pair<Document, double>> BM25Retriever::collect(const String& query, int k,
+                                                                const MetadataFilter* filter,
+                                                                BM25SearchStats& stats) const {
+    std::vector<std::pair<Document, double>> results;
+    if (k <= 0) {
+        return results;
+    }
+    Tokenizer tokenizer;
+    const auto& tokens = tokenizer.tokenize(query);
+
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    TermVector query_terms;
+    dictionary_.lookup(tokens, query_terms);
+    TopKCollector top_k(static_cast<size_t>(k));
+    search(query_terms, top_k, filter, stats);
+    for (const auto& entry : top_k.take_sorted()) {
+        results.push_back({documents_[entry.second], entry.first});
+    }
+    return results;
+}
+
+void BM25Retriever::search(const TermVector& query_terms, TopKCollector& top_k, const MetadataFilter* filter,
+                           BM25SearchStats& stats) const {
+    if (documents_.empty()) {
+        return;
+    }
+    double average_length = static_cast<double>(total_length_) / documents_.size();
+
+    // Position in the postings of one query term
+    struct Cursor {
+        const TermPostings* term;
+        size_t position;
+        double weight;       // idf times the term's count in the query
+        double max_score;    // Bound on the term's score in any document
+
+        uint32_t slot() const {
+            return position < term->postings.size() ? term->postings[position].slot : END_OF_POSTINGS;
+        }
+    };
+
+    std::vector<Cursor> cursors;
+    for (const auto& entry : query_terms) {
+        const TermPostings& term = terms_[entry.term];
+        double weight = idf(term.postings.size()) * entry.frequency;
+        cursors.push_back({&term, 0, weight, weight * term_score(term.max_frequency, term.min_length, average_length)});
+        stats.postings_total += term.postings.size();
+    }
+
+    if (!config_.use_pruning) {
+        // Term at a time over every posting
+        std::vector<double> scores(documents_.size(), 0.0);
+        std::vector<uint8_t> matched(documents_.size(), 0);
+        for (const auto& cursor : cursors) {
+            for (const auto& posting : cursor.term->postings) {
+                scores[posting.slot] += cursor.weight * term_score(posting.term_frequency,
+                                                                   document_lengths_[posting.slot], average_length);
+                matched[posting.slot] = 1;
+            }
+        }
+        for (uint32_t slot = 0; slot < scores.size(); ++slot) {
+            if (matched[slot] && (!filter || matches_filter(documents_[slot].metadata, *filter))) {
+                stats.documents_scored++;
+                top_k.push(scores[slot], slot);
+            }
+        }
+        return;
+    }
+
+    auto advance_to = [](Cursor& cursor, uint32_t target) {
+        const auto& postings = cursor.term->postings;
+        cursor.position = std::lower_bound(postings.begin() + cursor.position, postings.end(), target,
+                                           [](const Posting& posting, uint32_t slot) { return posting.slot < slot; }) -
+                          postings.begin();
+    };
+
+    // Block-max MaxScore: with terms ordered by their score bound, the longest prefix
+    // whose bounds sum to no more than the k-th score is non-essential, since a document
+    // containing only those terms cannot enter the top k. Documents are enumerated from
+    // the essential terms' postings alone; non-essential terms are probed only while the
+    // block bounds around the document can still lift it past the threshold. Documents
+    // are visited in slot order, so a candidate that only ties the k-th score loses.
+    std::sort(cursors.begin(), cursors.end(),
+              [](const Cursor& a, const Cursor& b) { return a.max_score < b.max_score; });
+    std::vector<double> prefix_bounds(cursors.size());
+    double bound_sum = 0.0;
+    for (size_t i = 0; i < cursors.size(); ++i) {
+        bound_sum += cursors[i].max_score;
+        prefix_bounds[i] = bound_sum;
+    }
+    std::vector<size_t> blocks(cursors.size(), 0);  // Shallow block position per cursor
+
+    size_t essential = 0;  // Cursors [essential, size) are essential
+    double threshold = top_k.threshold();
+    while (essential < cursors.size() && prefix_bounds[essential] <= threshold) {
+        essential++;
+    }
+    while (essential < cursors.size()) {
+        uint32_t slot = END_OF_POSTINGS;
+        for (size_t i = essential; i < cursors.size(); ++i) {
+            slot = std::min(slot, cursors[i].slot());
+        }
+        if (slot == END_OF_POSTINGS) {
+            break;
+        }
+        if (filter && !matches_filter(documents_[slot].metadata, *filter)) {
+            for (size_t i = essential; i < cursors.size(); ++i) {
+                if (cursors[i].slot() == slot) {
+                    cursors[i].position++;
+                }
+            }
+            continue;
+        }
+
+        uint32_t length = document_lengths_[slot];
+        double score = 0.0;
+        for (size_t i = essential; i < cursors.size(); ++i) {
+            if (cursors[i].slot() == slot) {
+                const Posting& posting = cursors[i].term->postings[cursors[i].position];
+                score += cursors[i].weight * term_score(posting.term_frequency, length, average_length);
+                cursors[i].position++;
+            }
+        }
+
+        // Bound the non-essential terms by the blocks that could hold this slot
+        double block_bound = score;
+        for (size_t i = 0; i < essential; ++i) {
+            const auto& term_blocks = cursors[i].term->blocks;
+            while (blocks[i] < term_blocks.size() && term_blocks[blocks[i]].last_slot < slot) {
+                blocks[i]++;
+            }
+            if (blocks[i] < term_blocks.size()) {
+                const Block& block = term_blocks[blocks[i]];
+                block_bound += cursors[i].weight * term_score(block.max_frequency, block.min_length, average_length);
+            }
+        }
+        if (block_bound <= threshold) {
+            continue;
+        }
+
+        // Probe non-essential terms, largest bound first, while the document can still qualify
+        size_t i = essential;
+        while (i > 0 && score + prefix_bounds[i - 1] > threshold) {
+            --i;
+            advance_to(cursors[i], slot);
+            if (cursors[i].slot() == slot) {
+                const Posting& posting = cursors[i].term->postings[cursors[i].position];
+                score += cursors[i].weight * term_score(posting.term_frequency, length, average_length);
+            }
+        }
+        stats.documents_scored++;
+        if (score > threshold) {
+            top_k.push(score, slot);
+            threshold = top_k.threshold();
+            while (essential < cursors.size() && prefix_bounds[essential] <= threshold) {
+                essential++;
+            }
+        }
+    }
+}
+
+} // namespace langchain
@@ -0,0 +1,391 @@
+#include "../include/langchain/concurrent_vectorstore.h"
+#include "../include/langchain/tokenizer.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+
+namespace langchain {
+
+ConcurrentVectorStore::Segment::Segment(size_t dimension) : vectors(dimension) {}
+
+// ConcurrentVectorStore implementation
+ConcurrentVectorStore::ConcurrentVectorStore()
+    : metric_(DistanceMetric::COSINE),
+      snapshot_(std::make_shared<const Snapshot>()),
+      rng_(std::chrono::steady_clock::now().time_since_epoch().count()) {}
+
+ConcurrentVectorStore::ConcurrentVectorStore(std::shared_ptr<Embeddings> embeddings, DistanceMetric metric)
+    : embeddings_(embeddings), metric_(metric),
+      snapshot_(std::make_shared<const Snapshot>()),
+      rng_(std::chrono::steady_clock::now().time_since_epoch().count()) {}
+
+StringList ConcurrentVectorStore::add_documents(const std::vector<Document>& documents) {
+    // Embedding and tokenizing need no lock at all
+    std::vector<Embedding> embeddings;
+    std::vector<Tokenizer> tokenizers;
+    if (embeddings_) {
+        StringList texts;
+        texts.reserve(documents.size());
+        for (const auto& doc : documents) {
+            texts.push_back(doc.content);
+        }
+        embeddings = embeddings_->embed_documents(texts);
+        if (embeddings.size() != documents.size()) {
+            throw std::runtime_error("ConcurrentVectorStore: embedding model returned " +
+                                     std::to_string(embeddings.size()) + " vectors for " +
+                                     std::to_string(documents.size()) + " documents");
+        }
+        for (auto& embedding : embeddings) {
+            embedding.resize(embeddings_->dimension(), 0.0f);
+            if (metric_ == DistanceMetric::COSINE) {
+                normalize(embedding.data(), embedding.size());
+            }
+        }
+    } else {
+        tokenizers.resize(documents.size());
+        for (size_t i = 0; i < documents.size(); ++i) {
+            tokenizers[i].tokenize(documents[i].content);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    auto current = load_snapshot();
+    Snapshot next = *current;
+
+    // Build the delta segment; a repeated ID inside the batch keeps its last document
+    auto segment = std::make_shared<Segment>(embeddings_ ? embeddings_->dimension() : 0);
+    auto segment_deleted = std::make_shared<std::vector<uint8_t>>(documents.size(), 0);
+    size_t segment_deleted_count = 0;
+    std::vector<std::shared_ptr<std::vector<uint8_t>>> copied(next.segments.size());
+    segment->documents.reserve(documents.size());
+    if (embeddings_) {
+        segment->vectors.reserve(documents.size());
+    }
+
+    StringList new_ids;
+    for (size_t i = 0; i < documents.size(); ++i) {
+        String id = documents[i].id.empty() ? generate_id() : documents[i].id;
+        if (remove_id(next.segments, id, copied)) {
+            next.size--;
+        }
+        auto it = segment->id_to_slot.find(id);
+        if (it != segment->id_to_slot.end()) {
+            (*segment_deleted)[it->second] = 1;
+            segment_deleted_count++;
+            next.size--;
+        }
+
+        uint32_t slot = static_cast<uint32_t>(segment->documents.size());
+        auto doc = std::make_shared<Document>(documents[i]);
+        doc->id = id;
+        segment->documents.push_back(std::move(doc));
+        segment->id_to_slot[id] = slot;
+        if (embeddings_) {
+            segment->vectors.append(embeddings[i].data());
+        } else {
+            segment->text_index.add_document(tokenizers[i].tokens());
+        }
+        next.size++;
+        new_ids.push_back(id);
+    }
+
+    if (!documents.empty()) {
+        SegmentView view;
+        view.segment = std::move(segment);
+        if (segment_deleted_count > 0) {
+            view.deleted = std::move(segment_deleted);
+            view.deleted_count = segment_deleted_count;
+        }
+        next.segments.push_back(std::move(view));
+        rebalance(next.segments);
+    }
+
+    // Publish; queries still running keep the snapshot they started with
+    std::atomic_store(&snapshot_, std::shared_ptr<const Snapshot>(std::make_shared<Snapshot>(std::move(next))));
+    return new_ids;
+}
+
+std::vector<Document> ConcurrentVectorStore::similarity_search(const String& query, int k) {
+    auto results_with_scores = similarity_search_with_score(query, k);
+    std::vector<Document> results;
+    for (const auto& pair : results_with_scores) {
+        results.push_back(pair.first);
+    }
+    return results;
+}
+
+std::vector<std::pair<Document, double>> ConcurrentVectorStore::similarity_search_with_score(
+    const String& query, int k) {
+
+    if (k <= 0) {
+        return {};
+    }
+    Embedding query_vector;
+    if (embeddings_) {
+        query_vector = embed_query(query);
+    }
+    auto snapshot = load_snapshot();
+    return search(*snapshot, query, query_vector, k);
+}
+
+std::vector<std::vector<std::pair<Document, double>>> ConcurrentVectorStore::similarity_search_batch_with_score(
+    const StringList& queries, int k) {
+
+    std::vector<std::vector<std::pair<Document, double>>> results(queries.size());
+    if (k <= 0 || queries.empty()) {
+        return results;
+    }
+    std::vector<Embedding> query_vectors(queries.size());
+    if (embeddings_) {
+        for (size_t q = 0; q < queries.size(); ++q) {
+            query_vectors[q] = embed_query(queries[q]);
+        }
+    }
+
+    // Every query of the batch sees the same contents
+    auto snapshot = load_snapshot();
+    for (size_t q = 0; q < queries.size(); ++q) {
+        results[q] = search(*snapshot, queries[q], query_vectors[q], k);
+    }
+    return results;
+}
+
+void ConcurrentVectorStore::delete_documents(const StringList& ids) {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    auto current = load_snapshot();
+    Snapshot next = *current;
+    std::vector<std::shared_ptr<std::vector<uint8_t>>> copied(next.segments.size());
+    bool changed = false;
+    for (const auto& id : ids) {
+        if (remove_id(next.segments, id, copied)) {
+            next.size--;
+            changed = true;
+        }
+    }
+    if (changed) {
+        rebalance(next.segments);
+        std::atomic_store(&snapshot_, std::shared_ptr<const Snapshot>(std::make_shared<Snapshot>(std::move(next))));
+    }
+}
+
+std::vector<Document> ConcurrentVectorStore::get_by_ids(const StringList& ids) {
+    auto snapshot = load_snapshot();
+    std::vector<Document> result;
+    for (const auto& id : ids) {
+        // An ID is live in at most one segment
+        for (const auto& view : snapshot->segments) {
+            auto it = view.segment->id_to_slot.find(id);
+            if (it != view.segment->id_to_slot.end() && !view.is_deleted(it->second)) {
+                result.push_back(*view.segment->documents[it->second]);
+                break;
+            }
+        }
+    }
+    return result;
+}
+
+size_t ConcurrentVectorStore::size() const {
+    return load_snapshot()->size;
+}
+
+size_t ConcurrentVectorStore::segment_count() const {
+    return load_snapshot()->segments.size();
+}
+
+void ConcurrentVectorStore::compact() {
+    std::lock_guard<std::mutex> lock(write_mutex_);
+    auto current = load_snapshot();
+    if (current->segments.size() <= 1 &&
+        (current->segments.empty() || current->segments[0].deleted_count == 0)) {
+        return;
+    }
+    Snapshot next;
+    next.size = current->size;
+    if (current->size > 0) {
+        SegmentView view;
+        view.segment = merge_segments(current->segments);
+        next.segments.push_back(std::move(view));
+    }
+    std::atomic_store(&snapshot_, std::shared_ptr<const Snapshot>(std::make_shared<Snapshot>(std::move(next))));
+}
+
+// Private methods
+std::shared_ptr<const ConcurrentVectorStore::Snapshot> ConcurrentVectorStore::load_snapshot() const {
+    return std::atomic_load(&snapshot_);
+}
+
+std::vector<std::pair<Document, double>> ConcurrentVectorStore::search(
+    const Snapshot& snapshot, const String& query, const Embedding& query_vector, int k) const {
+
+    // Candidates are numbered by their position across all segments, oldest first
+    std::vector<uint32_t> bases;
+    bases.reserve(snapshot.segments.size());
+    uint32_t total = 0;
+    for (const auto& view : snapshot.segments) {
+        bases.push_back(total);
+        total += static_cast<uint32_t>(view.segment->documents.size());
+    }
+
+    TopKCollector top_k(static_cast<size_t>(k));
+    if (embeddings_) {
+        for (size_t s = 0; s < snapshot.segments.size(); ++s) {
+            const SegmentView& view = snapshot.segments[s];
+            const VectorMatrix& vectors = view.segment->vectors;
+            for (uint32_t slot = 0; slot < vectors.rows(); ++slot) {
+                if (!view.is_deleted(slot)) {
+                    top_k.push(similarity_score(metric_, query_vector.data(), vectors.row(slot),
+                                                vectors.dimension()),
+                               bases[s] + slot);
+                }
+            }
+        }
+    } else {
+        // Word overlap: common_words / max(|query|, |document|), as in InMemoryVectorStore
+        Tokenizer tokenizer;
+        const auto& query_words = tokenizer.tokenize(query);
+        TermVector query_terms;
+        std::unordered_map<uint32_t, uint32_t> common_words;
+        for (size_t s = 0; s < snapshot.segments.size(); ++s) {
+            // Each segment has its own dictionary, so term ids are resolved per segment
+            const SegmentView& view = snapshot.segments[s];
+            const InvertedIndex& text_index = view.segment->text_index;
+            text_index.dictionary().lookup(query_words, query_terms);
+            for (const auto& query_term : query_terms) {
+                const std::vector<Posting>* postings = text_index.get_postings(query_term.term);
+                for (size_t p = 0; postings && p < postings->size(); ++p) {
+                    const Posting& posting = (*postings)[p];
+                    if (!view.is_deleted(posting.slot)) {
+                        common_words[bases[s] + posting.slot] += query_term.frequency;
+                    }
+                }
+            }
+        }
+        for (const auto& entry : common_words) {
+            size_t s = std::upper_bound(bases.begin(), bases.end(), entry.first) - bases.begin() - 1;
+            size_t document_words = snapshot.segments[s].segment->text_index.document_length(entry.first - bases[s]);
+            size_t max_words = std::max<size_t>(query_words.size(), document_words);
+            top_k.push(static_cast<double>(entry.second) / max_words, entry.first);
+        }
+
+        // Fill the remaining places with zero-score documents in insertion order
+        for (size_t s = 0; s < snapshot.segments.size() && top_k.size() < top_k.capacity(); ++s) {
+            const SegmentView& view = snapshot.segments[s];
+            for (uint32_t slot = 0; slot < view.segment->documents.size() && top_k.size() < top_k.capacity();
+                 ++slot) {
+                if (!view.is_deleted(slot) && !common_words.count(bases[s] + slot)) {
+                    top_k.push(0.0, bases[s] + slot);
+                }
+            }
+        }
+    }
+
+    std::vector<std::pair<Document, double>> results;
+    for (const auto& candidate : top_k.take_sorted()) {
+        size_t s = std::upper_bound(bases.begin(), bases.end(), candidate.second) - bases.begin() - 1;
+        results.push_back({*snapshot.segments[s].segment->documents[candidate.second - bases[s]],
+                           candidate.first});
+    }
+    return results;
+}
+
+Embedding ConcurrentVectorStore::embed_query(const String& query) const {
+    Embedding query_vector = embeddings_->embed_query(query);
+    query_vector.resize(embeddings_->dimension(), 0.0f);
+    if (metric_ == DistanceMetric::COSINE) {
+        normalize(query_vector.data(), query_vector.size());
+    }
+    return query_vector;
+}
+
+std::shared_ptr<const ConcurrentVectorStore::Segment> ConcurrentVectorStore::merge_segments(
+    const std::vector<SegmentView>& views) const {
+
+    size_t live = 0;
+    for (const auto& view : views) {
+        live += view.live();
+    }
+    auto merged = std::make_shared<Segment>(embeddings_ ? embeddings_->dimension() : 0);
+    merged->documents.reserve(live);
+    merged->id_to_slot.reserve(live);
+    if (embeddings_) {
+        merged->vectors.reserve(live);
+    }
+
+    // Documents are shared with the source segments; vectors and postings are copied
+    Tokenizer tokenizer;
+    for (const auto& view : views) {
+        const Segment& segment = *view.segment;
+        for (uint32_t slot = 0; slot < segment.documents.size(); ++slot) {
+            if (view.is_deleted(slot)) {
+                continue;
+            }
+            merged->id_to_slot[segment.documents[slot]->id] = static_cast<uint32_t>(merged->documents.size());
+            merged->documents.push_back(segment.documents[slot]);
+            if (embeddings_) {
+                merged->vectors.append(segment.vectors.row(slot));
+            } else {
+                merged->text_index.add_document(tokenizer.tokenize(segment.documents[slot]->content));
+            }
+        }
+    }
+    return merged;
+}
+
+void ConcurrentVectorStore::rebalance(std::vector<SegmentView>& segments) const {
+    segments.erase(std::remove_if(segments.begin(), segments.end(),
+                                  [](const SegmentView& view) { return view.live() == 0; }),
+                   segments.end());
+
+    // Like a binary counter: each document is copied O(log n) times over its lifetime
+    for (size_t i = 1; i < segments.size();) {
+        if (segments[i].live() < segments[i - 1].live()) {
+            ++i;
+            continue;
+        }
+        SegmentView merged;
+        merged.segment = merge_segments({segments[i - 1], segments[i]});
+        segments[i - 1] = std::move(merged);
+        segments.erase(segments.begin() + i);
+        i = std::max<size_t>(1, i - 1);
+    }
+}
+
+bool ConcurrentVectorStore::remove_id(std::vector<SegmentView>& segments, const String& id,
+                                      std::vector<std::shared_ptr<std::vector<uint8_t>>>& copied) const {
+    for (size_t s = 0; s < segments.size(); ++s) {
+        SegmentView& view = segments[s];
+        auto it = view.segment->id_to_slot.find(id);
+        if (it == view.segment->id_to_slot.end() || view.is_deleted(it->second)) {
+            continue;
+        }
+        // Published tombstones are shared with readers; copy them once per write
+        if (!copied[s]) {
+            copied[s] = view.deleted ? std::make_shared<std::vector<uint8_t>>(*view.deleted)
+                                     : std::make_shared<std::vector<uint8_t>>(view.segment->documents.size(), 0);
+            view.deleted = copied[s];
+        }
+        (*copied[s])[it->second] = 1;
+        view.deleted_count++;
+        return true;
+    }
+    return false;
+}
+
+String ConcurrentVectorStore::generate_id() {
+    static const char charset[] =
+        "0123456789"
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+        "abcdefghijklmnopqrstuvwxyz";
+
+    String result;
+    result.reserve(16);
+
+    for (int i = 0; i < 16; ++i) {
+        result += charset[rng_() % (sizeof(charset) - 1)];
+    }
+
+    return result;
+}
+
+} // namespace langchain
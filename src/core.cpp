@@ -1,5 +1,6 @@
 #include "../include/langchain/core.h"
 #include <algorithm>
+#include <climits>
 
 namespace langchain {
 
@@ -59,4 +60,77 @@ StringList Chain::invoke_batch(const StringList& inputs) {
     return results;
 }
 
-} // namespace langchain
\ No newline at end of file
+// VectorStore class implementation
+StringList VectorStore::add_embedded_documents(const std::vector<Document>& documents,
+                                              const std::vector<Embedding>&) {
+    return add_documents(documents);
+}
+
+std::vector<std::vector<Document>> VectorStore::similarity_search_batch(const StringList& queries, int k) {
+    // Stores batch the scored search, so one override serves both calls
+    std::vector<std::vector<Document>> results;
+    for (auto& scored : similarity_search_batch_with_score(queries, k)) {
+        std::vector<Document> documents;
+        documents.reserve(scored.size());
+        for (auto& pair : scored) {
+            documents.push_back(std::move(pair.first));
+        }
+        results.push_back(std::move(documents));
+    }
+    return results;
+}
+
+std::vector<std::vector<std::pair<Document, double>>> VectorStore::similarity_search_batch_with_score(
+    const StringList& queries, int k) {
+    std::vector<std::vector<std::pair<Document, double>>> results;
+    for (const auto& query : queries) {
+        results.push_back(similarity_search_with_score(query, k));
+    }
+    return results;
+}
+
+std::vector<std::pair<Document, double>> VectorStore::similarity_search_with_filter(
+    const String& query, int k, const MetadataFilter& filter) {
+    if (filter.empty() || k <= 0) {
+        return similarity_search_with_score(query, k);
+    }
+
+    // Widen the search until enough candidates match or the store has nothing more
+    int fetch = k > INT_MAX / 10 ? INT_MAX : k * 10;
+    for (;;) {
+        auto candidates = similarity_search_with_score(query, fetch);
+        std::vector<std::pair<Document, double>> results;
+        for (auto& candidate : candidates) {
+            if (matches_filter(candidate.first.metadata, filter)) {
+                results.push_back(std::move(candidate));
+                if (static_cast<int>(results.size()) == k) {
+                    break;
+                }
+            }
+        }
+        if (static_cast<int>(results.size()) == k || static_cast<int>(candidates.size()) < fetch ||
+            fetch == INT_MAX) {
+            return results;
+        }
+        fetch = fetch > INT_MAX / 2 ? INT_MAX : fetch * 2;
+    }
+}
+
+std::vector<Document> VectorStore::max_marginal_relevance_search(const String& query, int k,
+                                                                int fetch_k, double lambda_mult) {
+    (void)fetch_k;
+    (void)lambda_mult;
+    return similarity_search(query, k);
+}
+
+bool matches_filter(const StringMap& metadata, const MetadataFilter& filter) {
+    for (const auto& condition : filter) {
+        auto it = metadata.find(condition.first);
+        if (it == metadata.end() || it->second != condition.second) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace langchain
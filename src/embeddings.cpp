@@ -0,0 +1,318 @@
+#include "../include/langchain/embeddings.h"
+#include "../include/langchain/vector_math.h"
+#include "../include/langchain/tokenizer.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <sqlite3.h>
+
+namespace langchain {
+
+namespace {
+
+const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ULL;
+const uint64_t FNV_PRIME = 1099511628211ULL;
+
+// FNV-1a hash of a byte range, continuing from a seed
+uint64_t fnv1a(const char* data, size_t size, uint64_t seed = FNV_OFFSET_BASIS) {
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+} // namespace
+
+// HashingEmbeddings implementation
+HashingEmbeddings::HashingEmbeddings(size_t dimension, bool use_char_ngrams)
+    : dimension_(dimension == 0 ? 1 : dimension), use_char_ngrams_(use_char_ngrams) {}
+
+std::vector<Embedding> HashingEmbeddings::embed_documents(const StringList& texts) {
+    std::vector<Embedding> embeddings;
+    embeddings.reserve(texts.size());
+    for (const auto& text : texts) {
+        embeddings.push_back(embed(text));
+    }
+    return embeddings;
+}
+
+Embedding HashingEmbeddings::embed_query(const String& text) {
+    return embed(text);
+}
+
+size_t HashingEmbeddings::dimension() const {
+    return dimension_;
+}
+
+Embedding HashingEmbeddings::embed(const String& text) const {
+    Embedding vector(dimension_, 0.0f);
+
+    // Lowercase words with surrounding ASCII punctuation removed. CJK runs stay whole,
+    // so the tokenizer's CJK segmentation does not change the vectors
+    Tokenizer tokenizer(true, CjkSegmentation::NONE);
+    String padded;
+    for (std::string_view word : tokenizer.tokenize(text)) {
+        add_feature(vector, fnv1a(word.data(), word.size()), 1.0f);
+
+        if (use_char_ngrams_) {
+            // Character trigrams over the word with boundary markers, so that
+            // inflected forms ("learn", "learning") still share features
+            padded.assign(1, '<');
+            padded.append(word);
+            padded.push_back('>');
+            uint64_t seed = fnv1a("#", 1);
+            for (size_t i = 0; i + 3 <= padded.size(); ++i) {
+                add_feature(vector, fnv1a(padded.data() + i, 3, seed), 0.25f);
+            }
+        }
+    }
+
+    normalize(vector.data(), vector.size());
+    return vector;
+}
+
+void HashingEmbeddings::add_feature(Embedding& vector, uint64_t hash, float weight) const {
+    // The top bit picks the sign so that collisions cancel out on average
+    float sign = (hash >> 63) ? -1.0f : 1.0f;
+    vector[hash % dimension_] += sign * weight;
+}
+
+// EmbeddingCache implementation
+EmbeddingCache::EmbeddingCache(std::shared_ptr<Embeddings> embeddings, const String& model_id,
+                               const EmbeddingCacheConfig& config)
+    : embeddings_(embeddings), model_id_(model_id), config_(config),
+      db_(nullptr), select_stmt_(nullptr), insert_stmt_(nullptr) {
+    if (!config_.disk_path.empty()) {
+        open_disk(config_.disk_path);
+    }
+}
+
+EmbeddingCache::~EmbeddingCache() {
+    sqlite3_finalize(select_stmt_);
+    sqlite3_finalize(insert_stmt_);
+    if (db_) {
+        sqlite3_close(db_);
+    }
+}
+
+std::vector<Embedding> EmbeddingCache::embed_documents(const StringList& texts) {
+    std::vector<Embedding> embeddings(texts.size());
+
+    // Collect the distinct texts that neither tier has
+    StringList missing_texts;
+    std::vector<Key> missing_keys;
+    std::vector<std::vector<size_t>> missing_positions;
+    std::unordered_map<Key, size_t, KeyHash> missing_index;
+    for (size_t i = 0; i < texts.size(); ++i) {
+        Key key = make_key(texts[i], false);
+        auto it = missing_index.find(key);
+        if (it != missing_index.end()) {
+            missing_positions[it->second].push_back(i);
+        } else if (!lookup(key, embeddings[i])) {
+            missing_index[key] = missing_texts.size();
+            missing_texts.push_back(texts[i]);
+            missing_keys.push_back(key);
+            missing_positions.push_back({i});
+        }
+    }
+    if (missing_texts.empty()) {
+        return embeddings;
+    }
+
+    // One call to the wrapped model for every miss of the batch
+    std::vector<Embedding> computed = embeddings_->embed_documents(missing_texts);
+    if (computed.size() != missing_texts.size()) {
+        throw std::runtime_error("EmbeddingCache: wrapped model returned " + std::to_string(computed.size()) +
+                                 " vectors for " + std::to_string(missing_texts.size()) + " texts");
+    }
+    store(missing_keys, computed);
+    for (size_t m = 0; m < missing_positions.size(); ++m) {
+        for (size_t position : missing_positions[m]) {
+            embeddings[position] = computed[m];
+        }
+    }
+    return embeddings;
+}
+
+Embedding EmbeddingCache::embed_query(const String& text) {
+    Key key = make_key(text, true);
+    Embedding embedding;
+    if (lookup(key, embedding)) {
+        return embedding;
+    }
+    embedding = embeddings_->embed_query(text);
+    store({key}, {embedding});
+    return embedding;
+}
+
+size_t EmbeddingCache::dimension() const {
+    return embeddings_->dimension();
+}
+
+EmbeddingCacheStats EmbeddingCache::get_stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    EmbeddingCacheStats stats = stats_;
+    stats.memory_entries = entries_.size();
+    return stats;
+}
+
+bool EmbeddingCache::has_disk_tier() const {
+    return db_ != nullptr;
+}
+
+void EmbeddingCache::clear_memory() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    lru_.clear();
+    entries_.clear();
+}
+
+// Private methods
+EmbeddingCache::Key EmbeddingCache::make_key(const String& text, bool query) const {
+    // Trim and collapse whitespace runs so formatting-only changes still hit
+    String normalized;
+    normalized.reserve(text.size());
+    bool pending_space = false;
+    for (char c : text) {
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            pending_space = !normalized.empty();
+        } else {
+            if (pending_space) {
+                normalized += ' ';
+                pending_space = false;
+            }
+            normalized += c;
+        }
+    }
+
+    // Two differently seeded hashes over model ID, kind and text
+    Key key;
+    const char kind = query ? 'q' : 'd';
+    key.high = fnv1a(model_id_.data(), model_id_.size());
+    key.high = fnv1a(&kind, 1, key.high);
+    key.high = fnv1a(normalized.data(), normalized.size(), key.high);
+    key.low = fnv1a(normalized.data(), normalized.size(), fnv1a("langchain-embedding-cache", 25));
+    key.low = fnv1a(&kind, 1, key.low);
+    key.low = fnv1a(model_id_.data(), model_id_.size(), key.low);
+    return key;
+}
+
+bool EmbeddingCache::lookup(const Key& key, Embedding& embedding) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = entries_.find(key);
+        if (it != entries_.end()) {
+            lru_.splice(lru_.begin(), lru_, it->second);
+            embedding = it->second->second;
+            stats_.memory_hits++;
+            return true;
+        }
+    }
+    if (!db_) {
+        return false;
+    }
+
+    bool found = false;
+    {
+        std::lock_guard<std::mutex> lock(disk_mutex_);
+        sqlite3_reset(select_stmt_);
+        sqlite3_bind_int64(select_stmt_, 1, static_cast<sqlite3_int64>(key.high));
+        sqlite3_bind_int64(select_stmt_, 2, static_cast<sqlite3_int64>(key.low));
+        if (sqlite3_step(select_stmt_) == SQLITE_ROW) {
+            const void* blob = sqlite3_column_blob(select_stmt_, 0);
+            size_t bytes = static_cast<size_t>(sqlite3_column_bytes(select_stmt_, 0));
+            if (blob && bytes % sizeof(float) == 0) {
+                embedding.resize(bytes / sizeof(float));
+                std::memcpy(embedding.data(), blob, bytes);
+                found = true;
+            }
+        }
+        sqlite3_reset(select_stmt_);
+    }
+    if (found) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        insert_memory(key, embedding);
+        stats_.disk_hits++;
+    }
+    return found;
+}
+
+void EmbeddingCache::store(const std::vector<Key>& keys, const std::vector<Embedding>& embeddings) {
+    size_t count = std::min(keys.size(), embeddings.size());
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.misses += count;
+        for (size_t i = 0; i < count; ++i) {
+            insert_memory(keys[i], embeddings[i]);
+        }
+    }
+    if (!db_) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(disk_mutex_);
+    sqlite3_exec(db_, "BEGIN TRANSACTION", nullptr, nullptr, nullptr);
+    for (size_t i = 0; i < count; ++i) {
+        sqlite3_reset(insert_stmt_);
+        sqlite3_bind_int64(insert_stmt_, 1, static_cast<sqlite3_int64>(keys[i].high));
+        sqlite3_bind_int64(insert_stmt_, 2, static_cast<sqlite3_int64>(keys[i].low));
+        sqlite3_bind_blob(insert_stmt_, 3, embeddings[i].data(),
+                          static_cast<int>(embeddings[i].size() * sizeof(float)), SQLITE_STATIC);
+        if (sqlite3_step(insert_stmt_) != SQLITE_DONE) {
+            std::cerr << "Failed to write embedding cache entry: " << sqlite3_errmsg(db_) << std::endl;
+        }
+    }
+    sqlite3_reset(insert_stmt_);
+    sqlite3_exec(db_, "COMMIT", nullptr, nullptr, nullptr);
+}
+
+void EmbeddingCache::insert_memory(const Key& key, const Embedding& embedding) {
+    if (config_.max_entries == 0) {
+        return;
+    }
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return;
+    }
+    lru_.emplace_front(key, embedding);
+    entries_[key] = lru_.begin();
+    while (entries_.size() > config_.max_entries) {
+        entries_.erase(lru_.back().first);
+        lru_.pop_back();
+    }
+}
+
+bool EmbeddingCache::open_disk(const String& path) {
+    if (sqlite3_open(path.c_str(), &db_) != SQLITE_OK) {
+        std::cerr << "Can't open embedding cache: " << sqlite3_errmsg(db_) << std::endl;
+        sqlite3_close(db_);
+        db_ = nullptr;
+        return false;
+    }
+
+    const char* schema =
+        "CREATE TABLE IF NOT EXISTS embeddings ("
+        "key_high INTEGER NOT NULL, key_low INTEGER NOT NULL, vector BLOB NOT NULL, "
+        "PRIMARY KEY (key_high, key_low)) WITHOUT ROWID";
+    if (sqlite3_exec(db_, schema, nullptr, nullptr, nullptr) != SQLITE_OK ||
+        sqlite3_prepare_v2(db_, "SELECT vector FROM embeddings WHERE key_high = ? AND key_low = ?", -1,
+                           &select_stmt_, nullptr) != SQLITE_OK ||
+        sqlite3_prepare_v2(db_, "INSERT OR REPLACE INTO embeddings (key_high, key_low, vector) VALUES (?, ?, ?)", -1,
+                           &insert_stmt_, nullptr) != SQLITE_OK) {
+        std::cerr << "Can't prepare embedding cache: " << sqlite3_errmsg(db_) << std::endl;
+        sqlite3_finalize(select_stmt_);
+        sqlite3_finalize(insert_stmt_);
+        select_stmt_ = nullptr;
+        insert_stmt_ = nullptr;
+        sqlite3_close(db_);
+        db_ = nullptr;
+        return false;
+    }
+    return true;
+}
+
+} // namespace langchain
@@ -0,0 +1,550 @@
+#include "../include/langchain/hnsw.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <queue>
+#include <stdexcept>
+#include <unordered_set>
+
+namespace langchain {
+
+namespace {
+
+using Candidate = std::pair<float, uint32_t>;
+
+// Epoch tagged visited marks, reused by every search running on the same thread
+struct VisitedList {
+    std::vector<uint32_t> marks;
+    uint32_t epoch = 0;
+
+    void reset(size_t size) {
+        if (marks.size() < size) {
+            marks.resize(size, 0);
+        }
+        if (++epoch == 0) {
+            std::fill(marks.begin(), marks.end(), 0);
+            epoch = 1;
+        }
+    }
+
+    // Returns false if the node was already visited
+    bool visit(uint32_t node) {
+        if (marks[node] == epoch) {
+            return false;
+        }
+        marks[node] = epoch;
+        return true;
+    }
+};
+
+VisitedList& thread_visited_list() {
+    thread_local VisitedList visited;
+    return visited;
+}
+
+} // namespace
+
+// HNSWVectorStore implementation
+HNSWVectorStore::Node::Node(int level)
+    : level(level), links(level + 1), deleted(false) {}
+
+HNSWVectorStore::HNSWVectorStore(std::shared_ptr<Embeddings> embeddings, const HNSWConfig& config)
+    : embeddings_(embeddings),
+      config_(config),
+      vectors_(embeddings->dimension()),
+      rng_(config.seed),
+      entry_point_(-1),
+      max_level_(-1),
+      deleted_count_(0) {
+    config_.M = std::max<size_t>(config_.M, 2);
+    config_.ef_construction = std::max(config_.ef_construction, config_.M);
+    level_multiplier_ = 1.0 / std::log(static_cast<double>(config_.M));
+}
+
+StringList HNSWVectorStore::add_documents(const std::vector<Document>& documents) {
+    // Embed the whole batch before touching the graph
+    StringList texts;
+    texts.reserve(documents.size());
+    for (const auto& doc : documents) {
+        texts.push_back(doc.content);
+    }
+    std::vector<Embedding> embeddings = embeddings_->embed_documents(texts);
+    if (embeddings.size() != documents.size()) {
+        throw std::runtime_error("HNSWVectorStore: embedding model returned " + std::to_string(embeddings.size()) +
+                                 " vectors for " + std::to_string(documents.size()) + " documents");
+    }
+
+    StringList new_ids;
+    for (size_t i = 0; i < documents.size(); ++i) {
+        new_ids.push_back(insert(documents[i], std::move(embeddings[i])));
+    }
+    return new_ids;
+}
+
+StringList HNSWVectorStore::add_embedded_documents(const std::vector<Document>& documents,
+                                                   const std::vector<Embedding>& embeddings) {
+    if (embeddings.size() != documents.size()) {
+        return add_documents(documents);
+    }
+    StringList new_ids;
+    for (size_t i = 0; i < documents.size(); ++i) {
+        new_ids.push_back(insert(documents[i], embeddings[i]));
+    }
+    return new_ids;
+}
+
+std::vector<Document> HNSWVectorStore::similarity_search(const String& query, int k) {
+    auto results_with_scores = similarity_search_with_score(query, k);
+    std::vector<Document> results;
+    for (const auto& pair : results_with_scores) {
+        results.push_back(pair.first);
+    }
+    return results;
+}
+
+std::vector<std::pair<Document, double>> HNSWVectorStore::similarity_search_with_score(
+    const String& query, int k) {
+
+    std::vector<std::pair<Document, double>> results;
+    if (k <= 0) {
+        return results;
+    }
+
+    Embedding query_vector = prepare_query(query);
+
+    std::shared_lock<std::shared_mutex> lock(storage_mutex_);
+    for (const auto& candidate : search_nodes(query_vector.data(), k)) {
+        results.push_back({documents_[candidate.second], to_score(candidate.first)});
+    }
+    return results;
+}
+
+std::vector<Document> HNSWVectorStore::max_marginal_relevance_search(const String& query, int k,
+                                                                    int fetch_k, double lambda_mult) {
+    std::vector<Document> results;
+    if (k <= 0) {
+        return results;
+    }
+
+    Embedding query_vector = prepare_query(query);
+
+    std::shared_lock<std::shared_mutex> lock(storage_mutex_);
+    auto candidates = search_nodes(query_vector.data(), static_cast<size_t>(std::max(k, fetch_k)));
+    std::vector<const float*> vectors;
+    std::vector<double> relevance;
+    vectors.reserve(candidates.size());
+    relevance.reserve(candidates.size());
+    for (const auto& candidate : candidates) {
+        vectors.push_back(vectors_.row(candidate.second));
+        relevance.push_back(to_score(candidate.first));
+    }
+    for (size_t index : select_mmr(config_.metric, vectors, relevance, vectors_.dimension(),
+                                   static_cast<size_t>(k), lambda_mult)) {
+        results.push_back(documents_[candidates[index].second]);
+    }
+    return results;
+}
+
+void HNSWVectorStore::delete_documents(const StringList& ids) {
+    std::unique_lock<std::shared_mutex> lock(storage_mutex_);
+    for (const auto& id : ids) {
+        auto it = id_to_node_.find(id);
+        if (it == id_to_node_.end()) {
+            continue;
+        }
+        // The node stays in the graph for navigation but is hidden from results
+        if (!nodes_[it->second]->deleted.exchange(true)) {
+            deleted_count_++;
+        }
+        id_to_node_.erase(it);
+    }
+}
+
+std::vector<Document> HNSWVectorStore::get_by_ids(const StringList& ids) {
+    std::shared_lock<std::shared_mutex> lock(storage_mutex_);
+    std::vector<Document> result;
+    for (const auto& id : ids) {
+        auto it = id_to_node_.find(id);
+        if (it != id_to_node_.end()) {
+            result.push_back(documents_[it->second]);
+        }
+    }
+    return result;
+}
+
+size_t HNSWVectorStore::size() const {
+    std::shared_lock<std::shared_mutex> lock(storage_mutex_);
+    return nodes_.size() - deleted_count_;
+}
+
+void HNSWVectorStore::set_ef_search(size_t ef_search) {
+    std::unique_lock<std::shared_mutex> lock(storage_mutex_);
+    config_.ef_search = std::max<size_t>(ef_search, 1);
+}
+
+const HNSWConfig& HNSWVectorStore::get_config() const {
+    return config_;
+}
+
+HNSWSearchReport HNSWVectorStore::evaluate(const StringList& queries, int k) {
+    HNSWSearchReport report;
+    report.queries = queries.size();
+    report.k = k;
+    if (queries.empty() || k <= 0) {
+        return report;
+    }
+
+    std::vector<Embedding> query_vectors;
+    for (const auto& query : queries) {
+        query_vectors.push_back(prepare_query(query));
+    }
+
+    std::shared_lock<std::shared_mutex> lock(storage_mutex_);
+
+    std::vector<double> latencies;
+    double exact_total_ms = 0.0;
+    size_t found = 0;
+    size_t expected = 0;
+
+    for (const auto& query_vector : query_vectors) {
+        auto start = std::chrono::steady_clock::now();
+        auto approximate = search_nodes(query_vector.data(), k);
+        auto middle = std::chrono::steady_clock::now();
+        auto exact = exact_search_nodes(query_vector.data(), k);
+        auto end = std::chrono::steady_clock::now();
+
+        latencies.push_back(std::chrono::duration<double, std::milli>(middle - start).count());
+        exact_total_ms += std::chrono::duration<double, std::milli>(end - middle).count();
+
+        std::unordered_set<uint32_t> exact_nodes;
+        for (const auto& candidate : exact) {
+            exact_nodes.insert(candidate.second);
+        }
+        for (const auto& candidate : approximate) {
+            found += exact_nodes.count(candidate.second);
+        }
+        expected += exact.size();
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    double total_ms = 0.0;
+    for (double latency : latencies) {
+        total_ms += latency;
+    }
+    size_t p99_index = static_cast<size_t>(std::ceil(0.99 * latencies.size())) - 1;
+
+    report.recall = expected == 0 ? 1.0 : static_cast<double>(found) / expected;
+    report.mean_latency_ms = total_ms / latencies.size();
+    report.p99_latency_ms = latencies[std::min(p99_index, latencies.size() - 1)];
+    report.exact_mean_latency_ms = exact_total_ms / latencies.size();
+    return report;
+}
+
+// Private methods
+String HNSWVectorStore::insert(const Document& document, Embedding embedding) {
+    embedding.resize(vectors_.dimension(), 0.0f);
+    if (config_.metric == DistanceMetric::COSINE) {
+        normalize(embedding.data(), embedding.size());
+    }
+
+    // Reserve the node under the exclusive lock; this is the only step that moves storage
+    uint32_t node;
+    int level;
+    String id;
+    {
+        std::unique_lock<std::shared_mutex> lock(storage_mutex_);
+        id = document.id.empty() ? generate_id() : document.id;
+
+        // Adding an existing ID replaces the previous document
+        auto it = id_to_node_.find(id);
+        if (it != id_to_node_.end() && !nodes_[it->second]->deleted.exchange(true)) {
+            deleted_count_++;
+        }
+
+        node = static_cast<uint32_t>(nodes_.size());
+        level = random_level();
+
+        Document doc_with_id = document;
+        doc_with_id.id = id;
+        documents_.push_back(doc_with_id);
+        vectors_.append(embedding.data());
+        nodes_.push_back(std::make_unique<Node>(level));
+        id_to_node_[id] = node;
+    }
+
+    // Link the node under the shared lock so that other inserts and searches proceed
+    std::shared_lock<std::shared_mutex> lock(storage_mutex_);
+
+    // Inserts that raise the top level hold the entry lock until they are linked
+    std::unique_lock<std::mutex> entry_lock(entry_mutex_);
+    int64_t entry = entry_point_;
+    int top_level = max_level_;
+    if (entry < 0) {
+        entry_point_ = node;
+        max_level_ = level;
+        return id;
+    }
+    if (level <= top_level) {
+        entry_lock.unlock();
+    }
+
+    const float* query = vectors_.row(node);
+    uint32_t current = static_cast<uint32_t>(entry);
+    float current_distance = distance(query, vectors_.row(current));
+
+    // Greedy descent through the layers above the new node
+    for (int layer = top_level; layer > level; --layer) {
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (uint32_t neighbor : get_links(current, layer)) {
+                float d = distance(query, vectors_.row(neighbor));
+                if (d < current_distance) {
+                    current_distance = d;
+                    current = neighbor;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    // Connect the node on every layer it belongs to
+    for (int layer = std::min(level, top_level); layer >= 0; --layer) {
+        auto candidates = search_layer(query, current, config_.ef_construction, layer, false);
+        auto neighbors = select_neighbors(candidates, config_.M);
+        {
+            std::lock_guard<std::mutex> node_lock(nodes_[node]->mutex);
+            nodes_[node]->links[layer] = neighbors;
+        }
+        for (uint32_t neighbor : neighbors) {
+            add_link(neighbor, node, layer);
+        }
+        if (!candidates.empty()) {
+            current = candidates.front().second;
+        }
+    }
+
+    if (level > top_level) {
+        entry_point_ = node;
+        max_level_ = level;
+    }
+    return id;
+}
+
+Embedding HNSWVectorStore::prepare_query(const String& query) {
+    Embedding query_vector = embeddings_->embed_query(query);
+    query_vector.resize(vectors_.dimension(), 0.0f);
+    if (config_.metric == DistanceMetric::COSINE) {
+        normalize(query_vector.data(), query_vector.size());
+    }
+    return query_vector;
+}
+
+std::vector<std::pair<float, uint32_t>> HNSWVectorStore::search_nodes(const float* query, size_t k) const {
+    // Caller holds storage_mutex_ (shared)
+    int64_t entry;
+    int top_level;
+    {
+        std::lock_guard<std::mutex> entry_lock(entry_mutex_);
+        entry = entry_point_;
+        top_level = max_level_;
+    }
+    if (entry < 0) {
+        return {};
+    }
+
+    uint32_t current = static_cast<uint32_t>(entry);
+    float current_distance = distance(query, vectors_.row(current));
+    for (int layer = top_level; layer > 0; --layer) {
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (uint32_t neighbor : get_links(current, layer)) {
+                float d = distance(query, vectors_.row(neighbor));
+                if (d < current_distance) {
+                    current_distance = d;
+                    current = neighbor;
+                    changed = true;
+                }
+            }
+        }
+    }
+
+    auto results = search_layer(query, current, std::max(config_.ef_search, k), 0, true);
+    if (results.size() > k) {
+        results.resize(k);
+    }
+    return results;
+}
+
+std::vector<std::pair<float, uint32_t>> HNSWVectorStore::exact_search_nodes(const float* query, size_t k) const {
+    // Caller holds storage_mutex_ (shared)
+    std::vector<Candidate> results;
+    for (uint32_t node = 0; node < nodes_.size(); ++node) {
+        if (!nodes_[node]->deleted) {
+            results.push_back({distance(query, vectors_.row(node)), node});
+        }
+    }
+    size_t count = std::min(k, results.size());
+    std::partial_sort(results.begin(), results.begin() + count, results.end());
+    results.resize(count);
+    return results;
+}
+
+std::vector<std::pair<float, uint32_t>> HNSWVectorStore::search_layer(const float* query, uint32_t entry,
+                                                                      size_t ef, int layer,
+                                                                      bool skip_deleted) const {
+    VisitedList& visited = thread_visited_list();
+    visited.reset(nodes_.size());
+
+    // Closest candidates to expand first, and the ef best results seen so far
+    std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> candidates;
+    std::priority_queue<Candidate> results;
+
+    float entry_distance = distance(query, vectors_.row(entry));
+    visited.visit(entry);
+    candidates.push({entry_distance, entry});
+    if (!skip_deleted || !nodes_[entry]->deleted) {
+        results.push({entry_distance, entry});
+    }
+    float bound = results.empty() ? std::numeric_limits<float>::max() : results.top().first;
+
+    while (!candidates.empty()) {
+        Candidate closest = candidates.top();
+        if (closest.first > bound && results.size() >= ef) {
+            break;
+        }
+        candidates.pop();
+
+        for (uint32_t neighbor : get_links(closest.second, layer)) {
+            if (!visited.visit(neighbor)) {
+                continue;
+            }
+            float d = distance(query, vectors_.row(neighbor));
+            if (results.size() < ef || d < bound) {
+                // Deleted nodes are still traversed so the graph stays connected
+                candidates.push({d, neighbor});
+                if (!skip_deleted || !nodes_[neighbor]->deleted) {
+                    results.push({d, neighbor});
+                    if (results.size() > ef) {
+                        results.pop();
+                    }
+                }
+                if (!results.empty()) {
+                    bound = results.top().first;
+                }
+            }
+        }
+    }
+
+    std::vector<Candidate> sorted(results.size());
+    for (size_t i = sorted.size(); i > 0; --i) {
+        sorted[i - 1] = results.top();
+        results.pop();
+    }
+    return sorted;
+}
+
+std::vector<uint32_t> HNSWVectorStore::select_neighbors(const std::vector<std::pair<float, uint32_t>>& candidates,
+                                                        size_t max_links) const {
+    // Keep a candidate only if it is closer to the base than to every neighbor
+    // already kept, which spreads links in different directions
+    std::vector<uint32_t> selected;
+    for (const auto& candidate : candidates) {
+        if (selected.size() >= max_links) {
+            break;
+        }
+        bool diverse = true;
+        for (uint32_t kept : selected) {
+            if (distance(vectors_.row(candidate.second), vectors_.row(kept)) < candidate.first) {
+                diverse = false;
+                break;
+            }
+        }
+        if (diverse) {
+            selected.push_back(candidate.second);
+        }
+    }
+    return selected;
+}
+
+void HNSWVectorStore::add_link(uint32_t node, uint32_t neighbor, int layer) {
+    std::lock_guard<std::mutex> node_lock(nodes_[node]->mutex);
+    auto& links = nodes_[node]->links[layer];
+    if (std::find(links.begin(), links.end(), neighbor) != links.end()) {
+        return;
+    }
+    if (links.size() < max_links(layer)) {
+        links.push_back(neighbor);
+        return;
+    }
+
+    // The list is full: re-select among the existing links and the new one
+    std::vector<Candidate> candidates;
+    candidates.reserve(links.size() + 1);
+    const float* base = vectors_.row(node);
+    for (uint32_t link : links) {
+        candidates.push_back({distance(base, vectors_.row(link)), link});
+    }
+    candidates.push_back({distance(base, vectors_.row(neighbor)), neighbor});
+    std::sort(candidates.begin(), candidates.end());
+    links = select_neighbors(candidates, max_links(layer));
+}
+
+std::vector<uint32_t> HNSWVectorStore::get_links(uint32_t node, int layer) const {
+    std::lock_guard<std::mutex> node_lock(nodes_[node]->mutex);
+    return nodes_[node]->links[layer];
+}
+
+float HNSWVectorStore::distance(const float* a, const float* b) const {
+    switch (config_.metric) {
+        case DistanceMetric::EUCLIDEAN:
+            return l2_distance_squared(a, b, vectors_.dimension());
+        case DistanceMetric::DOT_PRODUCT:
+            return -dot_product(a, b, vectors_.dimension());
+        case DistanceMetric::COSINE:
+        default:
+            return 1.0f - dot_product(a, b, vectors_.dimension());
+    }
+}
+
+double HNSWVectorStore::to_score(float distance) const {
+    switch (config_.metric) {
+        case DistanceMetric::EUCLIDEAN:
+            return 1.0 / (1.0 + std::sqrt(distance));
+        case DistanceMetric::DOT_PRODUCT:
+            return -distance;
+        case DistanceMetric::COSINE:
+        default:
+            return 1.0 - distance;
+    }
+}
+
+size_t HNSWVectorStore::max_links(int layer) const {
+    return layer == 0 ? config_.M * 2 : config_.M;
+}
+
+int HNSWVectorStore::random_level() {
+    std::uniform_real_distribution<double> distribution(0.0, 1.0);
+    double r = std::max(distribution(rng_), 1e-12);
+    return static_cast<int>(-std::log(r) * level_multiplier_);
+}
+
+String HNSWVectorStore::generate_id() {
+    static const char charset[] =
+        "0123456789"
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+        "abcdefghijklmnopqrstuvwxyz";
+
+    String result;
+    result.reserve(16);
+
+    for (int i = 0; i < 16; ++i) {
+        result += charset[rng_() % (sizeof(charset) - 1)];
+    }
+
+    return result;
+}
+
+} // namespace langchain
@@ -0,0 +1,253 @@
+#include "../include/langchain/ingestion.h"
+#include <filesystem>
+#include <iostream>
+#include <thread>
+
+namespace langchain {
+
+namespace {
+
+int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Chunks travelling from the embedding stage to the store stage
+struct EmbeddedBatch {
+    std::vector<Document> documents;
+    std::vector<Embedding> embeddings;  // Empty when the store embeds itself
+};
+
+// Start workers for one stage; the last one to finish closes the queue it feeds
+template <typename Queue>
+void start_stage(std::vector<std::thread>& threads, size_t workers, Queue& output,
+                 std::shared_ptr<std::atomic<size_t>> remaining, std::function<void()> work) {
+    remaining->store(workers);
+    for (size_t i = 0; i < workers; ++i) {
+        threads.emplace_back([&output, remaining, work]() {
+            work();
+            if (--*remaining == 0) {
+                output.close();
+            }
+        });
+    }
+}
+
+// Joins the stage threads when run() returns or unwinds. The queues are closed
+// first, so stages blocked on a consumer that stopped early can finish.
+class StageThreads {
+private:
+    std::vector<std::thread> threads_;
+    std::function<void()> close_queues_;
+
+public:
+    explicit StageThreads(std::function<void()> close_queues) : close_queues_(std::move(close_queues)) {}
+
+    ~StageThreads() { join(); }
+
+    std::vector<std::thread>& threads() { return threads_; }
+
+    void join() {
+        close_queues_();
+        for (auto& thread : threads_) {
+            if (thread.joinable()) {
+                thread.join();
+            }
+        }
+    }
+};
+
+} // namespace
+
+// IngestionPipeline implementation
+IngestionPipeline::IngestionPipeline(std::shared_ptr<VectorStore> vector_store,
+                                     std::shared_ptr<TextSplitter> text_splitter,
+                                     std::shared_ptr<Embeddings> embeddings,
+                                     const IngestionConfig& config)
+    : vector_store_(vector_store), text_splitter_(text_splitter), embeddings_(embeddings), config_(config),
+      documents_loaded_(0), chunks_split_(0), chunks_embedded_(0), chunks_stored_(0),
+      store_batches_(0), errors_(0), start_time_ns_(0), end_time_ns_(0) {
+    config_.loader_workers = std::max<size_t>(1, config_.loader_workers);
+    config_.splitter_workers = std::max<size_t>(1, config_.splitter_workers);
+    config_.embedder_workers = std::max<size_t>(1, config_.embedder_workers);
+    config_.embed_batch_size = std::max<size_t>(1, config_.embed_batch_size);
+    config_.insert_batch_size = std::max<size_t>(1, config_.insert_batch_size);
+}
+
+IngestionStats IngestionPipeline::ingest_files(const StringList& file_paths) {
+    return run(file_paths.size(), [&](size_t i) { return DocumentLoader::load_document(file_paths[i]); });
+}
+
+IngestionStats IngestionPipeline::ingest_directory(const String& directory_path) {
+    StringList file_paths;
+    try {
+        for (const auto& entry : std::filesystem::directory_iterator(directory_path)) {
+            String extension = entry.path().extension().string();
+            if (entry.is_regular_file() && (extension == ".txt" || extension == ".md")) {
+                file_paths.push_back(entry.path().string());
+            }
+        }
+    } catch (const std::filesystem::filesystem_error& ex) {
+        std::cerr << "Error reading directory: " << ex.what() << std::endl;
+    }
+    return ingest_files(file_paths);
+}
+
+IngestionStats IngestionPipeline::ingest_documents(const std::vector<Document>& documents) {
+    return run(documents.size(), [&](size_t i) { return documents[i]; });
+}
+
+IngestionStats IngestionPipeline::get_stats() const {
+    IngestionStats stats;
+    stats.documents_loaded = documents_loaded_;
+    stats.chunks_split = chunks_split_;
+    stats.chunks_embedded = chunks_embedded_;
+    stats.chunks_stored = chunks_stored_;
+    stats.store_batches = store_batches_;
+    stats.errors = errors_;
+    int64_t start = start_time_ns_;
+    int64_t end = end_time_ns_;
+    if (start != 0) {
+        stats.elapsed_seconds = static_cast<double>((end != 0 ? end : now_ns()) - start) / 1e9;
+    }
+    if (stats.elapsed_seconds > 0.0) {
+        stats.chunks_per_second = stats.chunks_stored / stats.elapsed_seconds;
+    }
+    return stats;
+}
+
+IngestionStats IngestionPipeline::run(size_t count, const std::function<Document(size_t)>& load) {
+    std::lock_guard<std::mutex> run_lock(run_mutex_);
+    documents_loaded_ = 0;
+    chunks_split_ = 0;
+    chunks_embedded_ = 0;
+    chunks_stored_ = 0;
+    store_batches_ = 0;
+    errors_ = 0;
+    end_time_ns_ = 0;
+    start_time_ns_ = now_ns();
+
+    BoundedQueue<Document> loaded(config_.queue_capacity);
+    BoundedQueue<Document> chunks(config_.queue_capacity);
+    BoundedQueue<EmbeddedBatch> embedded(std::max<size_t>(2, config_.queue_capacity / config_.embed_batch_size));
+    StageThreads stages([&]() {
+        loaded.close();
+        chunks.close();
+        embedded.close();
+    });
+    std::vector<std::thread>& threads = stages.threads();
+
+    // Loader: claim source documents by index
+    std::atomic<size_t> next(0);
+    start_stage(threads, config_.loader_workers, loaded, std::make_shared<std::atomic<size_t>>(), [&]() {
+        for (size_t i = next++; i < count; i = next++) {
+            try {
+                Document document = load(i);
+                documents_loaded_++;
+                loaded.push(std::move(document));
+            } catch (const std::exception& e) {
+                std::cerr << "Ingestion failed to load document " << i << ": " << e.what() << std::endl;
+                errors_++;
+            }
+        }
+    });
+
+    // Splitter: one source document at a time into chunks
+    start_stage(threads, config_.splitter_workers, chunks, std::make_shared<std::atomic<size_t>>(), [&]() {
+        std::vector<Document> items;
+        while (loaded.pop(items)) {
+            for (const auto& document : items) {
+                try {
+                    std::vector<Document> parts = text_splitter_->split_document(document);
+                    chunks_split_ += parts.size();
+                    for (auto& part : parts) {
+                        // Chunks of documents without an ID get generated IDs from the store
+                        if (document.id.empty()) {
+                            part.id.clear();
+                        }
+                        chunks.push(std::move(part));
+                    }
+                } catch (const std::exception& e) {
+                    std::cerr << "Ingestion failed to split document " << document.id << ": " << e.what() << std::endl;
+                    errors_++;
+                }
+            }
+            items.clear();
+        }
+    });
+
+    // Embedder: batches of chunks per model call
+    start_stage(threads, config_.embedder_workers, embedded, std::make_shared<std::atomic<size_t>>(), [&]() {
+        std::vector<Document> items;
+        while (chunks.pop(items, config_.embed_batch_size)) {
+            EmbeddedBatch batch;
+            batch.documents.swap(items);
+            if (embeddings_) {
+                StringList texts;
+                texts.reserve(batch.documents.size());
+                for (const auto& document : batch.documents) {
+                    texts.push_back(document.content);
+                }
+                try {
+                    batch.embeddings = embeddings_->embed_documents(texts);
+                } catch (const std::exception& e) {
+                    std::cerr << "Ingestion failed to embed a batch: " << e.what() << std::endl;
+                    errors_ += batch.documents.size();
+                    continue;
+                }
+                if (batch.embeddings.size() != batch.documents.size()) {
+                    std::cerr << "Ingestion embedding model returned " << batch.embeddings.size()
+                              << " vectors for " << batch.documents.size() << " chunks" << std::endl;
+                    errors_ += batch.documents.size();
+                    continue;
+                }
+                chunks_embedded_ += batch.documents.size();
+            }
+            embedded.push(std::move(batch));
+        }
+    });
+
+    // Store: the calling thread gathers insert batches
+    EmbeddedBatch pending;
+    auto flush = [&]() {
+        if (pending.documents.empty()) {
+            return;
+        }
+        try {
+            if (embeddings_) {
+                vector_store_->add_embedded_documents(pending.documents, pending.embeddings);
+            } else {
+                vector_store_->add_documents(pending.documents);
+            }
+            chunks_stored_ += pending.documents.size();
+            store_batches_++;
+        } catch (const std::exception& e) {
+            std::cerr << "Ingestion failed to store a batch: " << e.what() << std::endl;
+            errors_ += pending.documents.size();
+        }
+        pending.documents.clear();
+        pending.embeddings.clear();
+    };
+    std::vector<EmbeddedBatch> batches;
+    while (embedded.pop(batches)) {
+        for (auto& batch : batches) {
+            for (size_t i = 0; i < batch.documents.size(); ++i) {
+                pending.documents.push_back(std::move(batch.documents[i]));
+                if (!batch.embeddings.empty()) {
+                    pending.embeddings.push_back(std::move(batch.embeddings[i]));
+                }
+                if (pending.documents.size() >= config_.insert_batch_size) {
+                    flush();
+                }
+            }
+        }
+        batches.clear();
+    }
+    flush();
+
+    stages.join();
+    end_time_ns_ = now_ns();
+    return get_stats();
+}
+
+} // namespace langchain
@@ -0,0 +1,269 @@
+#include "../include/langchain/ivf.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+namespace langchain {
+
+// IVFFlatVectorStore implementation
+IVFFlatVectorStore::InvertedList::InvertedList(size_t dimension)
+    : vectors(dimension) {}
+
+IVFFlatVectorStore::IVFFlatVectorStore(std::shared_ptr<Embeddings> embeddings, const IVFConfig& config)
+    : embeddings_(embeddings),
+      config_(config),
+      centroids_(embeddings->dimension()),
+      size_(0),
+      trained_(false),
+      rng_(std::chrono::steady_clock::now().time_since_epoch().count()) {
+    config_.nlist = std::max<size_t>(config_.nlist, 1);
+    config_.nprobe = std::max<size_t>(config_.nprobe, 1);
+    if (config_.auto_train_size == 0) {
+        config_.auto_train_size = config_.nlist * 39;
+    }
+    // Before training everything lives in a single list
+    lists_.emplace_back(embeddings->dimension());
+}
+
+StringList IVFFlatVectorStore::add_documents(const std::vector<Document>& documents) {
+    StringList texts;
+    texts.reserve(documents.size());
+    for (const auto& doc : documents) {
+        texts.push_back(doc.content);
+    }
+    std::vector<Embedding> embeddings = embeddings_->embed_documents(texts);
+    if (embeddings.size() != documents.size()) {
+        throw std::runtime_error("IVFFlatVectorStore: embedding model returned " + std::to_string(embeddings.size()) +
+                                 " vectors for " + std::to_string(documents.size()) + " documents");
+    }
+
+    StringList new_ids;
+    for (size_t i = 0; i < documents.size(); ++i) {
+        Embedding& embedding = embeddings[i];
+        embedding.resize(centroids_.dimension(), 0.0f);
+        if (config_.metric == DistanceMetric::COSINE) {
+            normalize(embedding.data(), embedding.size());
+        }
+
+        String id = documents[i].id.empty() ? generate_id() : documents[i].id;
+
+        // Adding an existing ID replaces the previous document
+        if (id_to_slot_.count(id)) {
+            delete_documents({id});
+        }
+
+        uint32_t slot = static_cast<uint32_t>(documents_.size());
+        Document doc_with_id = documents[i];
+        doc_with_id.id = id;
+        documents_.push_back(doc_with_id);
+        locations_.push_back({0, 0});
+        id_to_slot_[id] = slot;
+        add_to_list(slot, embedding.data());
+        size_++;
+
+        new_ids.push_back(id);
+    }
+
+    if (!trained_ && size_ >= config_.auto_train_size) {
+        train();
+    }
+
+    return new_ids;
+}
+
+std::vector<Document> IVFFlatVectorStore::similarity_search(const String& query, int k) {
+    auto results_with_scores = similarity_search_with_score(query, k);
+    std::vector<Document> results;
+    for (const auto& pair : results_with_scores) {
+        results.push_back(pair.first);
+    }
+    return results;
+}
+
+std::vector<std::pair<Document, double>> IVFFlatVectorStore::similarity_search_with_score(
+    const String& query, int k) {
+
+    std::vector<std::pair<Document, double>> results;
+    if (k <= 0 || size_ == 0) {
+        return results;
+    }
+
+    Embedding query_vector = prepare_query(query);
+    size_t dimension = centroids_.dimension();
+
+    // Pick the nprobe lists whose centroids are closest to the query
+    std::vector<uint32_t> probes;
+    if (!trained_) {
+        probes.push_back(0);
+    } else {
+        std::vector<std::pair<float, uint32_t>> centroid_scores;
+        for (uint32_t c = 0; c < centroids_.rows(); ++c) {
+            float score = spherical() ? dot_product(query_vector.data(), centroids_.row(c), dimension)
+                                      : -l2_distance_squared(query_vector.data(), centroids_.row(c), dimension);
+            centroid_scores.push_back({score, c});
+        }
+        size_t nprobe = std::min(config_.nprobe, centroid_scores.size());
+        std::partial_sort(centroid_scores.begin(), centroid_scores.begin() + nprobe, centroid_scores.end(),
+                          [](const auto& a, const auto& b) { return a.first > b.first; });
+        for (size_t i = 0; i < nprobe; ++i) {
+            probes.push_back(centroid_scores[i].second);
+        }
+    }
+
+    // Scan only the probed lists
+    TopKCollector top_k(static_cast<size_t>(k));
+    for (uint32_t list : probes) {
+        const InvertedList& inverted_list = lists_[list];
+        for (size_t i = 0; i < inverted_list.slots.size(); ++i) {
+            double score = similarity_score(config_.metric, query_vector.data(),
+                                            inverted_list.vectors.row(i), dimension);
+            top_k.push(score, inverted_list.slots[i]);
+        }
+    }
+
+    for (const auto& candidate : top_k.take_sorted()) {
+        results.push_back({documents_[candidate.second], candidate.first});
+    }
+    return results;
+}
+
+void IVFFlatVectorStore::delete_documents(const StringList& ids) {
+    for (const auto& id : ids) {
+        auto it = id_to_slot_.find(id);
+        if (it == id_to_slot_.end()) {
+            continue;
+        }
+        uint32_t slot = it->second;
+        Location location = locations_[slot];
+        InvertedList& list = lists_[location.list];
+
+        // Move the last entry of the list into the hole
+        uint32_t last = static_cast<uint32_t>(list.slots.size() - 1);
+        if (location.position != last) {
+            uint32_t moved = list.slots[last];
+            list.slots[location.position] = moved;
+            std::memcpy(list.vectors.mutable_row(location.position), list.vectors.row(last),
+                        list.vectors.dimension() * sizeof(float));
+            locations_[moved].position = location.position;
+        }
+        list.slots.pop_back();
+        list.vectors.erase(last);
+
+        documents_[slot] = Document();
+        id_to_slot_.erase(it);
+        size_--;
+    }
+}
+
+std::vector<Document> IVFFlatVectorStore::get_by_ids(const StringList& ids) {
+    std::vector<Document> result;
+    for (const auto& id : ids) {
+        auto it = id_to_slot_.find(id);
+        if (it != id_to_slot_.end()) {
+            result.push_back(documents_[it->second]);
+        }
+    }
+    return result;
+}
+
+void IVFFlatVectorStore::train() {
+    if (size_ == 0) {
+        return;
+    }
+    size_t dimension = centroids_.dimension();
+
+    // Train on a bounded random sample of the stored vectors
+    size_t sample_size = std::min(size_, config_.nlist * 256);
+    std::vector<std::pair<uint32_t, uint32_t>> entries;
+    entries.reserve(size_);
+    for (uint32_t list = 0; list < lists_.size(); ++list) {
+        for (uint32_t i = 0; i < lists_[list].slots.size(); ++i) {
+            entries.push_back({list, i});
+        }
+    }
+    std::shuffle(entries.begin(), entries.end(), rng_);
+    VectorMatrix sample(dimension);
+    sample.reserve(sample_size);
+    for (size_t i = 0; i < sample_size; ++i) {
+        sample.append(lists_[entries[i].first].vectors.row(entries[i].second));
+    }
+
+    centroids_ = train_kmeans(sample, config_.nlist, config_.training_iterations,
+                              config_.training_batch_size, spherical(), config_.seed);
+    trained_ = true;
+
+    // Reassign every vector to its nearest centroid, releasing old lists as we go
+    std::vector<InvertedList> old_lists;
+    old_lists.swap(lists_);
+    for (size_t c = 0; c < centroids_.rows(); ++c) {
+        lists_.emplace_back(dimension);
+    }
+    for (auto& old_list : old_lists) {
+        for (size_t i = 0; i < old_list.slots.size(); ++i) {
+            add_to_list(old_list.slots[i], old_list.vectors.row(i));
+        }
+        old_list.vectors.clear();
+        old_list.slots.clear();
+    }
+}
+
+bool IVFFlatVectorStore::is_trained() const {
+    return trained_;
+}
+
+void IVFFlatVectorStore::set_nprobe(size_t nprobe) {
+    config_.nprobe = std::max<size_t>(nprobe, 1);
+}
+
+size_t IVFFlatVectorStore::size() const {
+    return size_;
+}
+
+std::vector<size_t> IVFFlatVectorStore::get_list_sizes() const {
+    std::vector<size_t> sizes;
+    for (const auto& list : lists_) {
+        sizes.push_back(list.slots.size());
+    }
+    return sizes;
+}
+
+// Private methods
+void IVFFlatVectorStore::add_to_list(uint32_t slot, const float* vector) {
+    uint32_t list = trained_ ? static_cast<uint32_t>(nearest_centroid(centroids_, vector, spherical())) : 0;
+    InvertedList& inverted_list = lists_[list];
+    locations_[slot] = {list, static_cast<uint32_t>(inverted_list.slots.size())};
+    inverted_list.slots.push_back(slot);
+    inverted_list.vectors.append(vector);
+}
+
+Embedding IVFFlatVectorStore::prepare_query(const String& query) {
+    Embedding query_vector = embeddings_->embed_query(query);
+    query_vector.resize(centroids_.dimension(), 0.0f);
+    if (config_.metric == DistanceMetric::COSINE) {
+        normalize(query_vector.data(), query_vector.size());
+    }
+    return query_vector;
+}
+
+bool IVFFlatVectorStore::spherical() const {
+    return config_.metric != DistanceMetric::EUCLIDEAN;
+}
+
+String IVFFlatVectorStore::generate_id() {
+    static const char charset[] =
+        "0123456789"
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+        "abcdefghijklmnopqrstuvwxyz";
+
+    String result;
+    result.reserve(16);
+
+    for (int i = 0; i < 16; ++i) {
+        result += charset[rng_() % (sizeof(charset) - 1)];
+    }
+
+    return result;
+}
+
+} // namespace langchain
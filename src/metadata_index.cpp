@@ -0,0 +1,68 @@
+#include "../include/langchain/metadata_index.h"
+#include <algorithm>
+#include <iterator>
+
+namespace langchain {
+
+// MetadataIndex implementation
+void MetadataIndex::add_document(uint32_t slot, const StringMap& metadata) {
+    for (const auto& entry : metadata) {
+        slots_[entry.first][entry.second].push_back(slot);
+    }
+}
+
+std::vector<uint32_t> MetadataIndex::match(const MetadataFilter& filter) const {
+    std::vector<const std::vector<uint32_t>*> sets;
+    sets.reserve(filter.size());
+    for (const auto& condition : filter) {
+        auto key = slots_.find(condition.first);
+        if (key == slots_.end()) {
+            return {};
+        }
+        auto value = key->second.find(condition.second);
+        if (value == key->second.end()) {
+            return {};
+        }
+        sets.push_back(&value->second);
+    }
+    if (sets.empty()) {
+        return {};
+    }
+
+    // Intersect smallest first so the running result only shrinks
+    std::sort(sets.begin(), sets.end(), [](const std::vector<uint32_t>* a, const std::vector<uint32_t>* b) {
+        return a->size() < b->size();
+    });
+    std::vector<uint32_t> result = *sets[0];
+    for (size_t i = 1; i < sets.size() && !result.empty(); ++i) {
+        const std::vector<uint32_t>& other = *sets[i];
+        std::vector<uint32_t> next;
+        if (result.size() * 16 < other.size()) {
+            // Much smaller running set: binary search each slot in the larger one
+            for (uint32_t slot : result) {
+                if (std::binary_search(other.begin(), other.end(), slot)) {
+                    next.push_back(slot);
+                }
+            }
+        } else {
+            std::set_intersection(result.begin(), result.end(), other.begin(), other.end(),
+                                  std::back_inserter(next));
+        }
+        result.swap(next);
+    }
+    return result;
+}
+
+size_t MetadataIndex::value_count() const {
+    size_t count = 0;
+    for (const auto& key : slots_) {
+        count += key.second.size();
+    }
+    return count;
+}
+
+void MetadataIndex::clear() {
+    slots_.clear();
+}
+
+} // namespace langchain
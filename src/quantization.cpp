@@ -0,0 +1,582 @@
+#include "../include/langchain/quantization.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <unordered_set>
+
+namespace langchain {
+
+// ScalarQuantizer implementation
+ScalarQuantizer::ScalarQuantizer(size_t dimension)
+    : dimension_(dimension), min_(dimension, 0.0f), scale_(dimension, 0.0f) {}
+
+void ScalarQuantizer::train(const VectorMatrix& data) {
+    if (data.empty()) {
+        return;
+    }
+    std::vector<float> max(dimension_);
+    std::memcpy(min_.data(), data.row(0), dimension_ * sizeof(float));
+    std::memcpy(max.data(), data.row(0), dimension_ * sizeof(float));
+    for (size_t r = 1; r < data.rows(); ++r) {
+        const float* row = data.row(r);
+        for (size_t i = 0; i < dimension_; ++i) {
+            min_[i] = std::min(min_[i], row[i]);
+            max[i] = std::max(max[i], row[i]);
+        }
+    }
+    for (size_t i = 0; i < dimension_; ++i) {
+        scale_[i] = (max[i] - min_[i]) / 255.0f;
+    }
+}
+
+void ScalarQuantizer::encode(const float* vector, uint8_t* code) const {
+    for (size_t i = 0; i < dimension_; ++i) {
+        if (scale_[i] == 0.0f) {
+            code[i] = 0;
+            continue;
+        }
+        // Values outside the trained range are clamped
+        float level = std::round((vector[i] - min_[i]) / scale_[i]);
+        code[i] = static_cast<uint8_t>(std::min(255.0f, std::max(0.0f, level)));
+    }
+}
+
+void ScalarQuantizer::decode(const uint8_t* code, float* vector) const {
+    for (size_t i = 0; i < dimension_; ++i) {
+        vector[i] = min_[i] + scale_[i] * static_cast<float>(code[i]);
+    }
+}
+
+float ScalarQuantizer::code_norm(const uint8_t* code) const {
+    float norm = 0.0f;
+    for (size_t i = 0; i < dimension_; ++i) {
+        float value = scale_[i] * static_cast<float>(code[i]);
+        norm += value * value;
+    }
+    return norm;
+}
+
+float ScalarQuantizer::prepare_query(const float* query, bool euclidean, float* weights) const {
+    float offset = 0.0f;
+    for (size_t i = 0; i < dimension_; ++i) {
+        if (euclidean) {
+            float residual = query[i] - min_[i];
+            weights[i] = residual * scale_[i];
+            offset += residual * residual;
+        } else {
+            weights[i] = query[i] * scale_[i];
+            offset += query[i] * min_[i];
+        }
+    }
+    return offset;
+}
+
+size_t ScalarQuantizer::dimension() const {
+    return dimension_;
+}
+
+// ProductQuantizer implementation
+ProductQuantizer::ProductQuantizer(size_t dimension, size_t subspaces)
+    : dimension_(dimension),
+      subspaces_(std::max<size_t>(subspaces, 1)),
+      sub_dimension_((dimension + subspaces_ - 1) / subspaces_) {}
+
+void ProductQuantizer::train(const VectorMatrix& data, size_t iterations, unsigned int seed) {
+    codebooks_.clear();
+    std::vector<float> sub_vector(sub_dimension_);
+    for (size_t s = 0; s < subspaces_; ++s) {
+        VectorMatrix sub_data(sub_dimension_);
+        sub_data.reserve(data.rows());
+        for (size_t r = 0; r < data.rows(); ++r) {
+            extract(data.row(r), s, sub_vector.data());
+            sub_data.append(sub_vector.data());
+        }
+        codebooks_.push_back(train_kmeans(sub_data, 256, iterations, 1024, false, seed + s));
+    }
+}
+
+void ProductQuantizer::encode(const float* vector, uint8_t* code) const {
+    std::vector<float> sub_vector(sub_dimension_);
+    for (size_t s = 0; s < subspaces_; ++s) {
+        extract(vector, s, sub_vector.data());
+        code[s] = static_cast<uint8_t>(nearest_centroid(codebooks_[s], sub_vector.data(), false));
+    }
+}
+
+void ProductQuantizer::decode(const uint8_t* code, float* vector) const {
+    for (size_t s = 0; s < subspaces_; ++s) {
+        size_t begin = s * sub_dimension_;
+        size_t end = std::min(begin + sub_dimension_, dimension_);
+        if (begin < end) {
+            std::memcpy(vector + begin, codebooks_[s].row(code[s]), (end - begin) * sizeof(float));
+        }
+    }
+}
+
+void ProductQuantizer::compute_table(const float* query, bool euclidean, float* table) const {
+    std::vector<float> sub_query(sub_dimension_);
+    for (size_t s = 0; s < subspaces_; ++s) {
+        extract(query, s, sub_query.data());
+        const VectorMatrix& codebook = codebooks_[s];
+        float* entries = table + s * 256;
+        for (size_t c = 0; c < codebook.rows(); ++c) {
+            entries[c] = euclidean ? l2_distance_squared(sub_query.data(), codebook.row(c), sub_dimension_)
+                                   : dot_product(sub_query.data(), codebook.row(c), sub_dimension_);
+        }
+    }
+}
+
+float ProductQuantizer::score(const float* table, const uint8_t* code) const {
+    float sum = 0.0f;
+    for (size_t s = 0; s < subspaces_; ++s) {
+        sum += table[s * 256 + code[s]];
+    }
+    return sum;
+}
+
+size_t ProductQuantizer::subspaces() const {
+    return subspaces_;
+}
+
+void ProductQuantizer::extract(const float* vector, size_t subspace, float* out) const {
+    size_t begin = subspace * sub_dimension_;
+    size_t end = std::min(begin + sub_dimension_, dimension_);
+    size_t count = begin < end ? end - begin : 0;
+    if (count > 0) {
+        std::memcpy(out, vector + begin, count * sizeof(float));
+    }
+    std::fill(out + count, out + sub_dimension_, 0.0f);
+}
+
+// BinaryQuantizer implementation
+BinaryQuantizer::BinaryQuantizer(size_t dimension) : dimension_(dimension), words_((dimension + 63) / 64) {}
+
+void BinaryQuantizer::encode(const float* vector, uint64_t* code) const {
+    std::fill(code, code + words_, 0);
+    for (size_t i = 0; i < dimension_; ++i) {
+        if (vector[i] > 0.0f) {
+            code[i / 64] |= uint64_t(1) << (i % 64);
+        }
+    }
+}
+
+double BinaryQuantizer::similarity(uint32_t distance) const {
+    if (dimension_ == 0) {
+        return 0.0;
+    }
+    // For random hyperplanes each differing bit stands for an equal share of the angle
+    return std::cos(std::acos(-1.0) * distance / dimension_);
+}
+
+size_t BinaryQuantizer::words() const {
+    return words_;
+}
+
+// QuantizedVectorStore implementation
+QuantizedVectorStore::QuantizedVectorStore(std::shared_ptr<Embeddings> embeddings,
+                                           const QuantizationConfig& config)
+    : embeddings_(embeddings),
+      config_(config),
+      dimension_(embeddings->dimension()),
+      size_(0),
+      pending_(embeddings->dimension()),
+      trained_(false),
+      scalar_quantizer_(embeddings->dimension()),
+      product_quantizer_(embeddings->dimension(),
+                         std::min(std::max<size_t>(config.pq_subspaces, 1), embeddings->dimension())),
+      binary_quantizer_(embeddings->dimension()),
+      code_size_(0),
+      rng_(std::chrono::steady_clock::now().time_since_epoch().count()) {
+    if (config_.type == QuantizationType::PRODUCT) {
+        code_size_ = product_quantizer_.subspaces();
+    } else if (config_.type == QuantizationType::BINARY) {
+        code_size_ = binary_quantizer_.words();
+    } else {
+        code_size_ = dimension_;
+    }
+    // Half precision and sign bits are plain conversions, so vectors are encoded from the start
+    trained_ = is_half_precision() || config_.type == QuantizationType::BINARY;
+    config_.training_size = std::max<size_t>(config_.training_size, 1);
+
+    if (!config_.full_precision_path.empty()) {
+        full_precision_file_.open(config_.full_precision_path,
+                                  std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!full_precision_file_.is_open()) {
+            std::cerr << "Error opening full precision vector file: " << config_.full_precision_path << std::endl;
+        }
+    }
+}
+
+StringList QuantizedVectorStore::add_documents(const std::vector<Document>& documents) {
+    StringList texts;
+    texts.reserve(documents.size());
+    for (const auto& doc : documents) {
+        texts.push_back(doc.content);
+    }
+    std::vector<Embedding> embeddings = embeddings_->embed_documents(texts);
+    if (embeddings.size() != documents.size()) {
+        throw std::runtime_error("QuantizedVectorStore: embedding model returned " + std::to_string(embeddings.size()) +
+                                 " vectors for " + std::to_string(documents.size()) + " documents");
+    }
+    if (config_.type == QuantizationType::BINARY) {
+        // Sign codes are appended from the first document; grow once per batch
+        size_t needed = (documents_.size() + documents.size()) * code_size_;
+        if (needed > binary_codes_.capacity()) {
+            binary_codes_.reserve(std::max(needed, binary_codes_.capacity() * 2));
+        }
+    }
+
+    StringList new_ids;
+    for (size_t i = 0; i < documents.size(); ++i) {
+        Embedding& embedding = embeddings[i];
+        embedding.resize(dimension_, 0.0f);
+        if (config_.metric == DistanceMetric::COSINE) {
+            normalize(embedding.data(), embedding.size());
+        }
+
+        String id = documents[i].id.empty() ? generate_id() : documents[i].id;
+
+        // Adding an existing ID replaces the previous document
+        if (id_to_slot_.count(id)) {
+            delete_documents({id});
+        }
+
+        uint32_t slot = static_cast<uint32_t>(documents_.size());
+        Document doc_with_id = documents[i];
+        doc_with_id.id = id;
+        documents_.push_back(doc_with_id);
+        deleted_.push_back(0);
+        id_to_slot_[id] = slot;
+        size_++;
+
+        // Full precision vectors go to disk at a fixed offset per slot
+        if (full_precision_file_.is_open()) {
+            full_precision_file_.seekp(static_cast<std::streamoff>(slot) * dimension_ * sizeof(float));
+            full_precision_file_.write(reinterpret_cast<const char*>(embedding.data()),
+                                       dimension_ * sizeof(float));
+        }
+
+        if (trained_) {
+            append_code(embedding.data());
+        } else {
+            pending_.append(embedding.data());
+        }
+
+        new_ids.push_back(id);
+    }
+
+    if (full_precision_file_.is_open()) {
+        full_precision_file_.flush();
+    }
+
+    if (!trained_ && pending_.rows() >= config_.training_size) {
+        train();
+    }
+
+    return new_ids;
+}
+
+std::vector<Document> QuantizedVectorStore::similarity_search(const String& query, int k) {
+    auto results_with_scores = similarity_search_with_score(query, k);
+    std::vector<Document> results;
+    for (const auto& pair : results_with_scores) {
+        results.push_back(pair.first);
+    }
+    return results;
+}
+
+std::vector<std::pair<Document, double>> QuantizedVectorStore::similarity_search_with_score(
+    const String& query, int k) {
+
+    std::vector<std::pair<Document, double>> results;
+    if (k <= 0 || size_ == 0) {
+        return results;
+    }
+
+    Embedding query_vector = prepare_query(query);
+    for (const auto& candidate : search_slots(query_vector.data(), static_cast<size_t>(k))) {
+        results.push_back({documents_[candidate.second], candidate.first});
+    }
+    return results;
+}
+
+void QuantizedVectorStore::delete_documents(const StringList& ids) {
+    for (const auto& id : ids) {
+        auto it = id_to_slot_.find(id);
+        if (it == id_to_slot_.end()) {
+            continue;
+        }
+        // Codes stay in place and are skipped by scans
+        deleted_[it->second] = 1;
+        documents_[it->second] = Document();
+        id_to_slot_.erase(it);
+        size_--;
+    }
+}
+
+std::vector<Document> QuantizedVectorStore::get_by_ids(const StringList& ids) {
+    std::vector<Document> result;
+    for (const auto& id : ids) {
+        auto it = id_to_slot_.find(id);
+        if (it != id_to_slot_.end()) {
+            result.push_back(documents_[it->second]);
+        }
+    }
+    return result;
+}
+
+void QuantizedVectorStore::train() {
+    if (trained_ || pending_.empty()) {
+        return;
+    }
+
+    if (config_.type == QuantizationType::PRODUCT) {
+        product_quantizer_.train(pending_, 25, config_.seed);
+    } else {
+        scalar_quantizer_.train(pending_);
+    }
+    trained_ = true;
+
+    codes_.reserve(pending_.rows() * code_size_);
+    for (size_t r = 0; r < pending_.rows(); ++r) {
+        append_code(pending_.row(r));
+    }
+
+    // Release the float buffer
+    pending_ = VectorMatrix(dimension_);
+}
+
+bool QuantizedVectorStore::is_trained() const {
+    return trained_;
+}
+
+size_t QuantizedVectorStore::size() const {
+    return size_;
+}
+
+size_t QuantizedVectorStore::memory_usage() const {
+    return codes_.capacity() + binary_codes_.capacity() * sizeof(uint64_t) + half_codes_.capacity() * sizeof(uint16_t) +
+           code_norms_.capacity() * sizeof(float) + pending_.memory_usage();
+}
+
+QuantizationReport QuantizedVectorStore::evaluate(const StringList& queries, int k) {
+    QuantizationReport report;
+    report.queries = queries.size();
+    report.k = k;
+    report.code_bytes = memory_usage();
+    report.full_precision_bytes = documents_.size() * dimension_ * sizeof(float);
+    if (report.code_bytes > 0) {
+        report.compression_ratio = static_cast<double>(report.full_precision_bytes) / report.code_bytes;
+    }
+
+    if (!full_precision_file_.is_open()) {
+        std::cerr << "Recall evaluation needs full_precision_path to be set" << std::endl;
+        return report;
+    }
+    if (queries.empty() || k <= 0 || size_ == 0) {
+        return report;
+    }
+
+    size_t hits = 0;
+    size_t expected = 0;
+    for (const auto& query : queries) {
+        Embedding query_vector = prepare_query(query);
+        auto exact = exact_scan(query_vector.data(), static_cast<size_t>(k));
+        auto approximate = search_slots(query_vector.data(), static_cast<size_t>(k));
+
+        std::unordered_set<uint32_t> found;
+        for (const auto& candidate : approximate) {
+            found.insert(candidate.second);
+        }
+        for (const auto& candidate : exact) {
+            hits += found.count(candidate.second);
+        }
+        expected += exact.size();
+    }
+    report.recall = expected > 0 ? static_cast<double>(hits) / expected : 0.0;
+    return report;
+}
+
+// Private methods
+std::vector<std::pair<double, uint32_t>> QuantizedVectorStore::search_slots(const float* query, size_t k) {
+    bool rescoring = trained_ && config_.rescore_candidates > 0 && full_precision_file_.is_open();
+    size_t count = rescoring ? std::max(k, config_.rescore_candidates) : k;
+
+    std::vector<std::pair<double, uint32_t>> candidates = scan(query, count);
+    if (rescoring) {
+        rescore(query, candidates);
+    }
+    if (candidates.size() > k) {
+        candidates.resize(k);
+    }
+    return candidates;
+}
+
+std::vector<std::pair<double, uint32_t>> QuantizedVectorStore::scan(const float* query, size_t count) const {
+    TopKCollector top_k(count);
+    bool euclidean = config_.metric == DistanceMetric::EUCLIDEAN;
+    uint32_t slots = static_cast<uint32_t>(documents_.size());
+
+    if (!trained_) {
+        // Vectors are still full precision, so the scan is exact
+        for (uint32_t slot = 0; slot < slots; ++slot) {
+            if (!deleted_[slot]) {
+                top_k.push(similarity_score(config_.metric, query, pending_.row(slot), dimension_), slot);
+            }
+        }
+    } else if (is_half_precision()) {
+        // 16-bit values are widened inside the kernel and accumulated in float
+        bool bf16 = config_.type == QuantizationType::BFLOAT16;
+        for (uint32_t slot = 0; slot < slots; ++slot) {
+            if (deleted_[slot]) {
+                continue;
+            }
+            const uint16_t* code = &half_codes_[slot * code_size_];
+            double score;
+            if (euclidean) {
+                float distance = bf16 ? l2_distance_squared_bf16(query, code, dimension_)
+                                      : l2_distance_squared_f16(query, code, dimension_);
+                score = 1.0 / (1.0 + std::sqrt(distance));
+            } else {
+                score = bf16 ? dot_product_bf16(query, code, dimension_) : dot_product_f16(query, code, dimension_);
+            }
+            top_k.push(score, slot);
+        }
+    } else if (config_.type == QuantizationType::BINARY) {
+        // XOR + popcount against the query's own code; rank by distance and
+        // convert only the winners into similarity estimates
+        std::vector<uint64_t> query_code(code_size_);
+        binary_quantizer_.encode(query, query_code.data());
+        for (uint32_t slot = 0; slot < slots; ++slot) {
+            if (!deleted_[slot]) {
+                uint32_t distance = hamming_distance(query_code.data(), &binary_codes_[slot * code_size_], code_size_);
+                top_k.push(-static_cast<double>(distance), slot);
+            }
+        }
+        std::vector<std::pair<double, uint32_t>> results = top_k.take_sorted();
+        for (auto& result : results) {
+            result.first = binary_quantizer_.similarity(static_cast<uint32_t>(-result.first));
+        }
+        return results;
+    } else if (config_.type == QuantizationType::PRODUCT) {
+        // Asymmetric distance computation: one table lookup per subspace
+        std::vector<float> table(product_quantizer_.subspaces() * 256, 0.0f);
+        product_quantizer_.compute_table(query, euclidean, table.data());
+        for (uint32_t slot = 0; slot < slots; ++slot) {
+            if (deleted_[slot]) {
+                continue;
+            }
+            float value = product_quantizer_.score(table.data(), &codes_[slot * code_size_]);
+            double score = euclidean ? 1.0 / (1.0 + std::sqrt(std::max(0.0f, value))) : value;
+            top_k.push(score, slot);
+        }
+    } else {
+        std::vector<float> weights(dimension_);
+        float offset = scalar_quantizer_.prepare_query(query, euclidean, weights.data());
+        for (uint32_t slot = 0; slot < slots; ++slot) {
+            if (deleted_[slot]) {
+                continue;
+            }
+            float dot = dot_product_u8(weights.data(), &codes_[slot * code_size_], dimension_);
+            double score;
+            if (euclidean) {
+                float distance = std::max(0.0f, offset - 2.0f * dot + code_norms_[slot]);
+                score = 1.0 / (1.0 + std::sqrt(distance));
+            } else {
+                score = offset + dot;
+            }
+            top_k.push(score, slot);
+        }
+    }
+    return top_k.take_sorted();
+}
+
+std::vector<std::pair<double, uint32_t>> QuantizedVectorStore::exact_scan(const float* query, size_t count) {
+    TopKCollector top_k(count);
+    std::vector<float> vector(dimension_);
+    for (uint32_t slot = 0; slot < documents_.size(); ++slot) {
+        if (!deleted_[slot] && read_full_precision(slot, vector.data())) {
+            top_k.push(similarity_score(config_.metric, query, vector.data(), dimension_), slot);
+        }
+    }
+    return top_k.take_sorted();
+}
+
+void QuantizedVectorStore::rescore(const float* query, std::vector<std::pair<double, uint32_t>>& candidates) {
+    std::vector<float> vector(dimension_);
+    for (auto& candidate : candidates) {
+        if (read_full_precision(candidate.second, vector.data())) {
+            candidate.first = similarity_score(config_.metric, query, vector.data(), dimension_);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(),
+              [](const auto& a, const auto& b) { return a.first > b.first; });
+}
+
+void QuantizedVectorStore::append_code(const float* vector) {
+    if (is_half_precision()) {
+        bool bf16 = config_.type == QuantizationType::BFLOAT16;
+        for (size_t i = 0; i < dimension_; ++i) {
+            half_codes_.push_back(bf16 ? float_to_bf16(vector[i]) : float_to_f16(vector[i]));
+        }
+        return;
+    }
+    if (config_.type == QuantizationType::BINARY) {
+        size_t offset = binary_codes_.size();
+        binary_codes_.resize(offset + code_size_);
+        binary_quantizer_.encode(vector, &binary_codes_[offset]);
+        return;
+    }
+
+    size_t offset = codes_.size();
+    codes_.resize(offset + code_size_);
+    if (config_.type == QuantizationType::PRODUCT) {
+        product_quantizer_.encode(vector, &codes_[offset]);
+    } else {
+        scalar_quantizer_.encode(vector, &codes_[offset]);
+        if (config_.metric == DistanceMetric::EUCLIDEAN) {
+            code_norms_.push_back(scalar_quantizer_.code_norm(&codes_[offset]));
+        }
+    }
+}
+
+bool QuantizedVectorStore::is_half_precision() const {
+    return config_.type == QuantizationType::FLOAT16 || config_.type == QuantizationType::BFLOAT16;
+}
+
+bool QuantizedVectorStore::read_full_precision(uint32_t slot, float* vector) {
+    full_precision_file_.clear();
+    full_precision_file_.seekg(static_cast<std::streamoff>(slot) * dimension_ * sizeof(float));
+    full_precision_file_.read(reinterpret_cast<char*>(vector), dimension_ * sizeof(float));
+    return static_cast<bool>(full_precision_file_);
+}
+
+Embedding QuantizedVectorStore::prepare_query(const String& query) {
+    Embedding query_vector = embeddings_->embed_query(query);
+    query_vector.resize(dimension_, 0.0f);
+    if (config_.metric == DistanceMetric::COSINE) {
+        normalize(query_vector.data(), query_vector.size());
+    }
+    return query_vector;
+}
+
+String QuantizedVectorStore::generate_id() {
+    static const char charset[] =
+        "0123456789"
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+        "abcdefghijklmnopqrstuvwxyz";
+
+    String result;
+    result.reserve(16);
+
+    for (int i = 0; i < 16; ++i) {
+        result += charset[rng_() % (sizeof(charset) - 1)];
+    }
+
+    return result;
+}
+
+} // namespace langchain
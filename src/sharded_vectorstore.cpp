@@ -0,0 +1,240 @@
+#include "../include/langchain/sharded_vectorstore.h"
+#include "../include/langchain/vector_math.h"
+#include <chrono>
+#include <exception>
+#include <stdexcept>
+
+namespace langchain {
+
+namespace {
+
+// FNV-1a, so routing stays the same across runs and platforms
+uint64_t hash_id(const String& id) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : id) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+} // namespace
+
+// ShardedVectorStore implementation
+ShardedVectorStore::ShardedVectorStore(size_t shard_count,
+                                       const std::function<std::shared_ptr<VectorStore>()>& factory)
+    : rng_(std::chrono::steady_clock::now().time_since_epoch().count()) {
+    shard_count = std::max<size_t>(1, shard_count);
+    shards_.reserve(shard_count);
+    for (size_t i = 0; i < shard_count; ++i) {
+        shards_.push_back(factory());
+        if (!shards_.back()) {
+            throw std::invalid_argument("ShardedVectorStore factory returned a null shard");
+        }
+    }
+}
+
+ShardedVectorStore::ShardedVectorStore(std::vector<std::shared_ptr<VectorStore>> shards)
+    : shards_(std::move(shards)),
+      rng_(std::chrono::steady_clock::now().time_since_epoch().count()) {
+    if (shards_.empty()) {
+        throw std::invalid_argument("ShardedVectorStore needs at least one shard");
+    }
+    for (const auto& shard : shards_) {
+        if (!shard) {
+            throw std::invalid_argument("ShardedVectorStore shard is null");
+        }
+    }
+}
+
+StringList ShardedVectorStore::add_documents(const std::vector<Document>& documents) {
+    // IDs decide the shard, so missing ones are assigned here
+    StringList ids;
+    ids.reserve(documents.size());
+    for (const auto& doc : documents) {
+        ids.push_back(doc.id.empty() ? generate_id() : doc.id);
+    }
+
+    // Each shard embeds and stores its part of the batch in parallel
+    auto positions = route(ids);
+    for_each_shard([&](size_t s) {
+        if (positions[s].empty()) {
+            return;
+        }
+        std::vector<Document> part;
+        part.reserve(positions[s].size());
+        for (size_t position : positions[s]) {
+            part.push_back(documents[position]);
+            part.back().id = ids[position];
+        }
+        shards_[s]->add_documents(part);
+    });
+    return ids;
+}
+
+std::vector<Document> ShardedVectorStore::similarity_search(const String& query, int k) {
+    auto results_with_scores = similarity_search_with_score(query, k);
+    std::vector<Document> results;
+    for (const auto& pair : results_with_scores) {
+        results.push_back(pair.first);
+    }
+    return results;
+}
+
+std::vector<std::pair<Document, double>> ShardedVectorStore::similarity_search_with_score(
+    const String& query, int k) {
+    return scatter_gather(k, [&](VectorStore& shard) { return shard.similarity_search_with_score(query, k); });
+}
+
+std::vector<std::vector<std::pair<Document, double>>> ShardedVectorStore::similarity_search_batch_with_score(
+    const StringList& queries, int k) {
+
+    std::vector<std::vector<std::pair<Document, double>>> results(queries.size());
+    if (k <= 0 || queries.empty()) {
+        return results;
+    }
+
+    // One batched call per shard, then merge shard lists per query
+    std::vector<std::vector<std::vector<std::pair<Document, double>>>> shard_results(shards_.size());
+    for_each_shard([&](size_t s) {
+        shard_results[s] = shards_[s]->similarity_search_batch_with_score(queries, k);
+    });
+    for (size_t q = 0; q < queries.size(); ++q) {
+        std::vector<std::vector<std::pair<Document, double>>> per_shard(shards_.size());
+        for (size_t s = 0; s < shards_.size(); ++s) {
+            per_shard[s] = std::move(shard_results[s][q]);
+        }
+        results[q] = merge_top_k(per_shard, k);
+    }
+    return results;
+}
+
+std::vector<std::pair<Document, double>> ShardedVectorStore::similarity_search_with_filter(
+    const String& query, int k, const MetadataFilter& filter) {
+    return scatter_gather(k, [&](VectorStore& shard) { return shard.similarity_search_with_filter(query, k, filter); });
+}
+
+void ShardedVectorStore::delete_documents(const StringList& ids) {
+    auto positions = route(ids);
+    for (size_t s = 0; s < shards_.size(); ++s) {
+        if (positions[s].empty()) {
+            continue;
+        }
+        StringList part;
+        part.reserve(positions[s].size());
+        for (size_t position : positions[s]) {
+            part.push_back(ids[position]);
+        }
+        shards_[s]->delete_documents(part);
+    }
+}
+
+std::vector<Document> ShardedVectorStore::get_by_ids(const StringList& ids) {
+    std::vector<Document> result;
+    for (const auto& id : ids) {
+        auto found = shards_[shard_for_id(id)]->get_by_ids({id});
+        for (auto& doc : found) {
+            result.push_back(std::move(doc));
+        }
+    }
+    return result;
+}
+
+size_t ShardedVectorStore::shard_count() const {
+    return shards_.size();
+}
+
+std::shared_ptr<VectorStore> ShardedVectorStore::shard(size_t index) const {
+    return shards_.at(index);
+}
+
+size_t ShardedVectorStore::shard_for_id(const String& id) const {
+    return hash_id(id) % shards_.size();
+}
+
+void ShardedVectorStore::set_thread_pool(std::shared_ptr<ThreadPool> pool) {
+    thread_pool_ = pool;
+}
+
+// Private methods
+ThreadPool& ShardedVectorStore::pool() const {
+    return thread_pool_ ? *thread_pool_ : ThreadPool::shared();
+}
+
+void ShardedVectorStore::for_each_shard(const std::function<void(size_t)>& task) const {
+    // Every shard runs to completion even if another one fails
+    std::vector<std::exception_ptr> errors(shards_.size());
+    pool().parallel_for(shards_.size(), [&](size_t s) {
+        try {
+            task(s);
+        } catch (...) {
+            errors[s] = std::current_exception();
+        }
+    });
+    for (const auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+std::vector<std::pair<Document, double>> ShardedVectorStore::scatter_gather(
+    int k, const std::function<std::vector<std::pair<Document, double>>(VectorStore&)>& search) const {
+
+    if (k <= 0) {
+        return {};
+    }
+    std::vector<std::vector<std::pair<Document, double>>> shard_results(shards_.size());
+    for_each_shard([&](size_t s) {
+        shard_results[s] = search(*shards_[s]);
+    });
+    return merge_top_k(shard_results, k);
+}
+
+std::vector<std::pair<Document, double>> ShardedVectorStore::merge_top_k(
+    std::vector<std::vector<std::pair<Document, double>>>& shard_results, int k) {
+
+    // Number candidates across shards; equal scores keep shard order
+    std::vector<std::pair<size_t, size_t>> positions;
+    TopKCollector top_k(static_cast<size_t>(k));
+    for (size_t s = 0; s < shard_results.size(); ++s) {
+        for (size_t i = 0; i < shard_results[s].size(); ++i) {
+            top_k.push(shard_results[s][i].second, static_cast<uint32_t>(positions.size()));
+            positions.push_back({s, i});
+        }
+    }
+
+    std::vector<std::pair<Document, double>> results;
+    for (const auto& candidate : top_k.take_sorted()) {
+        const auto& position = positions[candidate.second];
+        results.push_back(std::move(shard_results[position.first][position.second]));
+    }
+    return results;
+}
+
+std::vector<std::vector<size_t>> ShardedVectorStore::route(const StringList& ids) const {
+    std::vector<std::vector<size_t>> positions(shards_.size());
+    for (size_t i = 0; i < ids.size(); ++i) {
+        positions[shard_for_id(ids[i])].push_back(i);
+    }
+    return positions;
+}
+
+String ShardedVectorStore::generate_id() {
+    static const char charset[] =
+        "0123456789"
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+        "abcdefghijklmnopqrstuvwxyz";
+
+    std::lock_guard<std::mutex> lock(id_mutex_);
+    String result;
+    result.reserve(16);
+
+    for (int i = 0; i < 16; ++i) {
+        result += charset[rng_() % (sizeof(charset) - 1)];
+    }
+
+    return result;
+}
+
+} // namespace langchain
@@ -0,0 +1,285 @@
+#include "../include/langchain/text_index.h"
+#include <algorithm>
+#include <cmath>
+
+namespace langchain {
+
+namespace {
+
+// Sort term ids and count each run into a TermVector
+void count_ids(std::vector<TermId>& ids, TermVector& out) {
+    out.clear();
+    std::sort(ids.begin(), ids.end());
+    for (size_t i = 0; i < ids.size();) {
+        size_t end = i + 1;
+        while (end < ids.size() && ids[end] == ids[i]) {
+            end++;
+        }
+        out.push_back({ids[i], static_cast<uint32_t>(end - i)});
+        i = end;
+    }
+}
+
+} // namespace
+
+// TermDictionary implementation
+TermId TermDictionary::intern(std::string_view term) {
+    auto it = ids_.find(term);
+    if (it != ids_.end()) {
+        return it->second;
+    }
+    TermId id = static_cast<TermId>(terms_.size());
+    terms_.emplace_back(term);
+    ids_.emplace(std::string_view(terms_.back()), id);
+    return id;
+}
+
+TermId TermDictionary::find(std::string_view term) const {
+    auto it = ids_.find(term);
+    return it == ids_.end() ? UNKNOWN_TERM : it->second;
+}
+
+std::string_view TermDictionary::term(TermId id) const {
+    return id < terms_.size() ? std::string_view(terms_[id]) : std::string_view();
+}
+
+void TermDictionary::encode(const std::vector<std::string_view>& tokens, TermVector& out) {
+    scratch_.clear();
+    for (std::string_view token : tokens) {
+        scratch_.push_back(intern(token));
+    }
+    count_ids(scratch_, out);
+}
+
+size_t TermDictionary::lookup(const std::vector<std::string_view>& tokens, TermVector& out) const {
+    std::vector<TermId> ids;
+    ids.reserve(tokens.size());
+    for (std::string_view token : tokens) {
+        TermId id = find(token);
+        if (id != UNKNOWN_TERM) {
+            ids.push_back(id);
+        }
+    }
+    size_t unknown = tokens.size() - ids.size();
+    count_ids(ids, out);
+    return unknown;
+}
+
+size_t TermDictionary::size() const {
+    return terms_.size();
+}
+
+void TermDictionary::clear() {
+    ids_.clear();
+    terms_.clear();
+}
+
+// TermOverlay implementation
+TermOverlay::TermOverlay(const TermDictionary& base)
+    : base_(base), first_overflow_id_(static_cast<TermId>(base.size())) {}
+
+void TermOverlay::encode(const std::vector<std::string_view>& tokens, TermVector& out) {
+    scratch_.clear();
+    for (std::string_view token : tokens) {
+        TermId id = base_.find(token);
+        scratch_.push_back(id != TermDictionary::UNKNOWN_TERM ? id : first_overflow_id_ + overflow_.intern(token));
+    }
+    count_ids(scratch_, out);
+}
+
+std::string_view TermOverlay::term(TermId id) const {
+    return id < first_overflow_id_ ? base_.term(id) : overflow_.term(id - first_overflow_id_);
+}
+
+size_t TermOverlay::overflow_size() const {
+    return overflow_.size();
+}
+
+uint32_t total_frequency(const TermVector& terms) {
+    uint32_t total = 0;
+    for (const auto& entry : terms) {
+        total += entry.frequency;
+    }
+    return total;
+}
+
+double term_norm(const TermVector& terms) {
+    double sum = 0.0;
+    for (const auto& entry : terms) {
+        sum += static_cast<double>(entry.frequency) * entry.frequency;
+    }
+    return std::sqrt(sum);
+}
+
+size_t shared_term_count(const TermVector& a, const TermVector& b) {
+    size_t shared = 0;
+    size_t i = 0;
+    size_t j = 0;
+    while (i < a.size() && j < b.size()) {
+        if (a[i].term < b[j].term) {
+            ++i;
+        } else if (b[j].term < a[i].term) {
+            ++j;
+        } else {
+            shared++;
+            ++i;
+            ++j;
+        }
+    }
+    return shared;
+}
+
+double term_jaccard_similarity(const TermVector& a, const TermVector& b) {
+    size_t intersection = shared_term_count(a, b);
+    size_t union_size = a.size() + b.size() - intersection;
+    return union_size == 0 ? 0.0 : static_cast<double>(intersection) / union_size;
+}
+
+double term_cosine_similarity(const TermVector& a, const TermVector& b) {
+    // Dot product over shared terms; each norm covers all terms of its side
+    double dot = 0.0;
+    double norm_a = 0.0;
+    double norm_b = 0.0;
+    size_t i = 0;
+    size_t j = 0;
+    while (i < a.size() && j < b.size()) {
+        if (a[i].term < b[j].term) {
+            norm_a += static_cast<double>(a[i].frequency) * a[i].frequency;
+            ++i;
+        } else if (b[j].term < a[i].term) {
+            norm_b += static_cast<double>(b[j].frequency) * b[j].frequency;
+            ++j;
+        } else {
+            dot += static_cast<double>(a[i].frequency) * b[j].frequency;
+            norm_a += static_cast<double>(a[i].frequency) * a[i].frequency;
+            norm_b += static_cast<double>(b[j].frequency) * b[j].frequency;
+            ++i;
+            ++j;
+        }
+    }
+    for (; i < a.size(); ++i) {
+        norm_a += static_cast<double>(a[i].frequency) * a[i].frequency;
+    }
+    for (; j < b.size(); ++j) {
+        norm_b += static_cast<double>(b[j].frequency) * b[j].frequency;
+    }
+    if (norm_a == 0.0 || norm_b == 0.0) {
+        return 0.0;
+    }
+    return dot / (std::sqrt(norm_a) * std::sqrt(norm_b));
+}
+
+double term_euclidean_distance(const TermVector& a, const TermVector& b) {
+    double sum = 0.0;
+    size_t i = 0;
+    size_t j = 0;
+    while (i < a.size() || j < b.size()) {
+        double diff;
+        if (j == b.size() || (i < a.size() && a[i].term < b[j].term)) {
+            diff = a[i++].frequency;
+        } else if (i == a.size() || b[j].term < a[i].term) {
+            diff = b[j++].frequency;
+        } else {
+            diff = static_cast<double>(a[i++].frequency) - b[j++].frequency;
+        }
+        sum += diff * diff;
+    }
+    return std::sqrt(sum);
+}
+
+double term_dot_product(const TermVector& a, const TermVector& b) {
+    double dot = 0.0;
+    size_t i = 0;
+    size_t j = 0;
+    while (i < a.size() && j < b.size()) {
+        if (a[i].term < b[j].term) {
+            ++i;
+        } else if (b[j].term < a[i].term) {
+            ++j;
+        } else {
+            dot += static_cast<double>(a[i].frequency) * b[j].frequency;
+            ++i;
+            ++j;
+        }
+    }
+    return dot;
+}
+
+double sparse_cosine_similarity(const SparseTermVector& a, const SparseTermVector& b) {
+    if (a.norm == 0.0 || b.norm == 0.0) {
+        return 0.0;
+    }
+    return term_dot_product(a.terms, b.terms) / (a.norm * b.norm);
+}
+
+double sparse_euclidean_distance(const SparseTermVector& a, const SparseTermVector& b) {
+    // |a - b|^2 = |a|^2 + |b|^2 - 2 a.b; rounding can leave a tiny negative remainder
+    double squared = a.norm * a.norm + b.norm * b.norm - 2.0 * term_dot_product(a.terms, b.terms);
+    return std::sqrt(std::max(0.0, squared));
+}
+
+double term_overlap_similarity(const TermVector& a, const TermVector& b) {
+    uint32_t common = 0;
+    size_t i = 0;
+    size_t j = 0;
+    while (i < a.size() && j < b.size()) {
+        if (a[i].term < b[j].term) {
+            ++i;
+        } else if (b[j].term < a[i].term) {
+            ++j;
+        } else {
+            common += a[i].frequency;
+            ++i;
+            ++j;
+        }
+    }
+    uint32_t max_words = std::max(total_frequency(a), total_frequency(b));
+    return max_words == 0 ? 0.0 : static_cast<double>(common) / max_words;
+}
+
+// InvertedIndex implementation
+uint32_t InvertedIndex::add_document(const std::vector<std::string_view>& tokens) {
+    uint32_t slot = static_cast<uint32_t>(document_lengths_.size());
+    document_lengths_.push_back(static_cast<uint32_t>(tokens.size()));
+
+    dictionary_.encode(tokens, scratch_);
+    for (const auto& entry : scratch_) {
+        if (entry.term >= postings_.size()) {
+            postings_.resize(entry.term + 1);
+        }
+        postings_[entry.term].push_back({slot, entry.frequency});
+    }
+    return slot;
+}
+
+const std::vector<Posting>* InvertedIndex::get_postings(std::string_view term) const {
+    return get_postings(dictionary_.find(term));
+}
+
+const std::vector<Posting>* InvertedIndex::get_postings(TermId term) const {
+    return term < postings_.size() ? &postings_[term] : nullptr;
+}
+
+const TermDictionary& InvertedIndex::dictionary() const {
+    return dictionary_;
+}
+
+uint32_t InvertedIndex::document_length(uint32_t slot) const {
+    return slot < document_lengths_.size() ? document_lengths_[slot] : 0;
+}
+
+size_t InvertedIndex::document_count() const {
+    return document_lengths_.size();
+}
+
+size_t InvertedIndex::term_count() const {
+    return dictionary_.size();
+}
+
+void InvertedIndex::clear() {
+    postings_.clear();
+    dictionary_.clear();
+    document_lengths_.clear();
+}
+
+} // namespace langchain
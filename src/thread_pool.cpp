@@ -0,0 +1,123 @@
+#include "../include/langchain/thread_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+namespace langchain {
+
+// ThreadPool implementation
+ThreadPool::ThreadPool(size_t threads) : stopping_(false) {
+    workers_.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        workers_.emplace_back([this]() { run(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    available_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+    return pool;
+}
+
+void ThreadPool::parallel_for(size_t count, const std::function<void(size_t)>& task) {
+    if (count == 0) {
+        return;
+    }
+    if (count == 1 || workers_.empty()) {
+        for (size_t i = 0; i < count; ++i) {
+            task(i);
+        }
+        return;
+    }
+
+    // Tasks are claimed from a shared counter; helpers that start late find nothing left.
+    // Every index is claimed and counted even after a failure, so the caller's wait below
+    // always ends, and it outlives every use of body.
+    struct State {
+        std::atomic<size_t> next{0};
+        std::atomic<bool> failed{false};
+        size_t done = 0;
+        std::exception_ptr error;
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+    auto state = std::make_shared<State>();
+    size_t total = count;
+    const std::function<void(size_t)>* body = &task;
+    auto drain = [state, total, body]() {
+        size_t completed = 0;
+        std::exception_ptr error;
+        for (size_t i = state->next++; i < total; i = state->next++) {
+            if (!state->failed) {
+                try {
+                    (*body)(i);
+                } catch (...) {
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                    state->failed = true;
+                }
+            }
+            completed++;
+        }
+        if (completed > 0) {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (error && !state->error) {
+                state->error = error;
+            }
+            state->done += completed;
+            if (state->done == total) {
+                state->finished.notify_all();
+            }
+        }
+    };
+
+    size_t helpers = std::min(workers_.size(), count - 1);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t i = 0; i < helpers; ++i) {
+            queue_.push_back(drain);
+        }
+    }
+    if (helpers == 1) {
+        available_.notify_one();
+    } else {
+        available_.notify_all();
+    }
+
+    drain();
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->finished.wait(lock, [&]() { return state->done == total; });
+    if (state->error) {
+        std::rethrow_exception(state->error);
+    }
+}
+
+void ThreadPool::run() {
+    for (;;) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            available_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) {
+                return;
+            }
+            job = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        job();
+    }
+}
+
+} // namespace langchain
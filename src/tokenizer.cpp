@@ -0,0 +1,235 @@
+#include "../include/langchain/tokenizer.h"
+#include <cctype>
+#include <cstring>
+
+namespace langchain {
+
+namespace {
+
+// Lowercase mapping and separator flags for ASCII bytes
+struct AsciiTable {
+    char lower[128];
+    bool space[128];
+    bool punct[128];
+
+    AsciiTable() {
+        for (int c = 0; c < 128; ++c) {
+            lower[c] = static_cast<char>(std::tolower(c));
+            space[c] = std::isspace(c) != 0;
+            punct[c] = std::ispunct(c) != 0;
+        }
+    }
+};
+
+const AsciiTable& ascii_table() {
+    static const AsciiTable table;
+    return table;
+}
+
+// Non-ASCII code points that separate words: Unicode spaces and CJK / fullwidth punctuation,
+// which is where CJK text breaks since it has no spaces between words
+bool is_separator(uint32_t code_point) {
+    return code_point == 0x85 || code_point == 0xA0 || code_point == 0x1680 ||
+           (code_point >= 0x2000 && code_point <= 0x200A) ||
+           code_point == 0x2028 || code_point == 0x2029 || code_point == 0x202F || code_point == 0x205F ||
+           (code_point >= 0x3000 && code_point <= 0x3003) ||   // Ideographic space, 、。〃
+           (code_point >= 0x3008 && code_point <= 0x3011) ||   // CJK brackets
+           (code_point >= 0xFF01 && code_point <= 0xFF0F) ||   // Fullwidth ！ to ／
+           (code_point >= 0xFF1A && code_point <= 0xFF20) ||   // Fullwidth ： to ＠
+           (code_point >= 0xFF3B && code_point <= 0xFF40) ||
+           (code_point >= 0xFF5B && code_point <= 0xFF65);     // Fullwidth ｛ to halfwidth ･
+}
+
+// Lowercase of a two-byte code point; every mapping stays two bytes long, so text can
+// be lowercased in place. Covers Latin-1, Greek and Cyrillic capitals.
+uint32_t lower_code_point(uint32_t code_point) {
+    if ((code_point >= 0xC0 && code_point <= 0xDE && code_point != 0xD7) ||
+        (code_point >= 0x391 && code_point <= 0x3A9 && code_point != 0x3A2) ||
+        (code_point >= 0x410 && code_point <= 0x42F)) {
+        return code_point + 0x20;
+    }
+    if (code_point >= 0x400 && code_point <= 0x40F) {
+        return code_point + 0x50;
+    }
+    return code_point;
+}
+
+} // namespace
+
+uint32_t decode_utf8(std::string_view text, size_t i, size_t& length) {
+    unsigned char lead = static_cast<unsigned char>(text[i]);
+    length = 1;
+    if (lead < 0x80) {
+        return lead;
+    }
+
+    size_t size;
+    uint32_t code_point;
+    uint32_t minimum;
+    if ((lead & 0xE0) == 0xC0) {
+        size = 2;
+        code_point = lead & 0x1F;
+        minimum = 0x80;
+    } else if ((lead & 0xF0) == 0xE0) {
+        size = 3;
+        code_point = lead & 0x0F;
+        minimum = 0x800;
+    } else if ((lead & 0xF8) == 0xF0) {
+        size = 4;
+        code_point = lead & 0x07;
+        minimum = 0x10000;
+    } else {
+        return lead;
+    }
+    if (i + size > text.size()) {
+        return lead;
+    }
+    for (size_t j = 1; j < size; ++j) {
+        unsigned char next = static_cast<unsigned char>(text[i + j]);
+        if ((next & 0xC0) != 0x80) {
+            return lead;
+        }
+        code_point = (code_point << 6) | (next & 0x3F);
+    }
+    // Overlong forms, surrogates and values past U+10FFFF are malformed
+    if (code_point < minimum || code_point > 0x10FFFF || (code_point >= 0xD800 && code_point <= 0xDFFF)) {
+        return lead;
+    }
+    length = size;
+    return code_point;
+}
+
+bool is_cjk_character(uint32_t code_point) {
+    return (code_point >= 0x4E00 && code_point <= 0x9FFF) ||     // CJK unified ideographs
+           (code_point >= 0x3400 && code_point <= 0x4DBF) ||     // Extension A
+           (code_point >= 0x20000 && code_point <= 0x2FA1F) ||   // Extensions B and later, compatibility supplement
+           (code_point >= 0xF900 && code_point <= 0xFAFF) ||     // Compatibility ideographs
+           (code_point >= 0x3040 && code_point <= 0x30FA) ||     // Hiragana and Katakana
+           (code_point >= 0x30FC && code_point <= 0x30FF) ||     // Prolonged sound and iteration marks
+           (code_point >= 0x31F0 && code_point <= 0x31FF) ||     // Katakana phonetic extensions
+           (code_point >= 0xFF66 && code_point <= 0xFF9F) ||     // Halfwidth Katakana
+           (code_point >= 0xAC00 && code_point <= 0xD7AF) ||     // Hangul syllables
+           (code_point >= 0x1100 && code_point <= 0x11FF) ||     // Hangul Jamo
+           (code_point >= 0x3130 && code_point <= 0x318F);       // Hangul compatibility Jamo
+}
+
+// Tokenizer implementation
+Tokenizer::Tokenizer(bool strip_punctuation, CjkSegmentation cjk_segmentation)
+    : strip_punctuation_(strip_punctuation), cjk_segmentation_(cjk_segmentation) {}
+
+const std::vector<std::string_view>& Tokenizer::tokenize(std::string_view text) {
+    const AsciiTable& table = ascii_table();
+    const size_t none = static_cast<size_t>(-1);
+    buffer_.resize(text.size());
+    tokens_.clear();
+
+    size_t start = none;
+    size_t i = 0;
+    while (i < text.size()) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c < 0x80) {
+            // ASCII fast path: one table lookup per byte
+            if (table.space[c]) {
+                if (start != none) {
+                    emit(start, i);
+                    start = none;
+                }
+            } else {
+                buffer_[i] = table.lower[c];
+                if (start == none) {
+                    start = i;
+                }
+            }
+            ++i;
+            continue;
+        }
+
+        size_t length;
+        uint32_t code_point = decode_utf8(text, i, length);
+        // The katakana middle dot ・ only separates when CJK runs are segmented, so NONE
+        // keeps the tokens of the tokenizer before segmentation existed
+        if (length > 1 && (is_separator(code_point) ||
+                           (code_point == 0x30FB && cjk_segmentation_ != CjkSegmentation::NONE))) {
+            if (start != none) {
+                emit(start, i);
+                start = none;
+            }
+            i += length;
+            continue;
+        }
+        if (length > 1 && cjk_segmentation_ != CjkSegmentation::NONE && is_cjk_character(code_point)) {
+            if (start != none) {
+                emit(start, i);
+                start = none;
+            }
+            i = segment_cjk_run(text, i);
+            continue;
+        }
+        if (start == none) {
+            start = i;
+        }
+        uint32_t lower = length == 2 ? lower_code_point(code_point) : code_point;
+        if (lower != code_point) {
+            buffer_[i] = static_cast<char>(0xC0 | (lower >> 6));
+            buffer_[i + 1] = static_cast<char>(0x80 | (lower & 0x3F));
+        } else {
+            std::memcpy(&buffer_[i], text.data() + i, length);
+        }
+        i += length;
+    }
+    if (start != none) {
+        emit(start, text.size());
+    }
+    return tokens_;
+}
+
+const std::vector<std::string_view>& Tokenizer::tokens() const {
+    return tokens_;
+}
+
+size_t Tokenizer::segment_cjk_run(std::string_view text, size_t i) {
+    // CJK characters have no case, so the run is copied to the buffer unchanged
+    const size_t none = static_cast<size_t>(-1);
+    size_t run_start = i;
+    size_t previous = none;
+    while (i < text.size()) {
+        size_t length;
+        uint32_t code_point = decode_utf8(text, i, length);
+        if (length == 1 || !is_cjk_character(code_point)) {
+            break;
+        }
+        std::memcpy(&buffer_[i], text.data() + i, length);
+        if (cjk_segmentation_ == CjkSegmentation::UNIGRAM) {
+            tokens_.emplace_back(buffer_.data() + i, length);
+        } else if (previous != none) {
+            tokens_.emplace_back(buffer_.data() + previous, i + length - previous);
+        }
+        previous = i;
+        i += length;
+    }
+    if (cjk_segmentation_ == CjkSegmentation::BIGRAM && previous == run_start) {
+        tokens_.emplace_back(buffer_.data() + run_start, i - run_start);
+    }
+    return i;
+}
+
+void Tokenizer::emit(size_t begin, size_t end) {
+    if (strip_punctuation_) {
+        const AsciiTable& table = ascii_table();
+        auto is_punct = [&](char c) {
+            unsigned char byte = static_cast<unsigned char>(c);
+            return byte < 0x80 && table.punct[byte];
+        };
+        while (begin < end && is_punct(buffer_[begin])) {
+            begin++;
+        }
+        while (end > begin && is_punct(buffer_[end - 1])) {
+            end--;
+        }
+    }
+    if (end > begin) {
+        tokens_.emplace_back(buffer_.data() + begin, end - begin);
+    }
+}
+
+} // namespace langchain
@@ -0,0 +1,1001 @@
+#include "../include/langchain/vector_math.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+
+// Runtime dispatched x86 kernels need GCC/Clang target attributes
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define LANGCHAIN_X86_KERNELS 1
+#include <immintrin.h>
+#else
+#define LANGCHAIN_X86_KERNELS 0
+#endif
+
+namespace langchain {
+
+// VectorMatrix implementation
+VectorMatrix::VectorMatrix(size_t dimension)
+    : dimension_(dimension), stride_((dimension + 15) / 16 * 16), rows_(0), view_(nullptr) {}
+
+VectorMatrix VectorMatrix::view(size_t dimension, size_t rows, const float* data,
+                                std::shared_ptr<const void> owner) {
+    VectorMatrix matrix(dimension);
+    matrix.rows_ = rows;
+    matrix.view_ = data;
+    matrix.view_owner_ = std::move(owner);
+    return matrix;
+}
+
+float* VectorMatrix::mutable_row(size_t index) {
+    materialize();
+    return data_.data() + index * stride_;
+}
+
+void VectorMatrix::reserve(size_t rows) {
+    materialize();
+    data_.reserve(rows * stride_);
+}
+
+void VectorMatrix::append(const float* vector) {
+    materialize();
+    data_.resize((rows_ + 1) * stride_, 0.0f);
+    std::memcpy(data_.data() + rows_ * stride_, vector, dimension_ * sizeof(float));
+    rows_++;
+}
+
+void VectorMatrix::erase(size_t index) {
+    if (index >= rows_) {
+        return;
+    }
+    materialize();
+    data_.erase(data_.begin() + index * stride_, data_.begin() + (index + 1) * stride_);
+    rows_--;
+}
+
+void VectorMatrix::clear() {
+    data_.clear();
+    view_ = nullptr;
+    view_owner_.reset();
+    rows_ = 0;
+}
+
+size_t VectorMatrix::memory_usage() const {
+    return data_.capacity() * sizeof(float);
+}
+
+void VectorMatrix::materialize() {
+    if (!view_) {
+        return;
+    }
+    data_.assign(view_, view_ + rows_ * stride_);
+    view_ = nullptr;
+    view_owner_.reset();
+}
+
+// Scalar kernels
+float dot_product_scalar(const float* a, const float* b, size_t n) {
+    float sum = 0.0f;
+    for (size_t i = 0; i < n; ++i) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+float l2_distance_squared_scalar(const float* a, const float* b, size_t n) {
+    float sum = 0.0f;
+    for (size_t i = 0; i < n; ++i) {
+        float diff = a[i] - b[i];
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+float cosine_similarity_scalar(const float* a, const float* b, size_t n) {
+    float dot = 0.0f;
+    float norm_a = 0.0f;
+    float norm_b = 0.0f;
+    for (size_t i = 0; i < n; ++i) {
+        dot += a[i] * b[i];
+        norm_a += a[i] * a[i];
+        norm_b += b[i] * b[i];
+    }
+    if (norm_a == 0.0f || norm_b == 0.0f) {
+        return 0.0f;
+    }
+    return dot / (std::sqrt(norm_a) * std::sqrt(norm_b));
+}
+
+float dot_product_u8_scalar(const float* weights, const uint8_t* codes, size_t n) {
+    float sum = 0.0f;
+    for (size_t i = 0; i < n; ++i) {
+        sum += weights[i] * static_cast<float>(codes[i]);
+    }
+    return sum;
+}
+
+uint32_t hamming_distance_scalar(const uint64_t* a, const uint64_t* b, size_t words) {
+    uint32_t count = 0;
+    for (size_t i = 0; i < words; ++i) {
+        // Bit-parallel population count
+        uint64_t x = a[i] ^ b[i];
+        x = x - ((x >> 1) & 0x5555555555555555ULL);
+        x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+        x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+        count += static_cast<uint32_t>((x * 0x0101010101010101ULL) >> 56);
+    }
+    return count;
+}
+
+uint16_t float_to_f16(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+    uint32_t exponent = (bits >> 23) & 0xFF;
+    uint32_t mantissa = bits & 0x7FFFFF;
+    if (exponent == 0xFF) {
+        // Infinity stays infinity, NaN stays a quiet NaN
+        return sign | 0x7C00 | (mantissa ? 0x200 : 0);
+    }
+    int32_t half_exponent = static_cast<int32_t>(exponent) - 127 + 15;
+    if (half_exponent >= 31) {
+        return sign | 0x7C00;
+    }
+    if (half_exponent <= 0) {
+        // Subnormal half (or zero when even the subnormal range is too small)
+        if (half_exponent < -10) {
+            return sign;
+        }
+        mantissa |= 0x800000;
+        uint32_t shift = static_cast<uint32_t>(14 - half_exponent);
+        uint32_t half = mantissa >> shift;
+        uint32_t remainder = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (remainder > halfway || (remainder == halfway && (half & 1))) {
+            half++;
+        }
+        return sign | static_cast<uint16_t>(half);
+    }
+    uint32_t half = (static_cast<uint32_t>(half_exponent) << 10) | (mantissa >> 13);
+    uint32_t remainder = mantissa & 0x1FFF;
+    // A carry out of the mantissa correctly bumps the exponent (up to infinity)
+    if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1))) {
+        half++;
+    }
+    return sign | static_cast<uint16_t>(half);
+}
+
+float f16_to_float(uint16_t value) {
+    uint32_t sign = static_cast<uint32_t>(value & 0x8000) << 16;
+    uint32_t exponent = (value >> 10) & 0x1F;
+    uint32_t mantissa = value & 0x3FF;
+    uint32_t bits;
+    if (exponent == 0) {
+        if (mantissa == 0) {
+            bits = sign;
+        } else {
+            // Renormalize a subnormal half
+            uint32_t float_exponent = 113;
+            while (!(mantissa & 0x400)) {
+                mantissa <<= 1;
+                float_exponent--;
+            }
+            bits = sign | (float_exponent << 23) | ((mantissa & 0x3FF) << 13);
+        }
+    } else if (exponent == 31) {
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    } else {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+uint16_t float_to_bf16(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    if ((bits & 0x7FFFFFFF) > 0x7F800000) {
+        return static_cast<uint16_t>((bits >> 16) | 0x40);
+    }
+    bits += 0x7FFF + ((bits >> 16) & 1);
+    return static_cast<uint16_t>(bits >> 16);
+}
+
+float bf16_to_float(uint16_t value) {
+    uint32_t bits = static_cast<uint32_t>(value) << 16;
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+float dot_product_f16_scalar(const float* a, const uint16_t* b, size_t n) {
+    float sum = 0.0f;
+    for (size_t i = 0; i < n; ++i) {
+        sum += a[i] * f16_to_float(b[i]);
+    }
+    return sum;
+}
+
+float l2_distance_squared_f16_scalar(const float* a, const uint16_t* b, size_t n) {
+    float sum = 0.0f;
+    for (size_t i = 0; i < n; ++i) {
+        float diff = a[i] - f16_to_float(b[i]);
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+float dot_product_bf16_scalar(const float* a, const uint16_t* b, size_t n) {
+    float sum = 0.0f;
+    for (size_t i = 0; i < n; ++i) {
+        sum += a[i] * bf16_to_float(b[i]);
+    }
+    return sum;
+}
+
+float l2_distance_squared_bf16_scalar(const float* a, const uint16_t* b, size_t n) {
+    float sum = 0.0f;
+    for (size_t i = 0; i < n; ++i) {
+        float diff = a[i] - bf16_to_float(b[i]);
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+namespace {
+
+// Finish a cosine similarity from its three accumulated sums
+inline float finish_cosine(float dot, float norm_a, float norm_b) {
+    if (norm_a == 0.0f || norm_b == 0.0f) {
+        return 0.0f;
+    }
+    return dot / (std::sqrt(norm_a) * std::sqrt(norm_b));
+}
+
+#if LANGCHAIN_X86_KERNELS
+
+// SSE4.2 kernels (4 floats per step)
+__attribute__((target("sse4.2")))
+inline float horizontal_sum_sse(__m128 v) {
+    __m128 shuffled = _mm_movehdup_ps(v);
+    __m128 sums = _mm_add_ps(v, shuffled);
+    shuffled = _mm_movehl_ps(shuffled, sums);
+    sums = _mm_add_ss(sums, shuffled);
+    return _mm_cvtss_f32(sums);
+}
+
+__attribute__((target("sse4.2")))
+float dot_product_sse(const float* a, const float* b, size_t n) {
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    float sum = horizontal_sum_sse(_mm_add_ps(acc0, acc1));
+    for (; i < n; ++i) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+__attribute__((target("sse4.2")))
+float l2_distance_squared_sse(const float* a, const float* b, size_t n) {
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128 d0 = _mm_sub_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i));
+        __m128 d1 = _mm_sub_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4));
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(d0, d0));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(d1, d1));
+    }
+    float sum = horizontal_sum_sse(_mm_add_ps(acc0, acc1));
+    for (; i < n; ++i) {
+        float diff = a[i] - b[i];
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+__attribute__((target("sse4.2")))
+float cosine_similarity_sse(const float* a, const float* b, size_t n) {
+    __m128 dot = _mm_setzero_ps();
+    __m128 norm_a = _mm_setzero_ps();
+    __m128 norm_b = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 va = _mm_loadu_ps(a + i);
+        __m128 vb = _mm_loadu_ps(b + i);
+        dot = _mm_add_ps(dot, _mm_mul_ps(va, vb));
+        norm_a = _mm_add_ps(norm_a, _mm_mul_ps(va, va));
+        norm_b = _mm_add_ps(norm_b, _mm_mul_ps(vb, vb));
+    }
+    float dot_sum = horizontal_sum_sse(dot);
+    float norm_a_sum = horizontal_sum_sse(norm_a);
+    float norm_b_sum = horizontal_sum_sse(norm_b);
+    for (; i < n; ++i) {
+        dot_sum += a[i] * b[i];
+        norm_a_sum += a[i] * a[i];
+        norm_b_sum += b[i] * b[i];
+    }
+    return finish_cosine(dot_sum, norm_a_sum, norm_b_sum);
+}
+
+__attribute__((target("sse4.2")))
+float dot_product_u8_sse(const float* weights, const uint8_t* codes, size_t n) {
+    __m128 acc = _mm_setzero_ps();
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        int32_t packed;
+        std::memcpy(&packed, codes + i, sizeof(packed));
+        __m128 values = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(packed)));
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(weights + i), values));
+    }
+    float sum = horizontal_sum_sse(acc);
+    for (; i < n; ++i) {
+        sum += weights[i] * static_cast<float>(codes[i]);
+    }
+    return sum;
+}
+
+// Hardware POPCNT, one 64-bit word per instruction (shared by the SSE4.2 and AVX2 tables)
+__attribute__((target("sse4.2,popcnt")))
+uint32_t hamming_distance_popcnt(const uint64_t* a, const uint64_t* b, size_t words) {
+    uint64_t count0 = 0;
+    uint64_t count1 = 0;
+    size_t i = 0;
+    for (; i + 2 <= words; i += 2) {
+        count0 += static_cast<uint64_t>(__builtin_popcountll(a[i] ^ b[i]));
+        count1 += static_cast<uint64_t>(__builtin_popcountll(a[i + 1] ^ b[i + 1]));
+    }
+    if (i < words) {
+        count0 += static_cast<uint64_t>(__builtin_popcountll(a[i] ^ b[i]));
+    }
+    return static_cast<uint32_t>(count0 + count1);
+}
+
+// AVX2 + FMA kernels (8 floats per step)
+__attribute__((target("avx2,fma")))
+inline float horizontal_sum_avx(__m256 v) {
+    __m128 low = _mm256_castps256_ps128(v);
+    __m128 high = _mm256_extractf128_ps(v, 1);
+    __m128 sums = _mm_add_ps(low, high);
+    __m128 shuffled = _mm_movehdup_ps(sums);
+    sums = _mm_add_ps(sums, shuffled);
+    shuffled = _mm_movehl_ps(shuffled, sums);
+    sums = _mm_add_ss(sums, shuffled);
+    return _mm_cvtss_f32(sums);
+}
+
+__attribute__((target("avx2,fma")))
+float dot_product_avx2(const float* a, const float* b, size_t n) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+    }
+    if (i + 8 <= n) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+        i += 8;
+    }
+    float sum = horizontal_sum_avx(_mm256_add_ps(acc0, acc1));
+    for (; i < n; ++i) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+__attribute__((target("avx2,fma")))
+float l2_distance_squared_avx2(const float* a, const float* b, size_t n) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+        __m256 d1 = _mm256_sub_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8));
+        acc0 = _mm256_fmadd_ps(d0, d0, acc0);
+        acc1 = _mm256_fmadd_ps(d1, d1, acc1);
+    }
+    if (i + 8 <= n) {
+        __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+        acc0 = _mm256_fmadd_ps(d0, d0, acc0);
+        i += 8;
+    }
+    float sum = horizontal_sum_avx(_mm256_add_ps(acc0, acc1));
+    for (; i < n; ++i) {
+        float diff = a[i] - b[i];
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+__attribute__((target("avx2,fma")))
+float cosine_similarity_avx2(const float* a, const float* b, size_t n) {
+    __m256 dot = _mm256_setzero_ps();
+    __m256 norm_a = _mm256_setzero_ps();
+    __m256 norm_b = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 va = _mm256_loadu_ps(a + i);
+        __m256 vb = _mm256_loadu_ps(b + i);
+        dot = _mm256_fmadd_ps(va, vb, dot);
+        norm_a = _mm256_fmadd_ps(va, va, norm_a);
+        norm_b = _mm256_fmadd_ps(vb, vb, norm_b);
+    }
+    float dot_sum = horizontal_sum_avx(dot);
+    float norm_a_sum = horizontal_sum_avx(norm_a);
+    float norm_b_sum = horizontal_sum_avx(norm_b);
+    for (; i < n; ++i) {
+        dot_sum += a[i] * b[i];
+        norm_a_sum += a[i] * a[i];
+        norm_b_sum += b[i] * b[i];
+    }
+    return finish_cosine(dot_sum, norm_a_sum, norm_b_sum);
+}
+
+__attribute__((target("avx2,fma")))
+float dot_product_u8_avx2(const float* weights, const uint8_t* codes, size_t n) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(codes + i));
+        __m256 low = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(bytes));
+        __m256 high = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(bytes, 8)));
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(weights + i), low, acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(weights + i + 8), high, acc1);
+    }
+    float sum = horizontal_sum_avx(_mm256_add_ps(acc0, acc1));
+    for (; i < n; ++i) {
+        sum += weights[i] * static_cast<float>(codes[i]);
+    }
+    return sum;
+}
+
+// F16C / bf16 widening kernels (8 elements per step, scalar tail)
+__attribute__((target("avx2,fma,f16c")))
+inline __m256 load_f16_avx2(const uint16_t* values) {
+    return _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(values)));
+}
+
+__attribute__((target("avx2,fma,f16c")))
+inline __m256 load_bf16_avx2(const uint16_t* values) {
+    __m256i widened = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(values)));
+    return _mm256_castsi256_ps(_mm256_slli_epi32(widened, 16));
+}
+
+__attribute__((target("avx2,fma,f16c")))
+float dot_product_f16_avx2(const float* a, const uint16_t* b, size_t n) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), load_f16_avx2(b + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), load_f16_avx2(b + i + 8), acc1);
+    }
+    if (i + 8 <= n) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), load_f16_avx2(b + i), acc0);
+        i += 8;
+    }
+    float sum = horizontal_sum_avx(_mm256_add_ps(acc0, acc1));
+    for (; i < n; ++i) {
+        sum += a[i] * f16_to_float(b[i]);
+    }
+    return sum;
+}
+
+__attribute__((target("avx2,fma,f16c")))
+float l2_distance_squared_f16_avx2(const float* a, const uint16_t* b, size_t n) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(a + i), load_f16_avx2(b + i));
+        __m256 d1 = _mm256_sub_ps(_mm256_loadu_ps(a + i + 8), load_f16_avx2(b + i + 8));
+        acc0 = _mm256_fmadd_ps(d0, d0, acc0);
+        acc1 = _mm256_fmadd_ps(d1, d1, acc1);
+    }
+    if (i + 8 <= n) {
+        __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(a + i), load_f16_avx2(b + i));
+        acc0 = _mm256_fmadd_ps(d0, d0, acc0);
+        i += 8;
+    }
+    float sum = horizontal_sum_avx(_mm256_add_ps(acc0, acc1));
+    for (; i < n; ++i) {
+        float diff = a[i] - f16_to_float(b[i]);
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+__attribute__((target("avx2,fma,f16c")))
+float dot_product_bf16_avx2(const float* a, const uint16_t* b, size_t n) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), load_bf16_avx2(b + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), load_bf16_avx2(b + i + 8), acc1);
+    }
+    if (i + 8 <= n) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), load_bf16_avx2(b + i), acc0);
+        i += 8;
+    }
+    float sum = horizontal_sum_avx(_mm256_add_ps(acc0, acc1));
+    for (; i < n; ++i) {
+        sum += a[i] * bf16_to_float(b[i]);
+    }
+    return sum;
+}
+
+__attribute__((target("avx2,fma,f16c")))
+float l2_distance_squared_bf16_avx2(const float* a, const uint16_t* b, size_t n) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(a + i), load_bf16_avx2(b + i));
+        __m256 d1 = _mm256_sub_ps(_mm256_loadu_ps(a + i + 8), load_bf16_avx2(b + i + 8));
+        acc0 = _mm256_fmadd_ps(d0, d0, acc0);
+        acc1 = _mm256_fmadd_ps(d1, d1, acc1);
+    }
+    if (i + 8 <= n) {
+        __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(a + i), load_bf16_avx2(b + i));
+        acc0 = _mm256_fmadd_ps(d0, d0, acc0);
+        i += 8;
+    }
+    float sum = horizontal_sum_avx(_mm256_add_ps(acc0, acc1));
+    for (; i < n; ++i) {
+        float diff = a[i] - bf16_to_float(b[i]);
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+// AVX-512 kernels (16 floats per step, masked tail)
+__attribute__((target("avx512f")))
+float dot_product_avx512(const float* a, const float* b, size_t n) {
+    __m512 acc0 = _mm512_setzero_ps();
+    __m512 acc1 = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+        acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16), acc1);
+    }
+    for (; i < n; i += 16) {
+        __mmask16 mask = n - i >= 16 ? 0xFFFF : static_cast<__mmask16>((1u << (n - i)) - 1);
+        acc0 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, a + i), _mm512_maskz_loadu_ps(mask, b + i), acc0);
+    }
+    return _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+}
+
+__attribute__((target("avx512f")))
+float l2_distance_squared_avx512(const float* a, const float* b, size_t n) {
+    __m512 acc0 = _mm512_setzero_ps();
+    __m512 acc1 = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m512 d0 = _mm512_sub_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i));
+        __m512 d1 = _mm512_sub_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16));
+        acc0 = _mm512_fmadd_ps(d0, d0, acc0);
+        acc1 = _mm512_fmadd_ps(d1, d1, acc1);
+    }
+    for (; i < n; i += 16) {
+        __mmask16 mask = n - i >= 16 ? 0xFFFF : static_cast<__mmask16>((1u << (n - i)) - 1);
+        __m512 d0 = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, a + i), _mm512_maskz_loadu_ps(mask, b + i));
+        acc0 = _mm512_fmadd_ps(d0, d0, acc0);
+    }
+    return _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+}
+
+__attribute__((target("avx512f")))
+float cosine_similarity_avx512(const float* a, const float* b, size_t n) {
+    __m512 dot = _mm512_setzero_ps();
+    __m512 norm_a = _mm512_setzero_ps();
+    __m512 norm_b = _mm512_setzero_ps();
+    for (size_t i = 0; i < n; i += 16) {
+        __mmask16 mask = n - i >= 16 ? 0xFFFF : static_cast<__mmask16>((1u << (n - i)) - 1);
+        __m512 va = _mm512_maskz_loadu_ps(mask, a + i);
+        __m512 vb = _mm512_maskz_loadu_ps(mask, b + i);
+        dot = _mm512_fmadd_ps(va, vb, dot);
+        norm_a = _mm512_fmadd_ps(va, va, norm_a);
+        norm_b = _mm512_fmadd_ps(vb, vb, norm_b);
+    }
+    return finish_cosine(_mm512_reduce_add_ps(dot), _mm512_reduce_add_ps(norm_a),
+                         _mm512_reduce_add_ps(norm_b));
+}
+
+__attribute__((target("avx512f")))
+float dot_product_u8_avx512(const float* weights, const uint8_t* codes, size_t n) {
+    __m512 acc = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(codes + i));
+        __m512 values = _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(bytes));
+        acc = _mm512_fmadd_ps(_mm512_loadu_ps(weights + i), values, acc);
+    }
+    if (i < n) {
+        // Byte masking needs AVX512BW, so stage the tail codes in a zeroed buffer
+        alignas(16) uint8_t tail[16] = {};
+        std::memcpy(tail, codes + i, n - i);
+        __mmask16 mask = static_cast<__mmask16>((1u << (n - i)) - 1);
+        __m512 values = _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(_mm_load_si128(reinterpret_cast<const __m128i*>(tail))));
+        acc = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, weights + i), values, acc);
+    }
+    return _mm512_reduce_add_ps(acc);
+}
+
+// 16 half or bfloat16 values widened to floats; n < 16 stages the tail in a
+// zeroed buffer because 16-bit masked loads need AVX512BW
+__attribute__((target("avx512f")))
+inline __m256i load_u16_avx512(const uint16_t* values, size_t n) {
+    if (n >= 16) {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values));
+    }
+    alignas(32) uint16_t tail[16] = {};
+    std::memcpy(tail, values, n * sizeof(uint16_t));
+    return _mm256_load_si256(reinterpret_cast<const __m256i*>(tail));
+}
+
+__attribute__((target("avx512f")))
+inline __m512 load_f16_avx512(const uint16_t* values, size_t n) {
+    return _mm512_cvtph_ps(load_u16_avx512(values, n));
+}
+
+__attribute__((target("avx512f")))
+inline __m512 load_bf16_avx512(const uint16_t* values, size_t n) {
+    return _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_cvtepu16_epi32(load_u16_avx512(values, n)), 16));
+}
+
+__attribute__((target("avx512f")))
+float dot_product_f16_avx512(const float* a, const uint16_t* b, size_t n) {
+    __m512 acc = _mm512_setzero_ps();
+    for (size_t i = 0; i < n; i += 16) {
+        __mmask16 mask = n - i >= 16 ? 0xFFFF : static_cast<__mmask16>((1u << (n - i)) - 1);
+        acc = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, a + i), load_f16_avx512(b + i, n - i), acc);
+    }
+    return _mm512_reduce_add_ps(acc);
+}
+
+__attribute__((target("avx512f")))
+float l2_distance_squared_f16_avx512(const float* a, const uint16_t* b, size_t n) {
+    __m512 acc = _mm512_setzero_ps();
+    for (size_t i = 0; i < n; i += 16) {
+        __mmask16 mask = n - i >= 16 ? 0xFFFF : static_cast<__mmask16>((1u << (n - i)) - 1);
+        __m512 diff = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, a + i), load_f16_avx512(b + i, n - i));
+        acc = _mm512_fmadd_ps(diff, diff, acc);
+    }
+    return _mm512_reduce_add_ps(acc);
+}
+
+__attribute__((target("avx512f")))
+float dot_product_bf16_avx512(const float* a, const uint16_t* b, size_t n) {
+    __m512 acc = _mm512_setzero_ps();
+    for (size_t i = 0; i < n; i += 16) {
+        __mmask16 mask = n - i >= 16 ? 0xFFFF : static_cast<__mmask16>((1u << (n - i)) - 1);
+        acc = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, a + i), load_bf16_avx512(b + i, n - i), acc);
+    }
+    return _mm512_reduce_add_ps(acc);
+}
+
+__attribute__((target("avx512f")))
+float l2_distance_squared_bf16_avx512(const float* a, const uint16_t* b, size_t n) {
+    __m512 acc = _mm512_setzero_ps();
+    for (size_t i = 0; i < n; i += 16) {
+        __mmask16 mask = n - i >= 16 ? 0xFFFF : static_cast<__mmask16>((1u << (n - i)) - 1);
+        __m512 diff = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, a + i), load_bf16_avx512(b + i, n - i));
+        acc = _mm512_fmadd_ps(diff, diff, acc);
+    }
+    return _mm512_reduce_add_ps(acc);
+}
+
+// AVX-512 VPOPCNTDQ kernel (8 words per step, masked tail)
+__attribute__((target("avx512f,avx512vpopcntdq")))
+uint32_t hamming_distance_avx512(const uint64_t* a, const uint64_t* b, size_t words) {
+    __m512i acc = _mm512_setzero_si512();
+    for (size_t i = 0; i < words; i += 8) {
+        __mmask8 mask = words - i >= 8 ? 0xFF : static_cast<__mmask8>((1u << (words - i)) - 1);
+        __m512i va = _mm512_maskz_loadu_epi64(mask, a + i);
+        __m512i vb = _mm512_maskz_loadu_epi64(mask, b + i);
+        acc = _mm512_add_epi64(acc, _mm512_popcnt_epi64(_mm512_xor_si512(va, vb)));
+    }
+    return static_cast<uint32_t>(_mm512_reduce_add_epi64(acc));
+}
+
+#endif // LANGCHAIN_X86_KERNELS
+
+// Function table for one instruction set
+struct KernelTable {
+    SimdLevel level;
+    float (*dot_product)(const float*, const float*, size_t);
+    float (*l2_distance_squared)(const float*, const float*, size_t);
+    float (*cosine_similarity)(const float*, const float*, size_t);
+    float (*dot_product_u8)(const float*, const uint8_t*, size_t);
+    uint32_t (*hamming_distance)(const uint64_t*, const uint64_t*, size_t);
+    float (*dot_product_f16)(const float*, const uint16_t*, size_t);
+    float (*l2_distance_squared_f16)(const float*, const uint16_t*, size_t);
+    float (*dot_product_bf16)(const float*, const uint16_t*, size_t);
+    float (*l2_distance_squared_bf16)(const float*, const uint16_t*, size_t);
+};
+
+const KernelTable SCALAR_KERNELS = {
+    SimdLevel::SCALAR, dot_product_scalar, l2_distance_squared_scalar, cosine_similarity_scalar,
+    dot_product_u8_scalar, hamming_distance_scalar,
+    dot_product_f16_scalar, l2_distance_squared_f16_scalar, dot_product_bf16_scalar, l2_distance_squared_bf16_scalar
+};
+
+#if LANGCHAIN_X86_KERNELS
+const KernelTable SSE_KERNELS = {
+    SimdLevel::SSE4_2, dot_product_sse, l2_distance_squared_sse, cosine_similarity_sse,
+    dot_product_u8_sse, hamming_distance_popcnt,
+    dot_product_f16_scalar, l2_distance_squared_f16_scalar, dot_product_bf16_scalar, l2_distance_squared_bf16_scalar
+};
+
+const KernelTable AVX2_KERNELS = {
+    SimdLevel::AVX2, dot_product_avx2, l2_distance_squared_avx2, cosine_similarity_avx2,
+    dot_product_u8_avx2, hamming_distance_popcnt,
+    dot_product_f16_avx2, l2_distance_squared_f16_avx2, dot_product_bf16_avx2, l2_distance_squared_bf16_avx2
+};
+
+const KernelTable AVX512_KERNELS = {
+    SimdLevel::AVX512, dot_product_avx512, l2_distance_squared_avx512, cosine_similarity_avx512,
+    dot_product_u8_avx512, hamming_distance_popcnt,
+    dot_product_f16_avx512, l2_distance_squared_f16_avx512, dot_product_bf16_avx512, l2_distance_squared_bf16_avx512
+};
+
+// VPOPCNTDQ is a separate AVX-512 extension, so its kernel gets its own table
+const KernelTable AVX512_VPOPCNT_KERNELS = {
+    SimdLevel::AVX512, dot_product_avx512, l2_distance_squared_avx512, cosine_similarity_avx512,
+    dot_product_u8_avx512, hamming_distance_avx512,
+    dot_product_f16_avx512, l2_distance_squared_f16_avx512, dot_product_bf16_avx512, l2_distance_squared_bf16_avx512
+};
+#endif
+
+const KernelTable* kernels_for(SimdLevel level) {
+#if LANGCHAIN_X86_KERNELS
+    switch (level) {
+        case SimdLevel::AVX512:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx512vpopcntdq") ? &AVX512_VPOPCNT_KERNELS : &AVX512_KERNELS;
+        case SimdLevel::AVX2:
+            return &AVX2_KERNELS;
+        case SimdLevel::SSE4_2:
+            return &SSE_KERNELS;
+        default:
+            break;
+    }
+#else
+    (void)level;
+#endif
+    return &SCALAR_KERNELS;
+}
+
+// Kernels currently in use, initialized from the CPU on first use
+std::atomic<const KernelTable*>& active_kernels() {
+    static std::atomic<const KernelTable*> kernels(kernels_for(detect_simd_level()));
+    return kernels;
+}
+
+} // namespace
+
+SimdLevel detect_simd_level() {
+#if LANGCHAIN_X86_KERNELS
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return SimdLevel::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("f16c")) {
+        return SimdLevel::AVX2;
+    }
+    if (__builtin_cpu_supports("sse4.2")) {
+        return SimdLevel::SSE4_2;
+    }
+#endif
+    return SimdLevel::SCALAR;
+}
+
+SimdLevel get_simd_level() {
+    return active_kernels().load(std::memory_order_relaxed)->level;
+}
+
+SimdLevel set_simd_level(SimdLevel level) {
+    SimdLevel supported = detect_simd_level();
+    if (static_cast<int>(level) > static_cast<int>(supported)) {
+        level = supported;
+    }
+    active_kernels().store(kernels_for(level), std::memory_order_relaxed);
+    return level;
+}
+
+const char* simd_level_name(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::AVX512:
+            return "AVX-512";
+        case SimdLevel::AVX2:
+            return "AVX2";
+        case SimdLevel::SSE4_2:
+            return "SSE4.2";
+        case SimdLevel::SCALAR:
+        default:
+            return "scalar";
+    }
+}
+
+// Dispatched kernels
+float dot_product(const float* a, const float* b, size_t n) {
+    return active_kernels().load(std::memory_order_relaxed)->dot_product(a, b, n);
+}
+
+float l2_distance_squared(const float* a, const float* b, size_t n) {
+    return active_kernels().load(std::memory_order_relaxed)->l2_distance_squared(a, b, n);
+}
+
+float cosine_similarity(const float* a, const float* b, size_t n) {
+    return active_kernels().load(std::memory_order_relaxed)->cosine_similarity(a, b, n);
+}
+
+float dot_product_u8(const float* weights, const uint8_t* codes, size_t n) {
+    return active_kernels().load(std::memory_order_relaxed)->dot_product_u8(weights, codes, n);
+}
+
+float dot_product_f16(const float* a, const uint16_t* b, size_t n) {
+    return active_kernels().load(std::memory_order_relaxed)->dot_product_f16(a, b, n);
+}
+
+float l2_distance_squared_f16(const float* a, const uint16_t* b, size_t n) {
+    return active_kernels().load(std::memory_order_relaxed)->l2_distance_squared_f16(a, b, n);
+}
+
+float dot_product_bf16(const float* a, const uint16_t* b, size_t n) {
+    return active_kernels().load(std::memory_order_relaxed)->dot_product_bf16(a, b, n);
+}
+
+float l2_distance_squared_bf16(const float* a, const uint16_t* b, size_t n) {
+    return active_kernels().load(std::memory_order_relaxed)->l2_distance_squared_bf16(a, b, n);
+}
+
+uint32_t hamming_distance(const uint64_t* a, const uint64_t* b, size_t words) {
+    return active_kernels().load(std::memory_order_relaxed)->hamming_distance(a, b, words);
+}
+
+void normalize(float* vector, size_t n) {
+    float norm = std::sqrt(dot_product(vector, vector, n));
+    if (norm == 0.0f) {
+        return;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        vector[i] /= norm;
+    }
+}
+
+double similarity_score(DistanceMetric metric, const float* a, const float* b, size_t n) {
+    switch (metric) {
+        case DistanceMetric::EUCLIDEAN:
+            // Convert distance to similarity (higher distance = lower similarity)
+            return 1.0 / (1.0 + std::sqrt(l2_distance_squared(a, b, n)));
+        case DistanceMetric::COSINE:
+        case DistanceMetric::DOT_PRODUCT:
+        default:
+            return dot_product(a, b, n);
+    }
+}
+
+std::vector<size_t> select_mmr(DistanceMetric metric, const std::vector<const float*>& vectors,
+                               const std::vector<double>& relevance, size_t dimension,
+                               size_t k, double lambda) {
+    size_t count = std::min(vectors.size(), relevance.size());
+    k = std::min(k, count);
+    std::vector<size_t> selected;
+    selected.reserve(k);
+    std::vector<double> redundancy(count, -std::numeric_limits<double>::infinity());
+    std::vector<uint8_t> picked(count, 0);
+
+    for (size_t step = 0; step < k; ++step) {
+        size_t best = count;
+        double best_score = 0.0;
+        for (size_t i = 0; i < count; ++i) {
+            if (picked[i]) {
+                continue;
+            }
+            double score = step == 0 ? relevance[i] : lambda * relevance[i] - (1.0 - lambda) * redundancy[i];
+            if (best == count || score > best_score) {
+                best = i;
+                best_score = score;
+            }
+        }
+        picked[best] = 1;
+        selected.push_back(best);
+
+        // Only the newest pick can raise a remaining candidate's redundancy
+        if (step + 1 < k) {
+            for (size_t i = 0; i < count; ++i) {
+                if (!picked[i]) {
+                    redundancy[i] = std::max(redundancy[i], similarity_score(metric, vectors[i], vectors[best], dimension));
+                }
+            }
+        }
+    }
+    return selected;
+}
+
+VectorMatrix train_kmeans(const VectorMatrix& data, size_t k, size_t iterations,
+                          size_t batch_size, bool spherical, unsigned int seed) {
+    size_t dimension = data.dimension();
+    VectorMatrix centroids(dimension);
+    k = std::min(k, data.rows());
+    if (k == 0) {
+        return centroids;
+    }
+
+    std::mt19937 rng(seed);
+
+    // Initialize centroids from distinct random rows
+    std::vector<size_t> order(data.rows());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::shuffle(order.begin(), order.end(), rng);
+    centroids.reserve(k);
+    for (size_t i = 0; i < k; ++i) {
+        centroids.append(data.row(order[i]));
+    }
+
+    std::vector<size_t> counts(k, 0);
+    std::vector<size_t> batch;
+    std::vector<size_t> assignments;
+    std::uniform_int_distribution<size_t> pick(0, data.rows() - 1);
+    batch_size = std::max<size_t>(1, std::min(batch_size, data.rows()));
+
+    for (size_t iteration = 0; iteration < iterations; ++iteration) {
+        // Assign a random batch against the current centroids
+        batch.clear();
+        assignments.clear();
+        for (size_t i = 0; i < batch_size; ++i) {
+            size_t row = pick(rng);
+            batch.push_back(row);
+            assignments.push_back(nearest_centroid(centroids, data.row(row), spherical));
+        }
+
+        // Move each centroid towards its batch members with a decaying step
+        for (size_t i = 0; i < batch.size(); ++i) {
+            size_t c = assignments[i];
+            counts[c]++;
+            float eta = 1.0f / static_cast<float>(counts[c]);
+            float* centroid = centroids.mutable_row(c);
+            const float* point = data.row(batch[i]);
+            for (size_t d = 0; d < dimension; ++d) {
+                centroid[d] += eta * (point[d] - centroid[d]);
+            }
+        }
+
+        if (spherical) {
+            for (size_t c = 0; c < k; ++c) {
+                normalize(centroids.mutable_row(c), dimension);
+            }
+        }
+    }
+
+    return centroids;
+}
+
+size_t nearest_centroid(const VectorMatrix& centroids, const float* vector, bool spherical) {
+    size_t best = 0;
+    float best_value = 0.0f;
+    for (size_t c = 0; c < centroids.rows(); ++c) {
+        // Larger inner product or smaller distance is better; negate distances to compare alike
+        float value = spherical ? dot_product(vector, centroids.row(c), centroids.dimension())
+                                : -l2_distance_squared(vector, centroids.row(c), centroids.dimension());
+        if (c == 0 || value > best_value) {
+            best = c;
+            best_value = value;
+        }
+    }
+    return best;
+}
+
+} // namespace langchain
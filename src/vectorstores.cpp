@@ -1,4 +1,6 @@
 #include "../include/langchain/vectorstores.h"
+#include "../include/langchain/ingestion.h"
+#include "../include/langchain/tokenizer.h"
 #include <cmath>
 #include <algorithm>
 #include <random>
@@ -7,9 +9,99 @@
 #include <sstream>
 #include <filesystem>
 #include <iostream>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace langchain {
 
+namespace {
+
+// On-disk layout of a saved InMemoryVectorStore (native little-endian integers):
+//   header | document offset table + records | zero padding to 64 bytes | vector block
+// Each document record is its ID, content and metadata as length-prefixed strings.
+// The vector block holds count rows of stride floats, ready to be mapped as a VectorMatrix.
+const char STORE_FILE_MAGIC[8] = {'L', 'C', 'V', 'S', 'T', 'O', 'R', 'E'};
+const uint32_t STORE_FILE_VERSION = 1;
+
+enum StoreIndexType : uint32_t {
+    INDEX_WORD_OVERLAP = 0,
+    INDEX_FLAT_VECTORS = 1
+};
+
+struct StoreFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t index_type;
+    uint32_t metric;
+    uint32_t dimension;
+    uint32_t stride;
+    uint32_t reserved;
+    uint64_t count;
+    uint64_t documents_offset;
+    uint64_t documents_size;
+    uint64_t vectors_offset;
+    uint64_t vectors_size;
+    uint64_t documents_checksum;
+    uint64_t vectors_checksum;
+    uint64_t header_checksum;  // Covers every field above
+};
+
+// FNV-1a over a byte range, continuing from a previous hash
+uint64_t fnv1a(const void* data, size_t size, uint64_t hash = 14695981039346656037ULL) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+void append_u32(std::string& buffer, uint32_t value) {
+    buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void append_string(std::string& buffer, const String& value) {
+    append_u32(buffer, static_cast<uint32_t>(value.size()));
+    buffer.append(value);
+}
+
+// Bounds-checked reader over a mapped byte range
+struct ByteReader {
+    const char* position;
+    const char* end;
+    bool ok;
+
+    bool read_u32(uint32_t& value) {
+        if (!ok || end - position < static_cast<std::ptrdiff_t>(sizeof(value))) {
+            ok = false;
+            return false;
+        }
+        std::memcpy(&value, position, sizeof(value));
+        position += sizeof(value);
+        return true;
+    }
+
+    bool read_string(String& value) {
+        uint32_t length = 0;
+        if (!read_u32(length) || end - position < static_cast<std::ptrdiff_t>(length)) {
+            ok = false;
+            return false;
+        }
+        value.assign(position, length);
+        position += length;
+        return true;
+    }
+};
+
+} // namespace
+
 // DocumentLoader implementation
 String DocumentLoader::get_file_extension(const String& file_path) {
     size_t pos = file_path.find_last_of(".");
@@ -252,19 +344,105 @@ std::vector<Document> TextSplitter::split_documents(const std::vector<Document>&
 
 // InMemoryVectorStore implementation
 InMemoryVectorStore::InMemoryVectorStore()
-    : rng_(std::chrono::steady_clock::now().time_since_epoch().count()) {}
+    : deleted_count_(0),
+      metric_(DistanceMetric::COSINE),
+      rng_(std::chrono::steady_clock::now().time_since_epoch().count()),
+      compaction_threshold_(0.25),
+      compaction_running_(false),
+      parallel_threshold_(50000) {}
+
+InMemoryVectorStore::InMemoryVectorStore(std::shared_ptr<Embeddings> embeddings, DistanceMetric metric)
+    : deleted_count_(0),
+      embeddings_(embeddings), metric_(metric),
+      vectors_(embeddings ? embeddings->dimension() : 0),
+      rng_(std::chrono::steady_clock::now().time_since_epoch().count()),
+      compaction_threshold_(0.25),
+      compaction_running_(false),
+      parallel_threshold_(50000) {}
+
+InMemoryVectorStore::~InMemoryVectorStore() {
+    if (compaction_thread_.joinable()) {
+        compaction_thread_.join();
+    }
+}
 
 StringList InMemoryVectorStore::add_documents(const std::vector<Document>& documents) {
+    // Embed the whole batch before taking the lock
+    std::vector<Embedding> embeddings;
+    if (embeddings_) {
+        StringList texts;
+        texts.reserve(documents.size());
+        for (const auto& doc : documents) {
+            texts.push_back(doc.content);
+        }
+        embeddings = embeddings_->embed_documents(texts);
+        if (embeddings.size() != documents.size()) {
+            throw std::runtime_error("InMemoryVectorStore: embedding model returned " +
+                                     std::to_string(embeddings.size()) + " vectors for " +
+                                     std::to_string(documents.size()) + " documents");
+        }
+    }
+    return insert_documents(documents, std::move(embeddings));
+}
+
+StringList InMemoryVectorStore::add_embedded_documents(const std::vector<Document>& documents,
+                                                       const std::vector<Embedding>& embeddings) {
+    if (!embeddings_ || embeddings.size() != documents.size()) {
+        return add_documents(documents);
+    }
+    return insert_documents(documents, embeddings);
+}
+
+StringList InMemoryVectorStore::insert_documents(const std::vector<Document>& documents,
+                                                 std::vector<Embedding> embeddings) {
+    // Prepare vectors (or tokenize) before taking the lock
+    std::vector<Tokenizer> tokenizers;
+    if (embeddings_) {
+        for (auto& embedding : embeddings) {
+            embedding.resize(embeddings_->dimension(), 0.0f);
+            if (metric_ == DistanceMetric::COSINE) {
+                normalize(embedding.data(), embedding.size());
+            }
+        }
+    } else {
+        // Word overlap stores tokenize content once, at insert time
+        tokenizers.resize(documents.size());
+        for (size_t i = 0; i < documents.size(); ++i) {
+            tokenizers[i].tokenize(documents[i].content);
+        }
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    if (embeddings_) {
+        vectors_.reserve(vectors_.rows() + embeddings.size());
+    }
+
     StringList new_ids;
-    for (const auto& doc : documents) {
-        String id = doc.id.empty() ? generate_id() : doc.id;
-        Document doc_with_id = doc;
-        doc_with_id.id = id;
+    for (size_t i = 0; i < documents.size(); ++i) {
+        String id = documents[i].id.empty() ? generate_id() : documents[i].id;
+
+        // Adding an existing ID replaces the previous document
+        auto it = id_to_slot_.find(id);
+        if (it != id_to_slot_.end()) {
+            remove_slot(it->second);
+        }
 
-        documents_.push_back(doc_with_id);
-        ids_.push_back(id);
+        uint32_t slot = static_cast<uint32_t>(documents_.size());
+        Document doc_with_id = documents[i];
+        doc_with_id.id = id;
+        documents_.push_back(std::move(doc_with_id));
+        deleted_.push_back(0);
+        id_to_slot_[id] = slot;
+        metadata_index_.add_document(slot, documents_[slot].metadata);
+        if (embeddings_) {
+            vectors_.append(embeddings[i].data());
+        } else {
+            text_index_.add_document(tokenizers[i].tokens());
+        }
         new_ids.push_back(id);
     }
+
+    maybe_schedule_compaction();
     return new_ids;
 }
 
@@ -279,54 +457,479 @@ std::vector<Document> InMemoryVectorStore::similarity_search(const String& query
 
 std::vector<std::pair<Document, double>> InMemoryVectorStore::similarity_search_with_score(
     const String& query, int k) {
+    return search(query, k, nullptr);
+}
+
+std::vector<std::pair<Document, double>> InMemoryVectorStore::similarity_search_with_filter(
+    const String& query, int k, const MetadataFilter& filter) {
+    return search(query, k, filter.empty() ? nullptr : &filter);
+}
+
+std::vector<std::pair<Document, double>> InMemoryVectorStore::search(const String& query, int k,
+                                                                     const MetadataFilter* filter) {
+    std::vector<std::pair<Document, double>> results;
+    if (k <= 0) {
+        return results;
+    }
+
+    Embedding query_vector;
+    if (embeddings_) {
+        query_vector = embed_query(query);
+    }
+
+    std::shared_lock<std::shared_mutex> lock(mutex_);
 
-    std::vector<std::pair<Document, double>> similarities;
+    // A filter is compiled into the sorted slots that match it; only those are scored
+    std::vector<uint32_t> candidates;
+    if (filter) {
+        candidates = metadata_index_.match(*filter);
+    }
 
-    // Calculate similarity scores for all documents
-    for (const auto& doc : documents_) {
-        double score = calculate_similarity(query, doc.content);
-        similarities.push_back({doc, score});
+    // Keep only scores and slot indices; documents are copied for the k winners
+    TopKCollector top_k(static_cast<size_t>(k));
+    if (embeddings_) {
+        scan_vectors(query_vector.data(), top_k, filter ? &candidates : nullptr);
+    } else {
+        lexical_search(query, top_k, filter ? &candidates : nullptr);
     }
 
-    // Sort by similarity score (descending)
-    std::sort(similarities.begin(), similarities.end(),
-              [](const auto& a, const auto& b) {
-                  return a.second > b.second;
-              });
+    // Return top k results, best first
+    for (const auto& candidate : top_k.take_sorted()) {
+        results.push_back({documents_[candidate.second], candidate.first});
+    }
+    return results;
+}
 
-    // Return top k results
-    if (static_cast<size_t>(k) < similarities.size()) {
-        similarities.resize(k);
+std::vector<Document> InMemoryVectorStore::max_marginal_relevance_search(const String& query, int k,
+                                                                        int fetch_k, double lambda_mult) {
+    std::vector<Document> results;
+    if (k <= 0) {
+        return results;
+    }
+    if (!embeddings_) {
+        // Word overlap stores keep no vectors to measure redundancy with
+        return similarity_search(query, k);
     }
 
-    return similarities;
+    Embedding query_vector = embed_query(query);
+
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    TopKCollector top_k(static_cast<size_t>(std::max(k, fetch_k)));
+    scan_vectors(query_vector.data(), top_k);
+    auto candidates = top_k.take_sorted();
+
+    // The diversity term compares stored rows directly; nothing is embedded again
+    std::vector<const float*> vectors;
+    std::vector<double> relevance;
+    vectors.reserve(candidates.size());
+    relevance.reserve(candidates.size());
+    for (const auto& candidate : candidates) {
+        vectors.push_back(vectors_.row(candidate.second));
+        relevance.push_back(candidate.first);
+    }
+    for (size_t index : select_mmr(metric_, vectors, relevance, vectors_.dimension(),
+                                   static_cast<size_t>(k), lambda_mult)) {
+        results.push_back(documents_[candidates[index].second]);
+    }
+    return results;
+}
+
+std::vector<std::vector<std::pair<Document, double>>> InMemoryVectorStore::similarity_search_batch_with_score(
+    const StringList& queries, int k) {
+
+    std::vector<std::vector<std::pair<Document, double>>> results(queries.size());
+    if (k <= 0 || queries.empty()) {
+        return results;
+    }
+
+    VectorMatrix query_vectors(embeddings_ ? embeddings_->dimension() : 0);
+    if (embeddings_) {
+        query_vectors.reserve(queries.size());
+        for (const auto& query : queries) {
+            query_vectors.append(embed_query(query).data());
+        }
+    }
+
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    std::vector<TopKCollector> top_k(queries.size(), TopKCollector(static_cast<size_t>(k)));
+    if (embeddings_) {
+        // Score every query against one block of rows while it is still in cache,
+        // so the stored vectors are streamed from memory once per batch
+        size_t dimension = vectors_.dimension();
+        size_t block_rows = std::max<size_t>(1, BATCH_BLOCK_BYTES / (vectors_.stride() * sizeof(float)));
+        for (size_t block_start = 0; block_start < documents_.size(); block_start += block_rows) {
+            size_t block_end = std::min(block_start + block_rows, documents_.size());
+            for (size_t q = 0; q < queries.size(); ++q) {
+                const float* query_vector = query_vectors.row(q);
+                for (size_t i = block_start; i < block_end; ++i) {
+                    if (!deleted_[i]) {
+                        top_k[q].push(similarity_score(metric_, query_vector, vectors_.row(i), dimension),
+                                      static_cast<uint32_t>(i));
+                    }
+                }
+            }
+        }
+    } else {
+        for (size_t q = 0; q < queries.size(); ++q) {
+            lexical_search(queries[q], top_k[q]);
+        }
+    }
+
+    for (size_t q = 0; q < queries.size(); ++q) {
+        for (const auto& candidate : top_k[q].take_sorted()) {
+            results[q].push_back({documents_[candidate.second], candidate.first});
+        }
+    }
+    return results;
 }
 
 void InMemoryVectorStore::delete_documents(const StringList& ids) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
     for (const auto& id : ids) {
-        auto it = std::find(ids_.begin(), ids_.end(), id);
-        if (it != ids_.end()) {
-            size_t index = std::distance(ids_.begin(), it);
-            ids_.erase(it);
-            documents_.erase(documents_.begin() + index);
+        auto it = id_to_slot_.find(id);
+        if (it != id_to_slot_.end()) {
+            remove_slot(it->second);
         }
     }
+    maybe_schedule_compaction();
 }
 
 std::vector<Document> InMemoryVectorStore::get_by_ids(const StringList& ids) {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
     std::vector<Document> result;
     for (const auto& id : ids) {
-        auto it = std::find(ids_.begin(), ids_.end(), id);
-        if (it != ids_.end()) {
-            size_t index = std::distance(ids_.begin(), it);
-            result.push_back(documents_[index]);
+        auto it = id_to_slot_.find(id);
+        if (it != id_to_slot_.end()) {
+            result.push_back(documents_[it->second]);
         }
     }
     return result;
 }
 
 std::vector<Document> InMemoryVectorStore::get_all_documents() const {
-    return documents_;
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    std::vector<Document> result;
+    result.reserve(documents_.size() - deleted_count_);
+    for (size_t i = 0; i < documents_.size(); ++i) {
+        if (!deleted_[i]) {
+            result.push_back(documents_[i]);
+        }
+    }
+    return result;
+}
+
+std::shared_ptr<Embeddings> InMemoryVectorStore::get_embeddings() const {
+    return embeddings_;
+}
+
+DistanceMetric InMemoryVectorStore::get_metric() const {
+    return metric_;
+}
+
+size_t InMemoryVectorStore::size() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return documents_.size() - deleted_count_;
+}
+
+size_t InMemoryVectorStore::tombstone_count() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    return deleted_count_;
+}
+
+void InMemoryVectorStore::set_compaction_threshold(double threshold) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    compaction_threshold_ = threshold;
+}
+
+void InMemoryVectorStore::set_parallel_threshold(size_t documents) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    parallel_threshold_ = documents;
+}
+
+void InMemoryVectorStore::set_thread_pool(std::shared_ptr<ThreadPool> pool) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    thread_pool_ = pool;
+}
+
+void InMemoryVectorStore::compact() {
+    std::lock_guard<std::mutex> compaction_lock(compaction_mutex_);
+
+    // Build the repacked vectors, index and ID map while searches keep running
+    size_t copied = 0;
+    std::vector<uint32_t> remap;
+    VectorMatrix vectors(vectors_.dimension());
+    InvertedIndex text_index;
+    MetadataIndex metadata_index;
+    std::unordered_map<String, uint32_t> id_to_slot;
+    Tokenizer tokenizer;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        if (deleted_count_ == 0) {
+            return;
+        }
+        copied = documents_.size();
+        remap.assign(copied, UINT32_MAX);
+        uint32_t next = 0;
+        if (embeddings_) {
+            vectors.reserve(copied - deleted_count_);
+        }
+        id_to_slot.reserve(copied - deleted_count_);
+        for (uint32_t slot = 0; slot < copied; ++slot) {
+            if (deleted_[slot]) {
+                continue;
+            }
+            remap[slot] = next++;
+            id_to_slot[documents_[slot].id] = remap[slot];
+            metadata_index.add_document(remap[slot], documents_[slot].metadata);
+            if (embeddings_) {
+                vectors.append(vectors_.row(slot));
+            } else {
+                text_index.add_document(tokenizer.tokenize(documents_[slot].content));
+            }
+        }
+    }
+
+    // Swap it in, replaying writes that landed since the copy
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    std::vector<Document> documents;
+    documents.reserve(id_to_slot.size() + documents_.size() - copied);
+    std::vector<uint8_t> deleted(id_to_slot.size(), 0);
+    size_t deleted_count = 0;
+    for (uint32_t slot = 0; slot < copied; ++slot) {
+        if (remap[slot] == UINT32_MAX) {
+            continue;
+        }
+        if (deleted_[slot]) {
+            // Deleted after the copy: keep it tombstoned in the new layout
+            deleted[remap[slot]] = 1;
+            deleted_count++;
+            id_to_slot.erase(documents_[slot].id);
+        }
+        documents.push_back(std::move(documents_[slot]));
+    }
+    for (uint32_t slot = static_cast<uint32_t>(copied); slot < documents_.size(); ++slot) {
+        uint32_t new_slot = static_cast<uint32_t>(documents.size());
+        if (deleted_[slot]) {
+            deleted_count++;
+        } else {
+            id_to_slot[documents_[slot].id] = new_slot;
+            metadata_index.add_document(new_slot, documents_[slot].metadata);
+        }
+        deleted.push_back(deleted_[slot]);
+        if (embeddings_) {
+            vectors.append(vectors_.row(slot));
+        } else {
+            text_index.add_document(tokenizer.tokenize(documents_[slot].content));
+        }
+        documents.push_back(std::move(documents_[slot]));
+    }
+
+    documents_.swap(documents);
+    deleted_.swap(deleted);
+    deleted_count_ = deleted_count;
+    id_to_slot_.swap(id_to_slot);
+    vectors_ = std::move(vectors);
+    text_index_ = std::move(text_index);
+    metadata_index_ = std::move(metadata_index);
+}
+
+bool InMemoryVectorStore::save(const String& path) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+
+    std::vector<uint32_t> live;
+    live.reserve(documents_.size() - deleted_count_);
+    for (uint32_t slot = 0; slot < documents_.size(); ++slot) {
+        if (!deleted_[slot]) {
+            live.push_back(slot);
+        }
+    }
+
+    // Document offset table followed by the records
+    std::string documents(live.size() * sizeof(uint64_t), '\0');
+    for (size_t i = 0; i < live.size(); ++i) {
+        uint64_t offset = documents.size();
+        std::memcpy(&documents[i * sizeof(uint64_t)], &offset, sizeof(offset));
+        const Document& doc = documents_[live[i]];
+        append_string(documents, doc.id);
+        append_string(documents, doc.content);
+        append_u32(documents, static_cast<uint32_t>(doc.metadata.size()));
+        for (const auto& entry : doc.metadata) {
+            append_string(documents, entry.first);
+            append_string(documents, entry.second);
+        }
+    }
+
+    StoreFileHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, STORE_FILE_MAGIC, sizeof(header.magic));
+    header.version = STORE_FILE_VERSION;
+    header.index_type = embeddings_ ? INDEX_FLAT_VECTORS : INDEX_WORD_OVERLAP;
+    header.metric = static_cast<uint32_t>(metric_);
+    header.dimension = static_cast<uint32_t>(vectors_.dimension());
+    header.stride = static_cast<uint32_t>(vectors_.stride());
+    header.count = live.size();
+    header.documents_offset = sizeof(StoreFileHeader);
+    header.documents_size = documents.size();
+    header.documents_checksum = fnv1a(documents.data(), documents.size());
+    // Align the vector block so mapped rows keep their 64-byte alignment
+    header.vectors_offset = (header.documents_offset + header.documents_size + 63) / 64 * 64;
+    size_t row_bytes = vectors_.stride() * sizeof(float);
+    if (embeddings_) {
+        header.vectors_size = live.size() * row_bytes;
+        uint64_t checksum = 14695981039346656037ULL;
+        for (uint32_t slot : live) {
+            checksum = fnv1a(vectors_.row(slot), row_bytes, checksum);
+        }
+        header.vectors_checksum = checksum;
+    }
+    header.header_checksum = fnv1a(&header, offsetof(StoreFileHeader, header_checksum));
+
+    // Write to a temporary file and rename it over the target
+    String temp_path = path + ".tmp";
+    std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Error opening file for writing: " << temp_path << std::endl;
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(documents.data(), documents.size());
+    std::string padding(header.vectors_offset - header.documents_offset - header.documents_size, '\0');
+    file.write(padding.data(), padding.size());
+    if (embeddings_) {
+        for (uint32_t slot : live) {
+            file.write(reinterpret_cast<const char*>(vectors_.row(slot)), row_bytes);
+        }
+    }
+    file.close();
+    if (!file) {
+        std::cerr << "Error writing vector store file: " << temp_path << std::endl;
+        std::remove(temp_path.c_str());
+        return false;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temp_path, path, error);
+    if (error) {
+        std::cerr << "Error renaming " << temp_path << " to " << path << ": " << error.message() << std::endl;
+        std::remove(temp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+std::shared_ptr<InMemoryVectorStore> InMemoryVectorStore::open(const String& path,
+                                                               std::shared_ptr<Embeddings> embeddings,
+                                                               bool verify_vectors) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Error opening vector store file: " << path << std::endl;
+        return nullptr;
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || static_cast<size_t>(file_stat.st_size) < sizeof(StoreFileHeader)) {
+        std::cerr << "Vector store file is truncated: " << path << std::endl;
+        ::close(fd);
+        return nullptr;
+    }
+    size_t file_size = static_cast<size_t>(file_stat.st_size);
+    void* base = mmap(nullptr, file_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (base == MAP_FAILED) {
+        std::cerr << "Error mapping vector store file: " << path << std::endl;
+        return nullptr;
+    }
+    // The mapping lives as long as the store (or any copy of its vectors) uses it
+    std::shared_ptr<const void> mapping(base, [file_size](const void* address) {
+        munmap(const_cast<void*>(address), file_size);
+    });
+    const char* bytes = static_cast<const char*>(base);
+
+    StoreFileHeader header;
+    std::memcpy(&header, bytes, sizeof(header));
+    if (std::memcmp(header.magic, STORE_FILE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != STORE_FILE_VERSION) {
+        std::cerr << "Not a vector store file (or unsupported version): " << path << std::endl;
+        return nullptr;
+    }
+    if (header.header_checksum != fnv1a(&header, offsetof(StoreFileHeader, header_checksum))) {
+        std::cerr << "Vector store header checksum mismatch: " << path << std::endl;
+        return nullptr;
+    }
+    if (header.documents_offset > file_size || header.documents_size > file_size - header.documents_offset ||
+        header.vectors_offset > file_size || header.vectors_size > file_size - header.vectors_offset ||
+        header.count > header.documents_size / sizeof(uint64_t)) {
+        std::cerr << "Vector store file is truncated: " << path << std::endl;
+        return nullptr;
+    }
+    const char* documents = bytes + header.documents_offset;
+    if (header.documents_checksum != fnv1a(documents, header.documents_size)) {
+        std::cerr << "Vector store document checksum mismatch: " << path << std::endl;
+        return nullptr;
+    }
+
+    std::shared_ptr<InMemoryVectorStore> store;
+    if (header.index_type == INDEX_FLAT_VECTORS) {
+        if (!embeddings || embeddings->dimension() != header.dimension) {
+            std::cerr << "Vector store needs an embedding model of dimension " << header.dimension << std::endl;
+            return nullptr;
+        }
+        if (header.metric > static_cast<uint32_t>(DistanceMetric::EUCLIDEAN)) {
+            std::cerr << "Unknown distance metric in vector store file: " << path << std::endl;
+            return nullptr;
+        }
+        store = std::make_shared<InMemoryVectorStore>(embeddings, static_cast<DistanceMetric>(header.metric));
+        size_t row_bytes = store->vectors_.stride() * sizeof(float);
+        if (header.stride != store->vectors_.stride() || header.vectors_size != header.count * row_bytes ||
+            header.vectors_offset % 64 != 0) {
+            std::cerr << "Vector block layout mismatch: " << path << std::endl;
+            return nullptr;
+        }
+        if (verify_vectors &&
+            header.vectors_checksum != fnv1a(bytes + header.vectors_offset, header.vectors_size)) {
+            std::cerr << "Vector store vector checksum mismatch: " << path << std::endl;
+            return nullptr;
+        }
+        store->vectors_ = VectorMatrix::view(header.dimension, header.count,
+                                             reinterpret_cast<const float*>(bytes + header.vectors_offset),
+                                             mapping);
+    } else if (header.index_type == INDEX_WORD_OVERLAP) {
+        store = std::make_shared<InMemoryVectorStore>();
+    } else {
+        std::cerr << "Unknown index type in vector store file: " << path << std::endl;
+        return nullptr;
+    }
+
+    // Decode the document records
+    store->documents_.resize(header.count);
+    store->deleted_.assign(header.count, 0);
+    store->id_to_slot_.reserve(header.count);
+    Tokenizer tokenizer;
+    for (uint32_t slot = 0; slot < header.count; ++slot) {
+        uint64_t offset;
+        std::memcpy(&offset, documents + slot * sizeof(uint64_t), sizeof(offset));
+        ByteReader reader{documents + offset, documents + header.documents_size, offset <= header.documents_size};
+        Document& doc = store->documents_[slot];
+        uint32_t metadata_count = 0;
+        reader.read_string(doc.id);
+        reader.read_string(doc.content);
+        reader.read_u32(metadata_count);
+        for (uint32_t i = 0; i < metadata_count && reader.ok; ++i) {
+            String key, value;
+            reader.read_string(key);
+            reader.read_string(value);
+            doc.metadata[key] = value;
+        }
+        if (!reader.ok) {
+            std::cerr << "Corrupt document record in vector store file: " << path << std::endl;
+            return nullptr;
+        }
+        store->id_to_slot_[doc.id] = slot;
+        store->metadata_index_.add_document(slot, doc.metadata);
+        if (!store->embeddings_) {
+            store->text_index_.add_document(tokenizer.tokenize(doc.content));
+        }
+    }
+    return store;
 }
 
 // Private methods
@@ -346,50 +949,126 @@ String InMemoryVectorStore::generate_id() {
     return result;
 }
 
-double InMemoryVectorStore::calculate_similarity(const String& str1, const String& str2) {
-    // Simple approach: count common words
-    auto words1 = split_to_words(str1);
-    auto words2 = split_to_words(str2);
+Embedding InMemoryVectorStore::embed_query(const String& query) {
+    Embedding query_vector = embeddings_->embed_query(query);
+    query_vector.resize(embeddings_->dimension(), 0.0f);
+    if (metric_ == DistanceMetric::COSINE) {
+        normalize(query_vector.data(), query_vector.size());
+    }
+    return query_vector;
+}
+
+void InMemoryVectorStore::remove_slot(uint32_t slot) {
+    // Keep the ID so compaction can fix up the index; drop the payload
+    Document& doc = documents_[slot];
+    id_to_slot_.erase(doc.id);
+    doc.content.clear();
+    doc.content.shrink_to_fit();
+    doc.metadata.clear();
+    deleted_[slot] = 1;
+    deleted_count_++;
+}
+
+void InMemoryVectorStore::maybe_schedule_compaction() {
+    if (compaction_threshold_ <= 0.0 || deleted_count_ < MIN_COMPACTION_TOMBSTONES ||
+        deleted_count_ < compaction_threshold_ * documents_.size()) {
+        return;
+    }
+    if (compaction_running_.exchange(true)) {
+        return;
+    }
+    // The previous compaction thread has finished its work by now
+    if (compaction_thread_.joinable()) {
+        compaction_thread_.join();
+    }
+    compaction_thread_ = std::thread([this]() {
+        compact();
+        compaction_running_ = false;
+    });
+}
 
-    int common_words = 0;
-    for (const auto& word1 : words1) {
-        for (const auto& word2 : words2) {
-            if (word1 == word2) {
-                common_words++;
-                break;
+void InMemoryVectorStore::scan_vectors(const float* query_vector, TopKCollector& top_k,
+                                       const std::vector<uint32_t>* candidates) const {
+    size_t count = candidates ? candidates->size() : documents_.size();
+    size_t dimension = vectors_.dimension();
+
+    // Score positions [begin, end) of the scan order: every slot, or the filter's candidates
+    auto score_range = [&](size_t begin, size_t end, TopKCollector& heap) {
+        for (size_t i = begin; i < end; ++i) {
+            uint32_t slot = candidates ? (*candidates)[i] : static_cast<uint32_t>(i);
+            if (!deleted_[slot]) {
+                heap.push(similarity_score(metric_, query_vector, vectors_.row(slot), dimension), slot);
             }
         }
-    }
+    };
 
-    // Normalize by the maximum length
-    int max_words = std::max(words1.size(), words2.size());
-    if (max_words == 0) return 0.0;
+    ThreadPool& pool = thread_pool_ ? *thread_pool_ : ThreadPool::shared();
+    if (parallel_threshold_ == 0 || count < parallel_threshold_ || pool.size() == 0) {
+        // Linear sweep over the contiguous vector matrix
+        score_range(0, count, top_k);
+        return;
+    }
 
-    return static_cast<double>(common_words) / max_words;
+    // Each task sweeps a contiguous run of cache-sized partitions into its own heap
+    size_t partition_rows = std::max<size_t>(1, SCAN_PARTITION_BYTES / (vectors_.stride() * sizeof(float)));
+    size_t partitions = (count + partition_rows - 1) / partition_rows;
+    size_t tasks = std::min(partitions, (pool.size() + 1) * SCAN_TASKS_PER_THREAD);
+    std::vector<TopKCollector> partial(tasks, TopKCollector(top_k.capacity()));
+    pool.parallel_for(tasks, [&](size_t task) {
+        size_t begin = partitions * task / tasks * partition_rows;
+        size_t end = std::min(count, partitions * (task + 1) / tasks * partition_rows);
+        score_range(begin, end, partial[task]);
+    });
+
+    // Ties still resolve by slot, so the merged result equals a sequential scan
+    for (auto& heap : partial) {
+        for (const auto& candidate : heap.take_sorted()) {
+            top_k.push(candidate.first, candidate.second);
+        }
+    }
 }
 
-StringList InMemoryVectorStore::split_to_words(const String& str) {
-    StringList words;
-    String word;
+void InMemoryVectorStore::lexical_search(const String& query, TopKCollector& top_k,
+                                         const std::vector<uint32_t>* candidates) const {
+    // Slots a filter allows, for checking postings in constant time
+    std::vector<uint8_t> allowed;
+    if (candidates) {
+        allowed.assign(documents_.size(), 0);
+        for (uint32_t slot : *candidates) {
+            allowed[slot] = 1;
+        }
+    }
 
-    for (char c : str) {
-        if (std::isspace(c)) {
-            if (!word.empty()) {
-                // Convert to lowercase for comparison
-                std::transform(word.begin(), word.end(), word.begin(), ::tolower);
-                words.push_back(word);
-                word.clear();
+    // Count query words (with repeats) that occur in each document, by term id
+    Tokenizer tokenizer;
+    const auto& query_words = tokenizer.tokenize(query);
+    TermVector query_terms;
+    text_index_.dictionary().lookup(query_words, query_terms);
+    std::unordered_map<uint32_t, uint32_t> common_words;
+    for (const auto& query_term : query_terms) {
+        const std::vector<Posting>* postings = text_index_.get_postings(query_term.term);
+        for (size_t p = 0; postings && p < postings->size(); ++p) {
+            const Posting& posting = (*postings)[p];
+            if (!deleted_[posting.slot] && (!candidates || allowed[posting.slot])) {
+                common_words[posting.slot] += query_term.frequency;
             }
-        } else {
-            word += std::tolower(c);
         }
     }
 
-    if (!word.empty()) {
-        words.push_back(word);
+    // Normalize by the maximum length
+    for (const auto& entry : common_words) {
+        size_t max_words = std::max<size_t>(query_words.size(), text_index_.document_length(entry.first));
+        top_k.push(static_cast<double>(entry.second) / max_words, entry.first);
     }
 
-    return words;
+    // Documents without common words score zero; fill the remaining places in slot order
+    size_t count = candidates ? candidates->size() : documents_.size();
+    for (size_t i = 0; i < count && top_k.size() < top_k.capacity(); ++i) {
+        uint32_t slot = candidates ? (*candidates)[i] : static_cast<uint32_t>(i);
+        if (!deleted_[slot] && !common_words.count(slot)) {
+            top_k.push(0.0, slot);
+        }
+    }
 }
 
 // RAGChain implementation
@@ -399,37 +1078,57 @@ RAGChain::RAGChain(std::shared_ptr<VectorStore> vector_store, std::shared_ptr<LL
 }
 
 void RAGChain::add_documents(const std::vector<Document>& documents) {
-    // Split documents if needed
-    std::vector<Document> split_docs = text_splitter_->split_documents(documents);
-
-    // Add documents to vector store
-    vector_store_->add_documents(split_docs);
+    // Split and store documents as a stream instead of materializing every chunk. One
+    // worker per stage keeps chunks in input order, so ties rank the same on every run
+    IngestionConfig config;
+    config.loader_workers = 1;
+    config.splitter_workers = 1;
+    config.embedder_workers = 1;
+    IngestionStats stats = IngestionPipeline(vector_store_, text_splitter_, nullptr, config).ingest_documents(documents);
+    if (stats.errors > 0) {
+        throw std::runtime_error("RAGChain: ingestion dropped " + std::to_string(stats.errors) +
+                                 " documents or chunks");
+    }
 }
 
 String RAGChain::query(const String& question) {
     // Search for relevant documents
     auto relevant_docs = vector_store_->similarity_search(question, 4);
 
-    // Create context from relevant documents
-    String context;
-    for (const auto& doc : relevant_docs) {
-        context += doc.content + "\n\n";
-    }
+    // Generate response using LLM
+    return llm_->generate(build_prompt(question, relevant_docs));
+}
 
-    // Create prompt with context and question
-    String prompt = "Use the following context to answer the question at the end. "
-                    "If you don't know the answer, just say that you don't know, "
-                    "don't try to make up an answer.\n\n"
-                    "Context:\n" + context +
-                    "Question: " + question + "\n"
-                    "Answer:";
+StringList RAGChain::query_batch(const StringList& questions) {
+    // Retrieve context for every question in one pass over the store
+    auto relevant_docs = vector_store_->similarity_search_batch(questions, 4);
 
-    // Generate response using LLM
-    return llm_->generate(prompt);
+    StringList prompts;
+    prompts.reserve(questions.size());
+    for (size_t i = 0; i < questions.size(); ++i) {
+        prompts.push_back(build_prompt(questions[i], relevant_docs[i]));
+    }
+    return llm_->generate_batch(prompts);
 }
 
 void RAGChain::set_text_splitter(std::shared_ptr<TextSplitter> text_splitter) {
     text_splitter_ = text_splitter;
 }
 
+String RAGChain::build_prompt(const String& question, const std::vector<Document>& documents) const {
+    // Create context from relevant documents
+    String context;
+    for (const auto& doc : documents) {
+        context += doc.content + "\n\n";
+    }
+
+    // Create prompt with context and question
+    return "Use the following context to answer the question at the end. "
+           "If you don't know the answer, just say that you don't know, "
+           "don't try to make up an answer.\n\n"
+           "Context:\n" + context +
+           "Question: " + question + "\n"
+           "Answer:";
+}
+
 } // namespace langchain
\ No newline at end of file
@@ -1,6 +1,15 @@
 #include <iostream>
 #include <cassert>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
 #include <memory>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <thread>
 #include "../include/langchain/langchain.h"
 
 using namespace langchain;
@@ -120,6 +129,1432 @@ void test_vector_store() {
     std::cout << "InMemoryVectorStore tests passed!\n\n";
 }
 
+void test_lexical_index() {
+    std::cout << "Testing lexical inverted index...\n";
+
+    InvertedIndex index;
+    assert(index.add_document({"the", "quick", "fox", "the"}) == 0);
+    assert(index.add_document({"lazy", "dog"}) == 1);
+    assert(index.document_count() == 2);
+    assert(index.term_count() == 5);
+    assert(index.document_length(0) == 4);
+    const std::vector<Posting>* postings = index.get_postings("the");
+    assert(postings && postings->size() == 1);
+    assert((*postings)[0].slot == 0 && (*postings)[0].term_frequency == 2);
+    assert(index.get_postings("cat") == nullptr);
+
+    // Term ids are dense and texts compare as sorted (term id, frequency) arrays
+    TermDictionary dictionary;
+    TermVector first, second;
+    dictionary.encode({"green", "tea", "green"}, first);
+    dictionary.encode({"tea", "green", "apples", "pears"}, second);
+    assert(dictionary.size() == 4);
+    assert(dictionary.find("apples") == 2 && dictionary.term(2) == "apples");
+    assert(dictionary.find("cat") == TermDictionary::UNKNOWN_TERM);
+    assert(first.size() == 2 && first[0].term == 0 && first[0].frequency == 2);
+    assert(shared_term_count(first, second) == 2);
+    assert(std::abs(term_jaccard_similarity(first, second) - 0.5) < 1e-9);
+    assert(std::abs(term_cosine_similarity(first, second) - 3.0 / (std::sqrt(5.0) * 2.0)) < 1e-9);
+    assert(std::abs(term_euclidean_distance(first, second) - std::sqrt(3.0)) < 1e-9);
+    assert(std::abs(term_overlap_similarity(first, second) - 0.75) < 1e-9);
+    TermVector query;
+    assert(dictionary.lookup({"pears", "cat"}, query) == 1);
+    assert(query.size() == 1 && query[0].term == 3 && dictionary.size() == 4);
+    TermOverlay overlay(dictionary);
+    overlay.encode({"kiwi", "pears", "kiwi"}, query);
+    assert(query.size() == 2 && query[0].term == 3 && query[1].term == 4 && query[1].frequency == 2);
+    assert(overlay.term(4) == "kiwi" && overlay.overflow_size() == 1 && dictionary.size() == 4);
+
+    // Scores come from the postings and match the word overlap formula
+    auto vectorstore = std::make_shared<InMemoryVectorStore>();
+    StringList ids = vectorstore->add_documents({
+        Document("red apples and green pears"),
+        Document("green tea"),
+        Document("the stock market fell"),
+        Document("apples apples everywhere")
+    });
+    auto results = vectorstore->similarity_search_with_score("green apples", 4);
+    assert(results.size() == 4);
+    assert(results[0].first.content == "green tea");
+    assert(std::abs(results[0].second - 0.5) < 1e-9);
+    assert(std::abs(results[1].second - 0.4) < 1e-9);
+    assert(results[3].second == 0.0);
+
+    // AdvancedRetriever's OVERLAP algorithm computes the same score from term ids
+    AdvancedRetriever retriever(vectorstore, SimilarityAlgorithm::OVERLAP);
+    auto reranked = retriever.search_with_scores("green apples", 3);
+    assert(reranked.size() == 3 && reranked[0].first.content == "green tea");
+    assert(std::abs(reranked[0].second - 0.5) < 1e-9 && std::abs(reranked[1].second - 0.4) < 1e-9);
+
+    // Precomputed term vectors and norms give the same cosine and Euclidean scores
+    SparseTermVector sparse_first{first, term_norm(first)};
+    SparseTermVector sparse_second{second, term_norm(second)};
+    assert(std::abs(sparse_cosine_similarity(sparse_first, sparse_second) -
+                    term_cosine_similarity(first, second)) < 1e-12);
+    assert(std::abs(sparse_euclidean_distance(sparse_first, sparse_second) -
+                    term_euclidean_distance(first, second)) < 1e-12);
+    for (SimilarityAlgorithm algorithm : {SimilarityAlgorithm::COSINE, SimilarityAlgorithm::EUCLIDEAN}) {
+        retriever.set_similarity_algorithm(algorithm);
+        auto tokenized = retriever.search_with_scores("green apples", 4);
+        retriever.add_documents(vectorstore->get_by_ids(ids));
+        auto precomputed = retriever.search_with_scores("green apples", 4);
+        assert(tokenized.size() == precomputed.size());
+        for (size_t i = 0; i < tokenized.size(); ++i) {
+            assert(tokenized[i].first.id == precomputed[i].first.id);
+            assert(std::abs(tokenized[i].second - precomputed[i].second) < 1e-12);
+        }
+        retriever.remove_documents(ids);
+    }
+
+    // A vector stored for an id is only used while the candidate still has that content
+    retriever.add_documents({Document("green apples", {}, ids[2])});
+    assert(retriever.search_with_scores("green apples", 1)[0].first.id != ids[2]);
+    retriever.remove_documents({ids[2]});
+
+    // Searches overlap with add_documents; query terms the retriever never indexed still match
+    retriever.set_similarity_algorithm(SimilarityAlgorithm::OVERLAP);
+    std::atomic<bool> matched(true);
+    std::vector<std::thread> searchers;
+    for (int t = 0; t < 3; ++t) {
+        searchers.emplace_back([&]() {
+            for (int i = 0; i < 50; ++i) {
+                auto found = retriever.search_with_scores("stock market", 1);
+                if (found.empty() || found[0].second <= 0.0) {
+                    matched = false;
+                }
+            }
+        });
+    }
+    for (int i = 0; i < 50; ++i) {
+        retriever.add_documents({Document("apples batch " + std::to_string(i), {}, "extra" + std::to_string(i))});
+    }
+    for (auto& searcher : searchers) {
+        searcher.join();
+    }
+    assert(matched);
+
+    // Deleting shifts slots; the index follows
+    vectorstore->delete_documents({ids[1]});
+    results = vectorstore->similarity_search_with_score("green tea", 2);
+    assert(results[0].first.content == "red apples and green pears");
+    assert(std::abs(results[0].second - 0.2) < 1e-9);
+    vectorstore->add_documents({Document("green tea latte")});
+    assert(vectorstore->similarity_search("green tea", 1)[0].content == "green tea latte");
+
+    std::cout << "Lexical inverted index tests passed!\n\n";
+}
+
+void test_tokenizer() {
+    std::cout << "Testing Tokenizer...\n";
+
+    Tokenizer tokenizer;
+    auto tokens = tokenizer.tokenize("  The Quick\tbrown\nFOX  ");
+    assert((tokens == std::vector<std::string_view>{"the", "quick", "brown", "fox"}));
+    assert(tokenizer.tokenize("").empty() && tokenizer.tokenize(" \r\n ").empty());
+
+    // UTF-8: Latin-1, Greek and Cyrillic capitals are lowercased, Unicode spaces split words
+    tokens = tokenizer.tokenize("Ça\xc2\xa0ÉTÉ ΑΘΗΝΑ Москва");
+    assert((tokens == std::vector<std::string_view>{"ça", "été", "αθηνα", "москва"}));
+
+    // CJK and fullwidth punctuation separate words; without segmentation ideographs are kept intact
+    Tokenizer whole_runs(false, CjkSegmentation::NONE);
+    tokens = whole_runs.tokenize("向量检索，很快。「索引」Vector　search");
+    assert((tokens == std::vector<std::string_view>{"向量检索", "很快", "索引", "vector", "search"}));
+    tokens = whole_runs.tokenize("東京タワー・的");
+    assert(tokens.size() == 1 && tokens[0] == "東京タワー・的");
+
+    // HashingEmbeddings hashes whole runs, so its vectors do not depend on the default mode
+    HashingEmbeddings words_only(1024, false);
+    Embedding run = words_only.embed_query("向量检索");
+    Embedding bigram = words_only.embed_query("量检");
+    assert(dot_product(run.data(), bigram.data(), run.size()) == 0.0f);
+
+    // By default CJK runs become overlapping bigrams and break from adjacent Latin words
+    tokens = tokenizer.tokenize("向量检索，很快。AI模型");
+    assert((tokens == std::vector<std::string_view>{"向量", "量检", "检索", "很快", "ai", "模型"}));
+    tokens = tokenizer.tokenize("東京タワー・的 서울역");
+    assert((tokens == std::vector<std::string_view>{"東京", "京タ", "タワ", "ワー", "的", "서울", "울역"}));
+    Tokenizer unigrams(false, CjkSegmentation::UNIGRAM);
+    tokens = unigrams.tokenize("GPU加速!");
+    assert((tokens == std::vector<std::string_view>{"gpu", "加", "速", "!"}));
+    assert(is_cjk_character(0x4E2D) && is_cjk_character(0x30AB) && !is_cjk_character(0x3002));
+
+    // Malformed bytes stay inside words instead of splitting or dropping them
+    tokens = tokenizer.tokenize("ab\xff\xc3 cd\xe4\xb8");
+    assert(tokens.size() == 2 && tokens[0] == "ab\xff\xc3" && tokens[1] == "cd\xe4\xb8");
+    size_t length = 0;
+    assert(decode_utf8("\xe5\x90\x91", 0, length) == 0x5411 && length == 3);
+    assert(decode_utf8("\xc0\xaf", 0, length) == 0xC0 && length == 1);
+
+    // Punctuation stripping trims token edges only
+    Tokenizer stripping(true);
+    tokens = stripping.tokenize("\"Hello, world!\" isn't -- it?");
+    assert((tokens == std::vector<std::string_view>{"hello", "world", "isn't", "it"}));
+
+    // Once grown, the scratch buffer is reused instead of reallocated
+    tokenizer.tokenize("alpha beta gamma delta");
+    const char* buffer = tokenizer.tokens()[0].data();
+    tokenizer.tokenize("Delta Gamma Beta Alpha");
+    assert(tokenizer.tokens()[0].data() == buffer && tokenizer.tokens()[3] == "alpha");
+
+    // Lexical stores match Chinese words between punctuation and inside longer runs
+    auto store = std::make_shared<InMemoryVectorStore>();
+    store->add_documents({Document("今天天气，很好"), Document("向量检索，很快"), Document("全文检索系统")});
+    assert(store->similarity_search("很快", 1)[0].content == "向量检索，很快");
+    auto results = store->similarity_search_with_score("检索", 3);
+    assert(results[0].second > 0.0 && results[1].second > 0.0 && results[2].second == 0.0);
+
+    // Bigrams keep Chinese postings selective
+    BM25Retriever keyword;
+    keyword.add_documents({Document("今天天气很好"), Document("向量检索很快"), Document("全文检索系统"),
+                           Document("天气预报")});
+    assert(keyword.document_frequency("检索") == 2 && keyword.document_frequency("天气") == 2);
+    assert(keyword.retrieve("向量检索", 1)[0].content == "向量检索很快");
+
+    std::cout << "Tokenizer tests passed!\n\n";
+}
+
+void test_vector_math_kernels() {
+    std::cout << "Testing vector math kernels...\n";
+
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    std::vector<float> a(200), b(200);
+    std::vector<uint8_t> codes(200);
+    std::vector<uint64_t> bits_a(20), bits_b(20);
+    std::vector<uint16_t> halves(200), bhalves(200);
+    for (size_t i = 0; i < a.size(); ++i) {
+        a[i] = dist(rng);
+        b[i] = dist(rng);
+        codes[i] = static_cast<uint8_t>(rng() % 256);
+        halves[i] = float_to_f16(b[i]);
+        bhalves[i] = float_to_bf16(b[i]);
+    }
+    for (size_t i = 0; i < bits_a.size(); ++i) {
+        bits_a[i] = (uint64_t(rng()) << 32) | rng();
+        bits_b[i] = (uint64_t(rng()) << 32) | rng();
+    }
+
+    auto close = [](float x, float y) {
+        return std::abs(x - y) <= 1e-4f * std::max(1.0f, std::abs(y));
+    };
+
+    // Every supported instruction set must agree with the scalar reference,
+    // including odd lengths and unaligned pointers that exercise the tails
+    SimdLevel detected = detect_simd_level();
+    for (int level = 0; level <= static_cast<int>(detected); ++level) {
+        set_simd_level(static_cast<SimdLevel>(level));
+        for (size_t n : {0, 1, 3, 7, 8, 15, 16, 17, 31, 33, 64, 100, 199}) {
+            const float* pa = a.data() + 1;
+            const float* pb = b.data();
+            assert(close(dot_product(pa, pb, n), dot_product_scalar(pa, pb, n)));
+            assert(close(l2_distance_squared(pa, pb, n), l2_distance_squared_scalar(pa, pb, n)));
+            assert(close(cosine_similarity(pa, pb, n), cosine_similarity_scalar(pa, pb, n)));
+            assert(close(dot_product_u8(pa, codes.data() + 1, n), dot_product_u8_scalar(pa, codes.data() + 1, n)));
+        }
+        for (size_t n : {0, 1, 7, 8, 15, 16, 17, 33, 100, 199}) {
+            const float* pa = a.data() + 1;
+            assert(close(dot_product_f16(pa, halves.data(), n), dot_product_f16_scalar(pa, halves.data(), n)));
+            assert(close(l2_distance_squared_f16(pa, halves.data(), n), l2_distance_squared_f16_scalar(pa, halves.data(), n)));
+            assert(close(dot_product_bf16(pa, bhalves.data(), n), dot_product_bf16_scalar(pa, bhalves.data(), n)));
+            assert(close(l2_distance_squared_bf16(pa, bhalves.data(), n), l2_distance_squared_bf16_scalar(pa, bhalves.data(), n)));
+        }
+        for (size_t words : {0, 1, 2, 7, 8, 9, 19}) {
+            assert(hamming_distance(bits_a.data() + 1, bits_b.data(), words) ==
+                   hamming_distance_scalar(bits_a.data() + 1, bits_b.data(), words));
+        }
+    }
+    set_simd_level(detected);
+    assert(hamming_distance(bits_a.data(), bits_a.data(), bits_a.size()) == 0);
+    uint64_t masks[2] = {~uint64_t(0), 0xF0};
+    uint64_t zero[2] = {0, 0};
+    assert(hamming_distance(masks, zero, 2) == 68);
+
+    // 16-bit conversions round to nearest and keep special values
+    for (float value : {0.0f, 1.0f, -2.5f, 65504.0f, 6.1035156e-05f, 5.9604645e-08f}) {
+        assert(f16_to_float(float_to_f16(value)) == value);
+    }
+    assert(f16_to_float(float_to_f16(1.0f + 1.0f / 4096)) == 1.0f);
+    assert(std::isinf(f16_to_float(float_to_f16(1e6f))));
+    assert(std::isnan(f16_to_float(float_to_f16(std::nanf("")))));
+    assert(bf16_to_float(float_to_bf16(1e30f)) > 0.99e30f && bf16_to_float(float_to_bf16(-0.75f)) == -0.75f);
+    for (size_t i = 0; i < b.size(); ++i) {
+        assert(std::abs(f16_to_float(halves[i]) - b[i]) <= 1e-3f);
+        assert(std::abs(bf16_to_float(bhalves[i]) - b[i]) <= 4e-3f);
+    }
+
+    // Zero vectors have no direction
+    std::vector<float> zeros(16, 0.0f);
+    assert(cosine_similarity(zeros.data(), a.data(), zeros.size()) == 0.0f);
+
+    // Top-k selection keeps the best scores, ties broken by lower slot
+    TopKCollector top_k(3);
+    double scores[] = {0.5, 0.9, 0.1, 0.9, 0.7, 0.2};
+    for (uint32_t slot = 0; slot < 6; ++slot) {
+        top_k.push(scores[slot], slot);
+    }
+    assert(top_k.threshold() == 0.7);
+    auto best = top_k.take_sorted();
+    assert(best.size() == 3);
+    assert(best[0].second == 1 && best[1].second == 3 && best[2].second == 4);
+    assert(top_k.size() == 0);
+
+    std::cout << "Vector math kernel tests passed!\n\n";
+}
+
+// Embedding model that drops the last vector of every batch
+class TruncatingEmbeddings : public HashingEmbeddings {
+public:
+    explicit TruncatingEmbeddings(size_t dimension) : HashingEmbeddings(dimension) {}
+
+    std::vector<Embedding> embed_documents(const StringList& texts) override {
+        auto embeddings = HashingEmbeddings::embed_documents(texts);
+        if (!embeddings.empty()) {
+            embeddings.pop_back();
+        }
+        return embeddings;
+    }
+};
+
+void test_dense_vector_store() {
+    std::cout << "Testing InMemoryVectorStore with embeddings...\n";
+
+    auto embeddings = std::make_shared<HashingEmbeddings>(128);
+
+    // Embeddings are deterministic and normalized
+    Embedding first = embeddings->embed_query("The quick brown fox");
+    Embedding second = embeddings->embed_query("The quick brown fox");
+    assert(first.size() == 128);
+    assert(first == second);
+    assert(std::abs(dot_product(first.data(), first.data(), first.size()) - 1.0f) < 1e-4f);
+
+    auto vectorstore = std::make_shared<InMemoryVectorStore>(embeddings);
+    StringList ids = vectorstore->add_documents({
+        Document("The quick brown fox", {{"category", "animals"}}),
+        Document("Machine learning algorithms", {{"category", "technology"}}),
+        Document("The weather is sunny today", {{"category", "weather"}})
+    });
+    assert(ids.size() == 3);
+
+    auto results = vectorstore->similarity_search_with_score("quick fox", 2);
+    assert(results.size() == 2);
+    assert(results[0].first.content == "The quick brown fox");
+    assert(results[0].second >= results[1].second);
+
+    // Deleting keeps documents and vectors aligned
+    vectorstore->delete_documents({ids[0]});
+    results = vectorstore->similarity_search_with_score("machine learning", 5);
+    assert(results.size() == 2);
+    assert(results[0].first.content == "Machine learning algorithms");
+
+    // A model returning too few vectors is rejected before anything is stored
+    InMemoryVectorStore truncated(std::make_shared<TruncatingEmbeddings>(128));
+    bool rejected = false;
+    try {
+        truncated.add_documents({Document("first text"), Document("second text")});
+    } catch (const std::runtime_error&) {
+        rejected = true;
+    }
+    assert(rejected && truncated.size() == 0);
+
+    std::cout << "InMemoryVectorStore with embeddings tests passed!\n\n";
+}
+
+// Build a corpus of synthetic documents over a small vocabulary
+std::vector<Document> make_synthetic_documents(size_t count, unsigned int seed) {
+    static const char* vocabulary[] = {
+        "vector", "index", "graph", "search", "query", "memory", "agent", "chain",
+        "model", "token", "cache", "shard", "latency", "recall", "cluster", "embedding",
+        "document", "storage", "thread", "kernel", "filter", "score", "retrieval", "prompt"
+    };
+    std::mt19937 rng(seed);
+    std::vector<Document> documents;
+    for (size_t i = 0; i < count; ++i) {
+        String content = "doc" + std::to_string(i);
+        for (int w = 0; w < 8; ++w) {
+            content += " ";
+            content += vocabulary[rng() % (sizeof(vocabulary) / sizeof(vocabulary[0]))];
+        }
+        documents.push_back(Document(content, {{"index", std::to_string(i)}}, "doc" + std::to_string(i)));
+    }
+    return documents;
+}
+
+void test_vector_store_compaction() {
+    std::cout << "Testing InMemoryVectorStore tombstones and compaction...\n";
+
+    auto embeddings = std::make_shared<HashingEmbeddings>(64);
+    auto documents = make_synthetic_documents(500, 41);
+    auto vectorstore = std::make_shared<InMemoryVectorStore>(embeddings);
+    vectorstore->set_compaction_threshold(0.0);
+    vectorstore->add_documents(documents);
+
+    // Deletes only leave tombstones
+    StringList deleted_ids;
+    for (size_t i = 0; i < 300; ++i) {
+        deleted_ids.push_back("doc" + std::to_string(i));
+    }
+    vectorstore->delete_documents(deleted_ids);
+    assert(vectorstore->size() == 200);
+    assert(vectorstore->tombstone_count() == 300);
+    assert(vectorstore->get_by_ids({"doc10", "doc400"}).size() == 1);
+    auto before = vectorstore->similarity_search_with_score(documents[10].content, 10);
+    for (const auto& result : before) {
+        assert(std::stoi(result.first.metadata.at("index")) >= 300);
+    }
+
+    // Compaction repacks storage without changing results
+    vectorstore->compact();
+    assert(vectorstore->tombstone_count() == 0);
+    assert(vectorstore->size() == 200);
+    assert(vectorstore->get_all_documents().size() == 200);
+    auto after = vectorstore->similarity_search_with_score(documents[10].content, 10);
+    assert(after.size() == before.size());
+    for (size_t i = 0; i < after.size(); ++i) {
+        assert(after[i].first.id == before[i].first.id);
+    }
+
+    // Re-adding an ID replaces the document
+    vectorstore->add_documents({Document("replacement text", {}, "doc450")});
+    assert(vectorstore->size() == 200);
+    assert(vectorstore->get_by_ids({"doc450"})[0].content == "replacement text");
+
+    // Crossing the threshold compacts in the background while searches run
+    vectorstore->set_compaction_threshold(0.2);
+    std::atomic<bool> stop(false);
+    std::thread reader([&]() {
+        while (!stop) {
+            auto results = vectorstore->similarity_search(documents[420].content, 3);
+            assert(!results.empty());
+        }
+    });
+    StringList more_ids;
+    for (size_t i = 300; i < 400; ++i) {
+        more_ids.push_back("doc" + std::to_string(i));
+    }
+    vectorstore->delete_documents(more_ids);
+    for (int attempt = 0; attempt < 500 && vectorstore->tombstone_count() > 0; ++attempt) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    stop = true;
+    reader.join();
+    assert(vectorstore->tombstone_count() == 0);
+    assert(vectorstore->size() == 100);
+    assert(vectorstore->similarity_search(documents[420].content, 1)[0].id == "doc420");
+
+    // Word overlap stores keep their inverted index consistent across compaction
+    auto lexical = std::make_shared<InMemoryVectorStore>();
+    lexical->add_documents(documents);
+    lexical->set_compaction_threshold(0.0);
+    lexical->delete_documents(deleted_ids);
+    lexical->compact();
+    assert(lexical->similarity_search(documents[310].content, 1)[0].id == "doc310");
+
+    std::cout << "InMemoryVectorStore tombstone and compaction tests passed!\n\n";
+}
+
+void test_vector_store_persistence() {
+    std::cout << "Testing InMemoryVectorStore persistence...\n";
+
+    auto embeddings = std::make_shared<HashingEmbeddings>(48);
+    auto documents = make_synthetic_documents(200, 53);
+    auto vectorstore = std::make_shared<InMemoryVectorStore>(embeddings, DistanceMetric::DOT_PRODUCT);
+    vectorstore->add_documents(documents);
+    vectorstore->delete_documents({"doc3", "doc4"});
+    String path = "test_vector_store.lcvs";
+    assert(vectorstore->save(path));
+
+    // Reopening maps the vectors and restores documents, IDs and metadata
+    auto reopened = InMemoryVectorStore::open(path, embeddings, true);
+    assert(reopened);
+    assert(reopened->size() == 198);
+    assert(reopened->get_metric() == DistanceMetric::DOT_PRODUCT);
+    assert(reopened->get_by_ids({"doc3"}).empty());
+    auto restored = reopened->get_by_ids({"doc7"});
+    assert(restored.size() == 1);
+    assert(restored[0].content == documents[7].content);
+    assert(restored[0].metadata.at("index") == "7");
+    auto expected = vectorstore->similarity_search_with_score(documents[7].content, 5);
+    auto results = reopened->similarity_search_with_score(documents[7].content, 5);
+    assert(results.size() == expected.size());
+    for (size_t i = 0; i < results.size(); ++i) {
+        assert(results[i].first.id == expected[i].first.id);
+        assert(std::abs(results[i].second - expected[i].second) < 1e-6);
+    }
+
+    // The first write copies the mapped vectors
+    reopened->add_documents({Document("written after open", {}, "fresh")});
+    reopened->delete_documents({"doc7"});
+    assert(reopened->similarity_search("written after open", 1)[0].id == "fresh");
+
+    // Mismatched models and corrupt files are rejected
+    assert(!InMemoryVectorStore::open(path, std::make_shared<HashingEmbeddings>(32)));
+    assert(!InMemoryVectorStore::open("missing_vector_store.lcvs", embeddings));
+    {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(200);
+        file.put('#');
+    }
+    assert(!InMemoryVectorStore::open(path, embeddings));
+
+    // Word overlap stores round-trip too
+    auto lexical = std::make_shared<InMemoryVectorStore>();
+    lexical->add_documents(documents);
+    assert(lexical->save(path));
+    auto lexical_reopened = InMemoryVectorStore::open(path);
+    assert(lexical_reopened && lexical_reopened->size() == 200);
+    assert(lexical_reopened->similarity_search(documents[11].content, 1)[0].id == "doc11");
+
+    std::remove(path.c_str());
+    std::cout << "InMemoryVectorStore persistence tests passed!\n\n";
+}
+
+void test_hnsw_vector_store() {
+    std::cout << "Testing HNSWVectorStore...\n";
+
+    auto embeddings = std::make_shared<HashingEmbeddings>(64);
+    HNSWConfig config;
+    config.M = 8;
+    config.ef_construction = 64;
+    config.ef_search = 32;
+    auto vectorstore = std::make_shared<HNSWVectorStore>(embeddings, config);
+
+    // Concurrent inserts from several threads
+    auto documents = make_synthetic_documents(400, 11);
+    std::vector<std::thread> writers;
+    for (size_t t = 0; t < 4; ++t) {
+        writers.emplace_back([&, t]() {
+            std::vector<Document> batch(documents.begin() + t * 100, documents.begin() + (t + 1) * 100);
+            vectorstore->add_documents(batch);
+        });
+    }
+    for (auto& writer : writers) {
+        writer.join();
+    }
+    assert(vectorstore->size() == 400);
+
+    // An exact copy of a document's content is its own nearest neighbour
+    auto results = vectorstore->similarity_search_with_score(documents[42].content, 3);
+    assert(results.size() == 3);
+    assert(results[0].first.id == "doc42");
+    assert(results[0].second >= results[1].second);
+
+    // Soft deletes hide documents from search and lookups
+    vectorstore->delete_documents({"doc42"});
+    assert(vectorstore->size() == 399);
+    assert(vectorstore->get_by_ids({"doc42", "doc43"}).size() == 1);
+    for (const auto& doc : vectorstore->similarity_search(documents[42].content, 10)) {
+        assert(doc.id != "doc42");
+    }
+
+    // Recall against the exact scan
+    StringList queries;
+    for (size_t i = 0; i < 20; ++i) {
+        queries.push_back(documents[i * 7].content);
+    }
+    HNSWSearchReport report = vectorstore->evaluate(queries, 5);
+    assert(report.queries == 20);
+    assert(report.recall >= 0.9);
+
+    // A model returning too few vectors is rejected before the graph changes
+    HNSWVectorStore truncated(std::make_shared<TruncatingEmbeddings>(64), config);
+    bool rejected = false;
+    try {
+        truncated.add_documents(std::vector<Document>(documents.begin(), documents.begin() + 3));
+    } catch (const std::runtime_error&) {
+        rejected = true;
+    }
+    assert(rejected && truncated.size() == 0);
+
+    std::cout << "HNSWVectorStore tests passed!\n\n";
+}
+
+void test_ivf_vector_store() {
+    std::cout << "Testing IVFFlatVectorStore...\n";
+
+    auto embeddings = std::make_shared<HashingEmbeddings>(64);
+    IVFConfig config;
+    config.nlist = 8;
+    config.nprobe = 8;
+    config.auto_train_size = 300;
+    auto vectorstore = std::make_shared<IVFFlatVectorStore>(embeddings, config);
+    auto exact = std::make_shared<InMemoryVectorStore>(embeddings);
+
+    // Untrained stores scan everything
+    auto documents = make_synthetic_documents(400, 23);
+    vectorstore->add_documents(std::vector<Document>(documents.begin(), documents.begin() + 100));
+    assert(!vectorstore->is_trained());
+
+    // Crossing the threshold trains the centroids
+    vectorstore->add_documents(std::vector<Document>(documents.begin() + 100, documents.end()));
+    exact->add_documents(documents);
+    assert(vectorstore->is_trained());
+    assert(vectorstore->size() == 400);
+    size_t listed = 0;
+    for (size_t list_size : vectorstore->get_list_sizes()) {
+        listed += list_size;
+    }
+    assert(listed == 400);
+
+    // Probing every list matches the exact scan
+    auto results = vectorstore->similarity_search_with_score(documents[5].content, 5);
+    auto expected = exact->similarity_search_with_score(documents[5].content, 5);
+    assert(results.size() == 5);
+    assert(results[0].first.id == "doc5");
+    for (size_t i = 0; i < results.size(); ++i) {
+        assert(std::abs(results[i].second - expected[i].second) < 1e-5);
+    }
+
+    // Incremental adds go straight to their nearest list
+    vectorstore->set_nprobe(2);
+    vectorstore->add_documents({Document("brand new document about shards and kernels", {}, "fresh")});
+    assert(vectorstore->similarity_search("brand new document about shards and kernels", 1)[0].id == "fresh");
+
+    vectorstore->delete_documents({"fresh", "doc5"});
+    assert(vectorstore->size() == 399);
+    assert(vectorstore->get_by_ids({"fresh", "doc5", "doc6"}).size() == 1);
+
+    // A model returning too few vectors is rejected before any list changes
+    IVFFlatVectorStore truncated(std::make_shared<TruncatingEmbeddings>(64), config);
+    bool rejected = false;
+    try {
+        truncated.add_documents(std::vector<Document>(documents.begin(), documents.begin() + 3));
+    } catch (const std::runtime_error&) {
+        rejected = true;
+    }
+    assert(rejected && truncated.size() == 0);
+
+    std::cout << "IVFFlatVectorStore tests passed!\n\n";
+}
+
+void test_quantized_vector_store() {
+    std::cout << "Testing QuantizedVectorStore...\n";
+
+    auto embeddings = std::make_shared<HashingEmbeddings>(64);
+    auto documents = make_synthetic_documents(400, 31);
+    StringList queries;
+    for (size_t i = 0; i < 20; ++i) {
+        queries.push_back(documents[i * 7].content);
+    }
+    String path = "test_quantized_vectors.bin";
+
+    // Int8 scalar quantization
+    QuantizationConfig config;
+    config.training_size = 300;
+    config.full_precision_path = path;
+    auto scalar = std::make_shared<QuantizedVectorStore>(embeddings, config);
+    scalar->add_documents(std::vector<Document>(documents.begin(), documents.begin() + 100));
+    assert(!scalar->is_trained());
+    scalar->add_documents(std::vector<Document>(documents.begin() + 100, documents.end()));
+    assert(scalar->is_trained());
+    assert(scalar->size() == 400);
+    assert(scalar->similarity_search(documents[5].content, 1)[0].id == "doc5");
+
+    QuantizationReport report = scalar->evaluate(queries, 5);
+    assert(report.recall >= 0.9);
+    assert(report.compression_ratio > 3.5);
+
+    // Product quantization with exact rescoring of the best candidates
+    config.type = QuantizationType::PRODUCT;
+    config.pq_subspaces = 8;
+    config.rescore_candidates = 50;
+    auto product = std::make_shared<QuantizedVectorStore>(embeddings, config);
+    product->add_documents(documents);
+    assert(product->is_trained());
+    report = product->evaluate(queries, 5);
+    assert(report.recall >= 0.9);
+    assert(report.compression_ratio > 20.0);
+
+    // Rescored scores are exact
+    auto exact = std::make_shared<InMemoryVectorStore>(embeddings);
+    exact->add_documents(documents);
+    auto results = product->similarity_search_with_score(documents[9].content, 3);
+    auto expected = exact->similarity_search_with_score(documents[9].content, 3);
+    assert(results[0].first.id == "doc9");
+    assert(std::abs(results[0].second - expected[0].second) < 1e-5);
+
+    product->delete_documents({"doc9"});
+    assert(product->size() == 399);
+    assert(product->get_by_ids({"doc9"}).empty());
+    assert(product->similarity_search(documents[9].content, 1)[0].id != "doc9");
+
+    // Sign bits need no training; Hamming distance prefilters and rescoring restores the exact ranking
+    config.type = QuantizationType::BINARY;
+    config.rescore_candidates = 100;
+    auto binary = std::make_shared<QuantizedVectorStore>(embeddings, config);
+    assert(binary->is_trained());
+    binary->add_documents(documents);
+    report = binary->evaluate(queries, 5);
+    assert(report.recall >= 0.9);
+    assert(report.compression_ratio >= 30.0);
+    results = binary->similarity_search_with_score(documents[12].content, 3);
+    expected = exact->similarity_search_with_score(documents[12].content, 3);
+    assert(results[0].first.id == "doc12");
+    assert(std::abs(results[0].second - expected[0].second) < 1e-5);
+
+    // Half precision halves memory and needs neither training nor rescoring
+    for (QuantizationType type : {QuantizationType::FLOAT16, QuantizationType::BFLOAT16}) {
+        QuantizationConfig half_config;
+        half_config.type = type;
+        half_config.full_precision_path = path;
+        auto half = std::make_shared<QuantizedVectorStore>(embeddings, half_config);
+        assert(half->is_trained());
+        half->add_documents(documents);
+        report = half->evaluate(queries, 5);
+        assert(report.recall >= 0.95);
+        assert(report.compression_ratio > 1.5);
+        results = half->similarity_search_with_score(documents[12].content, 3);
+        assert(results[0].first.id == "doc12");
+        assert(std::abs(results[0].second - expected[0].second) < 1e-2);
+    }
+
+    // A model returning too few vectors is rejected before any code is stored
+    QuantizedVectorStore truncated(std::make_shared<TruncatingEmbeddings>(64), QuantizationConfig());
+    bool rejected = false;
+    try {
+        truncated.add_documents(std::vector<Document>(documents.begin(), documents.begin() + 3));
+    } catch (const std::runtime_error&) {
+        rejected = true;
+    }
+    assert(rejected && truncated.size() == 0);
+
+    std::remove(path.c_str());
+    std::cout << "QuantizedVectorStore tests passed!\n\n";
+}
+
+void test_batch_search() {
+    std::cout << "Testing batched similarity search...\n";
+
+    auto embeddings = std::make_shared<HashingEmbeddings>(64);
+    auto documents = make_synthetic_documents(3000, 61);
+    StringList queries;
+    for (size_t i = 0; i < 12; ++i) {
+        queries.push_back(documents[i * 97].content);
+    }
+
+    // A batch returns the same results as one search per query
+    auto dense = std::make_shared<InMemoryVectorStore>(embeddings, DistanceMetric::EUCLIDEAN);
+    auto lexical = std::make_shared<InMemoryVectorStore>();
+    auto hnsw = std::make_shared<HNSWVectorStore>(embeddings);
+    dense->add_documents(documents);
+    lexical->add_documents(documents);
+    hnsw->add_documents(std::vector<Document>(documents.begin(), documents.begin() + 300));
+    dense->delete_documents({"doc97"});
+    for (VectorStore* store : {static_cast<VectorStore*>(dense.get()), static_cast<VectorStore*>(lexical.get()),
+                               static_cast<VectorStore*>(hnsw.get())}) {
+        auto batch = store->similarity_search_batch_with_score(queries, 5);
+        assert(batch.size() == queries.size());
+        for (size_t q = 0; q < queries.size(); ++q) {
+            auto single = store->similarity_search_with_score(queries[q], 5);
+            assert(batch[q].size() == single.size());
+            for (size_t i = 0; i < single.size(); ++i) {
+                assert(batch[q][i].first.id == single[i].first.id);
+                assert(std::abs(batch[q][i].second - single[i].second) < 1e-9);
+            }
+        }
+    }
+    auto documents_only = dense->similarity_search_batch(queries, 3);
+    assert(documents_only.size() == queries.size());
+    assert(documents_only[2][0].id == "doc194");
+    assert(dense->similarity_search_batch({}, 3).empty());
+
+    // The document-only batch goes through a store's batched scored search
+    struct BatchCountingStore : public InMemoryVectorStore {
+        using InMemoryVectorStore::InMemoryVectorStore;
+        size_t batches = 0;
+
+        std::vector<std::vector<std::pair<Document, double>>> similarity_search_batch_with_score(
+            const StringList& batch_queries, int k) override {
+            batches++;
+            return InMemoryVectorStore::similarity_search_batch_with_score(batch_queries, k);
+        }
+    };
+    BatchCountingStore counting(embeddings);
+    counting.add_documents(std::vector<Document>(documents.begin(), documents.begin() + 50));
+    assert(counting.similarity_search_batch(queries, 3).size() == queries.size() && counting.batches == 1);
+
+    // RAGChain answers a batch with the same prompts as single queries
+    RAGChain rag_chain(lexical, std::make_shared<EchoLLM>());
+    StringList questions = {queries[0], queries[3]};
+    StringList answers = rag_chain.query_batch(questions);
+    assert(answers.size() == 2);
+    assert(answers[0] == rag_chain.query(questions[0]));
+    assert(answers[1] == rag_chain.query(questions[1]));
+
+    // RAGChain stores chunks in input order and reports chunks it could not store
+    auto ordered = std::make_shared<InMemoryVectorStore>();
+    RAGChain ordered_chain(ordered, std::make_shared<EchoLLM>());
+    std::vector<Document> sources(documents.begin(), documents.begin() + 40);
+    ordered_chain.add_documents(sources);
+    auto expected_chunks = TextSplitter().split_documents(sources);
+    auto stored = ordered->similarity_search("unmatched", static_cast<int>(expected_chunks.size()));
+    assert(stored.size() == expected_chunks.size());
+    for (size_t i = 0; i < stored.size(); ++i) {
+        assert(stored[i].id == expected_chunks[i].id);
+    }
+    RAGChain failing_chain(std::make_shared<InMemoryVectorStore>(std::make_shared<TruncatingEmbeddings>(32)),
+                           std::make_shared<EchoLLM>());
+    bool rejected = false;
+    try {
+        failing_chain.add_documents(sources);
+    } catch (const std::runtime_error&) {
+        rejected = true;
+    }
+    assert(rejected);
+
+    std::cout << "Batched similarity search tests passed!\n\n";
+}
+
+void test_parallel_scan() {
+    std::cout << "Testing parallel partitioned scan...\n";
+
+    // parallel_for runs every index exactly once, also when nested
+    auto pool = std::make_shared<ThreadPool>(3);
+    std::vector<std::atomic<int>> hits(1000);
+    pool->parallel_for(hits.size(), [&](size_t i) { hits[i]++; });
+    for (const auto& hit : hits) {
+        assert(hit == 1);
+    }
+    std::atomic<int> nested(0);
+    pool->parallel_for(8, [&](size_t) {
+        pool->parallel_for(8, [&](size_t) { nested++; });
+    });
+    assert(nested == 64);
+
+    // A throwing task is rethrown on the caller after the running tasks finish
+    std::atomic<int> running(0);
+    bool rethrown = false;
+    try {
+        pool->parallel_for(64, [&](size_t i) {
+            running++;
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+            running--;
+            if (i == 3) {
+                throw std::runtime_error("task failed");
+            }
+        });
+    } catch (const std::runtime_error& e) {
+        rethrown = String(e.what()) == "task failed";
+    }
+    assert(rethrown && running == 0);
+    pool->parallel_for(hits.size(), [&](size_t i) { hits[i]++; });
+    assert(hits[999] == 2);
+
+    // Partitioned scans return exactly what a sequential scan returns
+    auto embeddings = std::make_shared<HashingEmbeddings>(32);
+    auto documents = make_synthetic_documents(20000, 71);
+    auto vectorstore = std::make_shared<InMemoryVectorStore>(embeddings, DistanceMetric::EUCLIDEAN);
+    vectorstore->set_compaction_threshold(0.0);
+    vectorstore->set_thread_pool(pool);
+    vectorstore->add_documents(documents);
+    vectorstore->delete_documents({"doc17", "doc9000"});
+    for (size_t q = 0; q < documents.size(); q += 1999) {
+        vectorstore->set_parallel_threshold(0);
+        auto sequential = vectorstore->similarity_search_with_score(documents[q].content, 10);
+        vectorstore->set_parallel_threshold(1);
+        auto parallel = vectorstore->similarity_search_with_score(documents[q].content, 10);
+        assert(parallel.size() == sequential.size());
+        for (size_t i = 0; i < parallel.size(); ++i) {
+            assert(parallel[i].first.id == sequential[i].first.id);
+            assert(parallel[i].second == sequential[i].second);
+        }
+    }
+    assert(vectorstore->similarity_search(documents[9000].content, 1)[0].id != "doc9000");
+
+    std::cout << "Parallel partitioned scan tests passed!\n\n";
+}
+
+void test_concurrent_vector_store() {
+    std::cout << "Testing ConcurrentVectorStore...\n";
+
+    auto embeddings = std::make_shared<HashingEmbeddings>(64);
+    auto documents = make_synthetic_documents(2000, 67);
+
+    // Results match InMemoryVectorStore, however the documents were batched
+    auto reference = std::make_shared<InMemoryVectorStore>(embeddings);
+    auto store = std::make_shared<ConcurrentVectorStore>(embeddings);
+    reference->add_documents(documents);
+    for (size_t start = 0; start < documents.size(); start += 37) {
+        size_t end = std::min(start + 37, documents.size());
+        store->add_documents(std::vector<Document>(documents.begin() + start, documents.begin() + end));
+    }
+    assert(store->size() == 2000);
+    assert(store->segment_count() <= 12);
+    for (size_t q = 0; q < 2000; q += 211) {
+        auto expected = reference->similarity_search_with_score(documents[q].content, 5);
+        auto results = store->similarity_search_with_score(documents[q].content, 5);
+        assert(results.size() == expected.size());
+        for (size_t i = 0; i < results.size(); ++i) {
+            assert(results[i].first.id == expected[i].first.id);
+            assert(std::abs(results[i].second - expected[i].second) < 1e-6);
+        }
+    }
+
+    // Deletes and replacements publish new tombstones
+    store->delete_documents({"doc5", "doc6"});
+    store->add_documents({Document("replacement text", {}, "doc7")});
+    assert(store->size() == 1998);
+    assert(store->get_by_ids({"doc5", "doc8"}).size() == 1);
+    assert(store->get_by_ids({"doc7"})[0].content == "replacement text");
+    assert(store->similarity_search(documents[5].content, 1)[0].id != "doc5");
+    store->compact();
+    assert(store->segment_count() == 1);
+    assert(store->size() == 1998);
+    assert(store->similarity_search(documents[9].content, 1)[0].id == "doc9");
+
+    // Readers keep searching consistent snapshots while a writer ingests
+    auto live = std::make_shared<ConcurrentVectorStore>(embeddings);
+    live->add_documents(std::vector<Document>(documents.begin(), documents.begin() + 100));
+    std::atomic<bool> stop(false);
+    std::atomic<size_t> searches(0);
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 4; ++r) {
+        readers.emplace_back([&, r]() {
+            size_t last_size = 0;
+            while (!stop) {
+                size_t current_size = live->size();
+                assert(current_size >= last_size);
+                last_size = current_size;
+                auto results = live->similarity_search(documents[r * 10].content, 3);
+                assert(results.size() == 3);
+                assert(results[0].id == "doc" + std::to_string(r * 10));
+                searches++;
+            }
+        });
+    }
+    for (size_t start = 100; start < documents.size(); start += 50) {
+        live->add_documents(std::vector<Document>(documents.begin() + start, documents.begin() + start + 50));
+    }
+    stop = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    assert(live->size() == 2000);
+    assert(searches > 0);
+
+    // Word overlap stores rank like InMemoryVectorStore
+    auto lexical_reference = std::make_shared<InMemoryVectorStore>();
+    auto lexical = std::make_shared<ConcurrentVectorStore>();
+    lexical_reference->add_documents(std::vector<Document>(documents.begin(), documents.begin() + 300));
+    for (size_t start = 0; start < 300; start += 100) {
+        lexical->add_documents(std::vector<Document>(documents.begin() + start, documents.begin() + start + 100));
+    }
+    auto expected = lexical_reference->similarity_search_with_score("vector index graph", 8);
+    auto results = lexical->similarity_search_with_score("vector index graph", 8);
+    assert(results.size() == expected.size());
+    for (size_t i = 0; i < results.size(); ++i) {
+        assert(results[i].first.id == expected[i].first.id);
+    }
+
+    // A model returning too few vectors is rejected before a segment is published
+    ConcurrentVectorStore truncated(std::make_shared<TruncatingEmbeddings>(32));
+    bool rejected = false;
+    try {
+        truncated.add_documents(std::vector<Document>(documents.begin(), documents.begin() + 3));
+    } catch (const std::runtime_error&) {
+        rejected = true;
+    }
+    assert(rejected && truncated.size() == 0);
+
+    std::cout << "ConcurrentVectorStore tests passed!\n\n";
+}
+
+void test_metadata_filter() {
+    std::cout << "Testing metadata filtered search...\n";
+
+    auto embeddings = std::make_shared<HashingEmbeddings>(64);
+    auto documents = make_synthetic_documents(5000, 73);
+    for (size_t i = 0; i < documents.size(); ++i) {
+        documents[i].metadata["bucket"] = std::to_string(i % 100);
+        documents[i].metadata["parity"] = i % 2 ? "odd" : "even";
+    }
+
+    // Exact filtered top-k, computed by ranking everything and filtering afterwards
+    auto expected_filtered = [](VectorStore& store, const String& query, int k, const MetadataFilter& filter) {
+        std::vector<std::pair<Document, double>> expected;
+        for (auto& result : store.similarity_search_with_score(query, 100000)) {
+            if (matches_filter(result.first.metadata, filter) && static_cast<int>(expected.size()) < k) {
+                expected.push_back(result);
+            }
+        }
+        return expected;
+    };
+
+    auto dense = std::make_shared<InMemoryVectorStore>(embeddings);
+    auto lexical = std::make_shared<InMemoryVectorStore>();
+    auto concurrent = std::make_shared<ConcurrentVectorStore>(embeddings);
+    for (VectorStore* store : {static_cast<VectorStore*>(dense.get()), static_cast<VectorStore*>(lexical.get()),
+                               static_cast<VectorStore*>(concurrent.get())}) {
+        store->add_documents(documents);
+        store->delete_documents({"doc7", "doc107"});
+        for (const MetadataFilter& filter : {MetadataFilter{{"bucket", "7"}},
+                                             MetadataFilter{{"bucket", "7"}, {"parity", "odd"}},
+                                             MetadataFilter{{"index", "4321"}}}) {
+            auto results = store->similarity_search_with_filter(documents[7].content, 5, filter);
+            auto expected = expected_filtered(*store, documents[7].content, 5, filter);
+            assert(results.size() == expected.size());
+            for (size_t i = 0; i < results.size(); ++i) {
+                assert(results[i].first.id == expected[i].first.id);
+                assert(results[i].first.id != "doc7" && results[i].first.id != "doc107");
+            }
+        }
+        assert(store->similarity_search_with_filter("vector", 3, {{"index", "4321"}}).size() == 1);
+        assert(store->similarity_search_with_filter("vector", 3, {{"bucket", "none"}}).empty());
+        assert(store->similarity_search_with_filter("vector", 3, {{"bucket", "7"}, {"parity", "even"}}).empty());
+    }
+
+    // The attribute index follows compaction
+    dense->compact();
+    auto results = dense->similarity_search_with_filter(documents[0].content, 100, {{"bucket", "7"}});
+    assert(results.size() == 48);
+
+    // A selective filter still returns k results through AdvancedRetriever
+    AdvancedRetriever retriever(dense);
+    auto filtered = retriever.search_with_scores("vector", 3, {{"bucket", "42"}});
+    assert(filtered.size() == 3);
+    for (const auto& result : filtered) {
+        assert(result.first.metadata.at("bucket") == "42");
+    }
+
+    std::cout << "Metadata filtered search tests passed!\n\n";
+}
+
+void test_sharded_vector_store() {
+    std::cout << "Testing ShardedVectorStore...\n";
+
+    auto embeddings = std::make_shared<HashingEmbeddings>(64);
+    auto documents = make_synthetic_documents(3000, 79);
+    auto reference = std::make_shared<InMemoryVectorStore>(embeddings);
+    auto sharded = std::make_shared<ShardedVectorStore>(4, [&]() {
+        return std::make_shared<InMemoryVectorStore>(embeddings);
+    });
+    sharded->set_thread_pool(std::make_shared<ThreadPool>(3));
+    reference->add_documents(documents);
+    StringList ids = sharded->add_documents(documents);
+    assert(ids.size() == documents.size() && ids[12] == "doc12");
+
+    // Every shard holds part of the corpus
+    size_t total = 0;
+    for (size_t s = 0; s < sharded->shard_count(); ++s) {
+        size_t size = std::static_pointer_cast<InMemoryVectorStore>(sharded->shard(s))->size();
+        assert(size > 500);
+        total += size;
+    }
+    assert(total == documents.size());
+
+    // Scatter-gather returns the same top-k as one store
+    StringList queries;
+    for (size_t q = 0; q < documents.size(); q += 301) {
+        queries.push_back(documents[q].content);
+    }
+    auto batch = sharded->similarity_search_batch_with_score(queries, 6);
+    for (size_t q = 0; q < queries.size(); ++q) {
+        auto expected = reference->similarity_search_with_score(queries[q], 6);
+        auto results = sharded->similarity_search_with_score(queries[q], 6);
+        assert(results.size() == expected.size() && batch[q].size() == expected.size());
+        for (size_t i = 0; i < results.size(); ++i) {
+            assert(results[i].first.id == expected[i].first.id);
+            assert(batch[q][i].first.id == expected[i].first.id);
+            assert(std::abs(results[i].second - expected[i].second) < 1e-9);
+        }
+    }
+    auto filtered = sharded->similarity_search_with_filter(documents[5].content, 3, {{"index", "2500"}});
+    assert(filtered.size() == 1 && filtered[0].first.id == "doc2500");
+
+    // Lookups and deletes are routed by ID; generated IDs route too
+    auto found = sharded->get_by_ids({"doc9", "missing", "doc3"});
+    assert(found.size() == 2 && found[0].id == "doc9" && found[1].id == "doc3");
+    sharded->delete_documents({"doc9", "doc3"});
+    assert(sharded->get_by_ids({"doc9", "doc3"}).empty());
+    assert(sharded->similarity_search(documents[9].content, 1)[0].id != "doc9");
+    StringList generated = sharded->add_documents({Document("no id given")});
+    assert(generated[0].size() == 16);
+    assert(sharded->get_by_ids(generated)[0].content == "no id given");
+
+    // One shard can be compacted on its own
+    auto shard = std::static_pointer_cast<InMemoryVectorStore>(sharded->shard(sharded->shard_for_id("doc9")));
+    shard->compact();
+    assert(shard->tombstone_count() == 0);
+    assert(sharded->similarity_search(documents[10].content, 1)[0].id == "doc10");
+
+    // A failing shard does not stop the others; its exception reaches the caller
+    auto healthy = std::make_shared<InMemoryVectorStore>(std::make_shared<HashingEmbeddings>(32));
+    ShardedVectorStore mixed({healthy, std::make_shared<HNSWVectorStore>(std::make_shared<TruncatingEmbeddings>(32))});
+    std::vector<Document> part(documents.begin(), documents.begin() + 40);
+    bool rejected = false;
+    try {
+        mixed.add_documents(part);
+    } catch (const std::runtime_error&) {
+        rejected = true;
+    }
+    size_t routed_to_healthy = 0;
+    for (const auto& doc : part) {
+        routed_to_healthy += mixed.shard_for_id(doc.id) == 0 ? 1 : 0;
+    }
+    assert(rejected && healthy->size() == routed_to_healthy && routed_to_healthy > 0);
+
+    std::cout << "ShardedVectorStore tests passed!\n\n";
+}
+
+// Hashing embedder that counts how many texts it was asked to embed
+class CountingEmbeddings : public HashingEmbeddings {
+public:
+    std::atomic<size_t> embedded{0};
+
+    explicit CountingEmbeddings(size_t dimension) : HashingEmbeddings(dimension) {}
+
+    std::vector<Embedding> embed_documents(const StringList& texts) override {
+        embedded += texts.size();
+        return HashingEmbeddings::embed_documents(texts);
+    }
+
+    Embedding embed_query(const String& text) override {
+        embedded++;
+        return HashingEmbeddings::embed_query(text);
+    }
+};
+
+void test_embedding_cache() {
+    std::cout << "Testing EmbeddingCache...\n";
+
+    auto model = std::make_shared<CountingEmbeddings>(32);
+    auto documents = make_synthetic_documents(200, 83);
+    StringList texts;
+    for (const auto& doc : documents) {
+        texts.push_back(doc.content);
+    }
+
+    // Repeated batches and queries are served from memory, with identical vectors
+    String path = "test_embedding_cache.db";
+    std::remove(path.c_str());
+    EmbeddingCacheConfig config;
+    config.max_entries = 1000;
+    config.disk_path = path;
+    auto cache = std::make_shared<EmbeddingCache>(model, "hashing-32", config);
+    assert(cache->has_disk_tier());
+    auto first = cache->embed_documents(texts);
+    assert(model->embedded == 200);
+    auto second = cache->embed_documents(texts);
+    assert(model->embedded == 200);
+    assert(first == second);
+    assert(first[3] == model->HashingEmbeddings::embed_documents({texts[3]})[0]);
+    assert(cache->embed_documents({"  " + texts[5] + "\n"})[0] == first[5]);
+    cache->embed_query(texts[0]);
+    cache->embed_query(texts[0]);
+    assert(model->embedded == 201);
+    auto stats = cache->get_stats();
+    assert(stats.misses == 201 && stats.memory_hits == 202 && stats.disk_hits == 0);
+
+    // Duplicates inside a batch are embedded once
+    cache->embed_documents({"fresh text", "fresh text"});
+    assert(model->embedded == 202);
+
+    // A nightly re-index with 5% changed documents only embeds the changes
+    auto store = std::make_shared<InMemoryVectorStore>(cache);
+    for (size_t i = 0; i < 10; ++i) {
+        documents[i * 20].content += " updated";
+    }
+    size_t before = model->embedded;
+    store->add_documents(documents);
+    assert(model->embedded - before == 10);
+
+    // The LRU is bounded, and the disk tier survives a restart
+    EmbeddingCacheConfig small;
+    small.max_entries = 2;
+    EmbeddingCache bounded(model, "hashing-32", small);
+    bounded.embed_documents({"a", "b", "c"});
+    bounded.embed_documents({"a"});
+    assert(bounded.get_stats().memory_entries == 2 && bounded.get_stats().misses == 4);
+    cache.reset();
+    EmbeddingCache reopened(model, "hashing-32", config);
+    before = model->embedded;
+    assert(reopened.embed_documents(texts) == first);
+    assert(model->embedded == before && reopened.get_stats().disk_hits == 200);
+
+    // A different model ID never shares entries
+    EmbeddingCache other(model, "hashing-32-v2", config);
+    other.embed_documents({texts[0]});
+    assert(other.get_stats().misses == 1);
+
+    // A model returning too few vectors is rejected and nothing is cached
+    EmbeddingCache truncated(std::make_shared<TruncatingEmbeddings>(32), "truncating-32");
+    bool rejected = false;
+    try {
+        truncated.embed_documents({"a", "b"});
+    } catch (const std::runtime_error&) {
+        rejected = true;
+    }
+    assert(rejected && truncated.get_stats().memory_entries == 0);
+
+    std::remove(path.c_str());
+    std::cout << "EmbeddingCache tests passed!\n\n";
+}
+
+void test_ingestion_pipeline() {
+    std::cout << "Testing IngestionPipeline...\n";
+
+    auto documents = make_synthetic_documents(300, 89);
+    auto splitter = std::make_shared<TextSplitter>(30, 5);
+    size_t expected_chunks = splitter->split_documents(documents).size();
+
+    // Streaming ingestion stores the same chunks as splitting and adding up front
+    auto model = std::make_shared<CountingEmbeddings>(32);
+    auto direct = std::make_shared<InMemoryVectorStore>(model);
+    direct->add_documents(splitter->split_documents(documents));
+    size_t before = model->embedded;
+
+    IngestionConfig config;
+    config.queue_capacity = 4;
+    config.embed_batch_size = 7;
+    config.insert_batch_size = 50;
+    auto streamed = std::make_shared<InMemoryVectorStore>(model);
+    IngestionPipeline pipeline(streamed, splitter, model, config);
+    auto stats = pipeline.ingest_documents(documents);
+    assert(stats.documents_loaded == 300 && stats.chunks_split == expected_chunks);
+    assert(stats.chunks_embedded == expected_chunks && stats.chunks_stored == expected_chunks);
+    assert(stats.errors == 0 && stats.store_batches == (expected_chunks + 49) / 50);
+    assert(model->embedded - before == expected_chunks);
+    assert(streamed->size() == expected_chunks);
+
+    for (const String query : {"vector index search", "agent memory chain", "doc42 latency"}) {
+        auto expected = direct->similarity_search_with_score(query, 5);
+        auto actual = streamed->similarity_search_with_score(query, 5);
+        assert(expected.size() == actual.size());
+        for (size_t i = 0; i < expected.size(); ++i) {
+            assert(expected[i].first.id == actual[i].first.id);
+            assert(std::abs(expected[i].second - actual[i].second) < 1e-6);
+        }
+    }
+
+    // Without a model the store embeds, and chunks of ID-less documents get fresh IDs
+    auto plain = std::make_shared<InMemoryVectorStore>(std::make_shared<HashingEmbeddings>(32));
+    IngestionPipeline unembedded(plain, splitter);
+    stats = unembedded.ingest_documents({Document(documents[0].content), Document(documents[1].content)});
+    assert(stats.chunks_embedded == 0 && stats.chunks_stored == stats.chunks_split);
+    assert(plain->size() == stats.chunks_split);
+
+    // Batches whose vectors do not line up with their chunks are counted as errors
+    auto truncated = std::make_shared<InMemoryVectorStore>(model);
+    stats = IngestionPipeline(truncated, splitter, std::make_shared<TruncatingEmbeddings>(32), config)
+                .ingest_documents(std::vector<Document>(documents.begin(), documents.begin() + 20));
+    assert(stats.chunks_embedded == 0 && stats.chunks_stored == 0);
+    assert(stats.errors == stats.chunks_split && truncated->size() == 0);
+
+    // Files are read by the loader stage
+    StringList paths = {"test_ingestion_a.txt", "test_ingestion_b.txt"};
+    std::ofstream(paths[0]) << documents[2].content;
+    std::ofstream(paths[1]) << documents[3].content;
+    auto files = std::make_shared<InMemoryVectorStore>(model);
+    stats = IngestionPipeline(files, splitter, model).ingest_files(paths);
+    assert(stats.documents_loaded == 2 && stats.errors == 0);
+    assert(files->size() == stats.chunks_stored && stats.chunks_stored > 0);
+    assert(files->similarity_search(documents[2].content, 1)[0].metadata.at("source") == paths[0]);
+    std::remove(paths[0].c_str());
+    std::remove(paths[1].c_str());
+
+    std::cout << "IngestionPipeline tests passed!\n\n";
+}
+
+void test_max_marginal_relevance() {
+    std::cout << "Testing max marginal relevance search...\n";
+
+    // Overlapping chunks of one passage crowd out the other relevant document
+    auto model = std::make_shared<CountingEmbeddings>(128);
+    std::vector<Document> documents = {
+        Document("vector index search latency tuning guide", {}, "chunk0"),
+        Document("vector index search latency tuning guide part", {}, "chunk1"),
+        Document("vector index search latency tuning guide notes", {}, "chunk2"),
+        Document("vector recall evaluation with search benchmarks", {}, "other"),
+        Document("agent memory chain prompt", {}, "unrelated")
+    };
+    String query = "vector index search latency";
+
+    auto store = std::make_shared<InMemoryVectorStore>(model);
+    store->add_documents(documents);
+    HNSWConfig config;
+    config.seed = 5;
+    auto hnsw = std::make_shared<HNSWVectorStore>(model, config);
+    hnsw->add_documents(documents);
+
+    std::vector<std::shared_ptr<VectorStore>> stores = {store, hnsw};
+    for (const auto& vector_store : stores) {
+        auto similar = vector_store->similarity_search(query, 3);
+        assert(similar[0].id.rfind("chunk", 0) == 0 && similar[2].id.rfind("chunk", 0) == 0);
+
+        // Only the query is embedded; candidate vectors come from the store
+        size_t before = model->embedded;
+        auto diverse = vector_store->max_marginal_relevance_search(query, 2, 5, 0.5);
+        assert(model->embedded - before == 1);
+        assert(diverse.size() == 2);
+        assert(diverse[0].id == similar[0].id);
+        assert(diverse[1].id == "other");
+
+        // lambda_mult = 1 keeps the plain relevance order
+        auto relevant = vector_store->max_marginal_relevance_search(query, 3, 5, 1.0);
+        for (size_t i = 0; i < relevant.size(); ++i) {
+            assert(relevant[i].id == similar[i].id);
+        }
+        assert(vector_store->max_marginal_relevance_search(query, 10, 3).size() == 5);
+    }
+
+    // Stores without an embedding model fall back to relevance ranking
+    auto lexical = std::make_shared<InMemoryVectorStore>();
+    lexical->add_documents(documents);
+    assert(lexical->max_marginal_relevance_search(query, 2).size() == 2);
+
+    std::cout << "Max marginal relevance search tests passed!\n\n";
+}
+
+void test_bm25_retriever() {
+    std::cout << "Testing BM25Retriever...\n";
+
+    // Corpus statistics are maintained as documents are added
+    BM25Retriever small;
+    small.add_documents({Document("apple banana", {}, "a"), Document("apple apple cherry", {}, "b")});
+    small.add_documents({Document("banana", {}, "c")});
+    assert(small.document_count() == 3);
+    assert(std::abs(small.average_document_length() - 2.0) < 1e-9);
+    assert(small.document_frequency("Apple") == 2 && small.document_frequency("durian") == 0);
+
+    // Okapi BM25 with k1 = 1.2, b = 0.75 and idf = ln(1 + (N - df + 0.5) / (df + 0.5))
+    auto results = small.retrieve_with_scores("cherry", 3);
+    assert(results.size() == 1 && results[0].first.id == "b");
+    double expected = std::log(1.0 + 2.5 / 1.5) * 2.2 / (1.0 + 1.2 * (0.25 + 0.75 * 1.5));
+    assert(std::abs(results[0].second - expected) < 1e-9);
+    results = small.retrieve_with_scores("apple banana", 3);
+    assert(results.size() == 3 && results[0].first.id == "a");
+
+    // AdvancedRetriever's BM25 reranking takes the keyword retriever's statistics
+    std::vector<Document> fruit = {Document("apple banana", {}, "a"), Document("apple apple cherry", {}, "b"),
+                                   Document("banana", {}, "c")};
+    auto fruit_store = std::make_shared<InMemoryVectorStore>();
+    fruit_store->add_documents(fruit);
+    auto fruit_index = std::make_shared<BM25Retriever>();
+    fruit_index->add_documents(fruit);
+    AdvancedRetriever reranker(fruit_store, SimilarityAlgorithm::BM25);
+    reranker.set_keyword_retriever(fruit_index);
+    auto reranked = reranker.search_with_scores("apple banana", 3);
+    assert(reranked.size() == results.size());
+    for (const auto& result : results) {
+        auto it = std::find_if(reranked.begin(), reranked.end(),
+                               [&](const auto& candidate) { return candidate.first.id == result.first.id; });
+        assert(it != reranked.end() && std::abs(it->second - result.second) < 1e-9);
+    }
+
+    // Block-max MaxScore returns the exhaustive top k on a Zipf-like corpus while
+    // scoring fewer documents
+    std::mt19937 rng(83);
+    std::vector<double> cumulative;
+    double total = 0.0;
+    for (int rank = 1; rank <= 2000; ++rank) {
+        total += 1.0 / rank;
+        cumulative.push_back(total);
+    }
+    std::uniform_real_distribution<double> uniform(0.0, total);
+    std::vector<Document> documents;
+    for (size_t i = 0; i < 5000; ++i) {
+        String content;
+        size_t length = 5 + rng() % 40;
+        for (size_t w = 0; w < length; ++w) {
+            size_t rank = std::lower_bound(cumulative.begin(), cumulative.end(), uniform(rng)) - cumulative.begin();
+            content += "w" + std::to_string(rank) + " ";
+        }
+        documents.push_back(Document(content, {}, "doc" + std::to_string(i)));
+    }
+    BM25Config exhaustive_config;
+    exhaustive_config.use_pruning = false;
+    BM25Retriever pruned;
+    BM25Retriever exhaustive(exhaustive_config);
+    pruned.add_documents(documents);
+    exhaustive.add_documents(documents);
+
+    size_t postings_total = 0;
+    size_t documents_scored = 0;
+    for (const char* query : {"w0 w1 w2", "w3 w150", "w1 w40 w900", "w0 w7 w7 w300 w1200", "w2 w5"}) {
+        BM25SearchStats pruned_stats;
+        BM25SearchStats exhaustive_stats;
+        auto expected_results = exhaustive.retrieve_with_scores(query, 10, &exhaustive_stats);
+        auto pruned_results = pruned.retrieve_with_scores(query, 10, &pruned_stats);
+        assert(pruned_results.size() == expected_results.size());
+        for (size_t i = 0; i < expected_results.size(); ++i) {
+            assert(pruned_results[i].first.id == expected_results[i].first.id);
+            assert(std::abs(pruned_results[i].second - expected_results[i].second) < 1e-9);
+        }
+        postings_total += pruned_stats.postings_total;
+        documents_scored += pruned_stats.documents_scored;
+    }
+    assert(documents_scored * 2 < postings_total);
+
+    std::cout << "BM25Retriever tests passed!\n\n";
+}
+
+void test_hybrid_search() {
+    std::cout << "Testing hybrid search...\n";
+
+    auto embeddings = std::make_shared<HashingEmbeddings>(64);
+    auto documents = make_synthetic_documents(300, 89);
+    auto dense = std::make_shared<InMemoryVectorStore>(embeddings);
+    dense->add_documents(documents);
+    auto keyword = std::make_shared<BM25Retriever>();
+    keyword->add_documents(documents);
+
+    AdvancedRetriever retriever(dense);
+    retriever.set_keyword_retriever(keyword);
+    const String query = "doc17 latency recall";
+    auto ids_of = [](const std::vector<Document>& results) {
+        StringList ids;
+        for (const auto& document : results) {
+            ids.push_back(document.id);
+        }
+        return ids;
+    };
+
+    // A weight of zero reduces the fusion to the other leg's ranking
+    assert(ids_of(retriever.hybrid_search(query, 5, {}, 1.0, 0.0)) == ids_of(keyword->retrieve(query, 5)));
+    assert(ids_of(retriever.hybrid_search(query, 5, {}, 0.0, 1.0)) == ids_of(dense->similarity_search(query, 5)));
+
+    // Documents found by both legs appear once, with both legs' reciprocal ranks
+    auto keyword_ids = ids_of(keyword->retrieve(query, 40));
+    auto dense_ids = ids_of(dense->similarity_search(query, 40));
+    auto fused = retriever.hybrid_search_with_scores(query, 10);
+    assert(fused.size() == 10);
+    std::set<String> unique_ids;
+    for (const auto& result : fused) {
+        unique_ids.insert(result.first.id);
+        double expected = 0.0;
+        for (const StringList* ranking : {&keyword_ids, &dense_ids}) {
+            auto it = std::find(ranking->begin(), ranking->end(), result.first.id);
+            if (it != ranking->end()) {
+                expected += 0.5 / (61.0 + (it - ranking->begin()));
+            }
+        }
+        assert(std::abs(result.second - expected) < 1e-12);
+    }
+    assert(unique_ids.size() == fused.size());
+
+    // Weighted scores scale each leg to [0, 1]
+    retriever.set_fusion_method(FusionMethod::WEIGHTED_SCORE);
+    fused = retriever.hybrid_search_with_scores(query, 10, {}, 0.3, 0.7);
+    assert(fused.size() == 10 && fused[0].second <= 1.0 + 1e-12);
+    for (size_t i = 1; i < fused.size(); ++i) {
+        assert(fused[i - 1].second >= fused[i].second);
+    }
+
+    // Filters apply to both legs
+    auto filtered = retriever.hybrid_search(query, 5, {{"index", "42"}});
+    assert(filtered.size() == 1 && filtered[0].id == "doc42");
+
+    // Without a keyword retriever the semantic candidates are ranked a second time by term similarity
+    AdvancedRetriever semantic_only(dense, SimilarityAlgorithm::OVERLAP);
+    auto reranked = semantic_only.hybrid_search(query, 5);
+    assert(reranked.size() == 5);
+    for (const auto& document : reranked) {
+        assert(std::find(dense_ids.begin(), dense_ids.begin() + 20, document.id) != dense_ids.begin() + 20);
+    }
+
+    std::cout << "Hybrid search tests passed!\n\n";
+}
+
 void test_tools() {
     std::cout << "Testing Tools...\n";
 
@@ -231,6 +1666,25 @@ int main() {
         test_simple_llm();
         test_llm_chain();
         test_vector_store();
+        test_lexical_index();
+        test_tokenizer();
+        test_vector_math_kernels();
+        test_dense_vector_store();
+        test_vector_store_compaction();
+        test_vector_store_persistence();
+        test_hnsw_vector_store();
+        test_ivf_vector_store();
+        test_quantized_vector_store();
+        test_batch_search();
+        test_concurrent_vector_store();
+        test_parallel_scan();
+        test_metadata_filter();
+        test_sharded_vector_store();
+        test_embedding_cache();
+        test_ingestion_pipeline();
+        test_max_marginal_relevance();
+        test_bm25_retriever();
+        test_hybrid_search();
         test_tools();
         test_memory();
         test_enhanced_react_agent();